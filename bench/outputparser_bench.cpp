@@ -0,0 +1,132 @@
+// Replays recorded yt-dlp transcripts through LineAssembler + OutputParser
+// the same way DownloadWorker does and reports the parsing throughput.
+//
+// Usage: outputparser_bench [--iterations N] [--chunk BYTES] [transcript|dir ...]
+// Without paths it uses the transcripts in bench/transcripts.
+
+#include "vimeodownloader/lineassembler.h"
+#include "vimeodownloader/outputparser.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+#include <cstdio>
+
+namespace {
+struct Transcript {
+    QString name;
+    QByteArray data;
+};
+
+struct Result {
+    qint64 lines = 0;
+    qint64 counts[OutputParser::LineTypeCount] = {};
+    qint64 nanoseconds = 0;
+};
+
+QList<Transcript> loadTranscripts(const QStringList &paths)
+{
+    QList<Transcript> transcripts;
+    for (const QString &path : paths) {
+        QFileInfo info(path);
+        QStringList files;
+        if (info.isDir()) {
+            const QFileInfoList entries = QDir(path).entryInfoList({ "*.txt", "*.log" }, QDir::Files, QDir::Name);
+            for (const QFileInfo &entry : entries) {
+                files << entry.absoluteFilePath();
+            }
+        } else {
+            files << path;
+        }
+
+        for (const QString &file : files) {
+            QFile input(file);
+            if (!input.open(QIODevice::ReadOnly)) {
+                std::fprintf(stderr, "Cannot read %s\n", qPrintable(file));
+                continue;
+            }
+            transcripts.append({ QFileInfo(file).fileName(), input.readAll() });
+        }
+    }
+    return transcripts;
+}
+
+Result replay(const QByteArray &data, int chunkSize, int iterations)
+{
+    Result result;
+    LineAssembler assembler;
+    OutputParser parser;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        parser.reset();
+        // QProcess hands over arbitrary chunks, lines are split across them
+        for (qsizetype offset = 0; offset < data.size(); offset += chunkSize) {
+            QByteArrayView chunk(data.constData() + offset, qMin<qsizetype>(chunkSize, data.size() - offset));
+            assembler.append(chunk, [&](QByteArrayView line) {
+                result.counts[parser.parseLine(line)]++;
+                result.lines++;
+            });
+        }
+        QByteArray remainder = assembler.takeRemainder();
+        if (!remainder.isEmpty()) {
+            result.counts[parser.parseLine(remainder)]++;
+            result.lines++;
+        }
+    }
+    result.nanoseconds = timer.nsecsElapsed();
+    return result;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = 2000;
+    int chunkSize = 4096;
+    QStringList paths;
+
+    for (int i = 1; i < argc; ++i) {
+        QByteArray arg(argv[i]);
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = qMax(1, QByteArray(argv[++i]).toInt());
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            chunkSize = qMax(1, QByteArray(argv[++i]).toInt());
+        } else {
+            paths << QString::fromLocal8Bit(arg);
+        }
+    }
+    if (paths.isEmpty()) {
+        paths << QStringLiteral(BENCH_TRANSCRIPT_DIR);
+    }
+
+    const QList<Transcript> transcripts = loadTranscripts(paths);
+    if (transcripts.isEmpty()) {
+        std::fprintf(stderr, "No transcripts found\n");
+        return 1;
+    }
+
+    std::printf("%-32s %10s %10s %14s %10s\n", "transcript", "lines", "progress", "lines/s", "MiB/s");
+    qint64 totalLines = 0;
+    qint64 totalBytes = 0;
+    qint64 totalNanoseconds = 0;
+    for (const Transcript &transcript : transcripts) {
+        Result result = replay(transcript.data, chunkSize, iterations);
+        double seconds = qMax<qint64>(1, result.nanoseconds) / 1e9;
+        qint64 bytes = qint64(transcript.data.size()) * iterations;
+        std::printf("%-32s %10lld %10lld %14.0f %10.1f\n", qPrintable(transcript.name),
+                    result.lines / iterations, result.counts[OutputParser::Progress] / iterations,
+                    result.lines / seconds, bytes / seconds / (1024.0 * 1024.0));
+        totalLines += result.lines;
+        totalBytes += bytes;
+        totalNanoseconds += result.nanoseconds;
+    }
+
+    double seconds = qMax<qint64>(1, totalNanoseconds) / 1e9;
+    std::printf("%-32s %10s %10s %14.0f %10.1f\n", "total", "", "", totalLines / seconds,
+                totalBytes / seconds / (1024.0 * 1024.0));
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Stress test of the download submission path: P producer threads enqueue
+// items while one consumer drains them, once through MpscQueue and once
+// through a mutex-protected queue (what DownloadQueue::addDownload used).
+// Reports per-enqueue latency percentiles and total throughput.
+//
+// Usage: submitqueue_bench [--producers N] [--items PER_PRODUCER]
+
+#include "vimeodownloader/mpscqueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Roughly the size of a queued download request
+struct Submission {
+    unsigned long long id = 0;
+    char url[96] = {};
+};
+
+struct Result {
+    double seconds = 0;
+    std::vector<long long> latencies; // Nanoseconds per enqueue, all producers
+};
+
+class MutexQueue
+{
+public:
+    void push(Submission value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_items.push_back(value);
+    }
+
+    bool pop(Submission &value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_items.empty()) {
+            return false;
+        }
+        value = m_items.front();
+        m_items.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::deque<Submission> m_items;
+};
+
+template <typename Queue>
+Result run(int producers, int itemsPerProducer)
+{
+    Queue queue;
+    std::atomic<bool> go { false };
+    std::atomic<long long> consumed { 0 };
+    const long long expected = (long long)producers * itemsPerProducer;
+    std::vector<std::vector<long long>> latencies(producers);
+
+    // The consumer keeps draining, like the scheduler thread does
+    std::thread consumer([&]() {
+        Submission item;
+        while (consumed.load(std::memory_order_relaxed) < expected) {
+            if (queue.pop(item)) {
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            std::vector<long long> &samples = latencies[p];
+            samples.reserve(itemsPerProducer);
+            Submission item;
+            std::snprintf(item.url, sizeof(item.url), "https://vimeo.com/%d", p);
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            for (int i = 0; i < itemsPerProducer; ++i) {
+                item.id = (unsigned long long)p << 32 | unsigned(i);
+                Clock::time_point start = Clock::now();
+                queue.push(item);
+                samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+            }
+        });
+    }
+
+    Clock::time_point start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+
+    Result result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (const std::vector<long long> &samples : latencies) {
+        result.latencies.insert(result.latencies.end(), samples.begin(), samples.end());
+    }
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+long long percentile(const std::vector<long long> &sorted, double fraction)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, size_t(fraction * double(sorted.size())));
+    return sorted[index];
+}
+
+void print(const char *name, int producers, const Result &result)
+{
+    std::printf("%-8s %9d %10lld %10lld %10lld %12lld %14.0f\n", name, producers,
+                percentile(result.latencies, 0.50), percentile(result.latencies, 0.99),
+                percentile(result.latencies, 0.999), result.latencies.empty() ? 0 : result.latencies.back(),
+                double(result.latencies.size()) / result.seconds);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    int maxProducers = int(std::max(2u, std::thread::hardware_concurrency()));
+    int itemsPerProducer = 200000;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--producers") && i + 1 < argc) {
+            maxProducers = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--items") && i + 1 < argc) {
+            itemsPerProducer = std::max(1, std::atoi(argv[++i]));
+        }
+    }
+
+    std::printf("%-8s %9s %10s %10s %10s %12s %14s\n", "queue", "producers", "p50 ns", "p99 ns", "p99.9 ns",
+                "max ns", "items/s");
+    for (int producers = 1; producers <= maxProducers; producers *= 2) {
+        print("mpsc", producers, run<MpscQueue<Submission>>(producers, itemsPerProducer));
+        print("mutex", producers, run<MutexQueue>(producers, itemsPerProducer));
+    }
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef APPPATHS_H
+#define APPPATHS_H
+
+#include <QString>
+
+// Locations shared by every front end (desktop app, CLI). They depend on the
+// application and organization names, so QCoreApplication must be set up first.
+class AppPaths
+{
+public:
+    // config.ini; its folder is created if missing
+    static QString configPath();
+    // Folder of config.ini: journal, logs
+    static QString configDir();
+    // Disposable data (metadata cache); created if missing
+    static QString cacheDir();
+    // Archive of downloaded videos, next to config.ini
+    static QString archivePath();
+    // Watermarks of synced playlists and channels, next to config.ini
+    static QString syncStatePath();
+};
+
+#endif // APPPATHS_H
@@ -0,0 +1,43 @@
+#ifndef BANDWIDTHSCHEDULE_H
+#define BANDWIDTHSCHEDULE_H
+
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "timewindow.h"
+
+// Global download bandwidth cap by time of day. Rules are "window=rate"
+// with a TimeWindow, e.g. "Mon-Fri 08:00-19:00=20M" or "22:00-06:00=0".
+// The first matching rule wins, the default limit applies otherwise.
+// Rates are bytes per second with K/M/G suffixes (1024-based, as yt-dlp);
+// 0, "off" or "unlimited" mean no cap.
+class BandwidthSchedule
+{
+public:
+    BandwidthSchedule();
+
+    // False (with the offending entry in *error) if an entry cannot be parsed;
+    // the valid entries are kept
+    bool parse(const QStringList &entries, QString *error = nullptr);
+    void setDefaultLimit(qint64 bytesPerSecond) { m_defaultLimit = qMax<qint64>(0, bytesPerSecond); }
+    qint64 defaultLimit() const { return m_defaultLimit; }
+    bool isEmpty() const { return m_rules.isEmpty() && m_defaultLimit == 0; }
+
+    // Bytes per second allowed at `time`, 0 for no cap
+    qint64 limitAt(const QDateTime &time) const;
+
+    static qint64 parseRate(const QString &text, bool *ok = nullptr);
+
+private:
+    struct Rule {
+        TimeWindow window;
+        qint64 limit = 0;
+    };
+
+    QList<Rule> m_rules;
+    qint64 m_defaultLimit;
+};
+
+#endif // BANDWIDTHSCHEDULE_H
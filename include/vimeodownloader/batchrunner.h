@@ -0,0 +1,119 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QModelIndex>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+#include "bandwidthschedule.h"
+#include "downloaditem.h"
+#include "timewindow.h"
+
+class DownloadQueue;
+class LogModel;
+class LogSink;
+class ToolsManager;
+
+// Headless front end of the download queue: runs a fixed list of URLs,
+// reports progress on stderr and a JSON-lines summary on stdout.
+//
+// stdout (one object per line, then a final summary):
+//   {"type":"item","url":...,"status":"completed|failed|cancelled|invalid|skipped",...}
+//   {"type":"group","url":...,"queued":N,"completed":N,...} once a playlist is done
+//   {"type":"summary","total":N,"completed":N,"failed":N,...,"exitCode":N}
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ExitCode {
+        ExitOk = 0,          // Every URL downloaded (or already in the download archive)
+        ExitFailures = 1,    // At least one URL failed, was cancelled or is invalid
+        ExitUsage = 2,       // Bad arguments, no URLs, no download folder
+        ExitMissingTools = 3,
+        ExitInterrupted = 130
+    };
+
+    struct Options {
+        QStringList urls;
+        QString username;
+        QString password;
+        QString downloadDir;
+        int maxConcurrent = 3;
+        int maxMerges = 0;     // 0: the queue's default
+        int prefetchDepth = 3; // Pending items resolved ahead, 0 disables
+        int metadataCacheHours = 6; // 0 disables the metadata cache
+        bool skipArchived = true;   // Videos in the download archive are not downloaded again
+        bool sync = false;          // Collections only list entries newer than the last sync
+        QString scheduling = "fifo"; // fifo, shortest or fair
+        int agingMinutes = 30;       // Wait before an item goes first whatever its size, 0 disables
+        QStringList folderWeights;   // "folder=weight" for fair
+        BandwidthSchedule bandwidth; // Global download bandwidth cap
+        TimeWindow runWindow;        // Hours downloads may run, always by default
+        bool resume = true;
+        double progressInterval = 1.0;
+        bool quiet = false;    // No progress lines
+        bool verbose = false;  // yt-dlp and queue log on stderr
+        QString logDir;        // JSONL log folder, empty to disable
+    };
+
+    explicit BatchRunner(const Options &options, QObject *parent = nullptr);
+    ~BatchRunner();
+
+    // Returns false (after printing why) when nothing was started; the
+    // process should then exit with exitCode()
+    bool start();
+    int exitCode() const { return m_exitCode; }
+    // Cancels running downloads and finishes with ExitInterrupted
+    void interrupt();
+
+signals:
+    void finished(int exitCode);
+
+private slots:
+    void onDownloadStarted(const DownloadItem &item);
+    void onItemUpdated(const DownloadItem &item);
+    void onDownloadCompleted(const DownloadItem &item);
+    void onDownloadFailed(const DownloadItem &item, const QString &error);
+    void onGroupUpdated(const DownloadGroup &group);
+    void onQueueFinished();
+    void onLogRowsInserted(const QModelIndex &parent, int first, int last);
+    void printProgress();
+
+private:
+    // Counts what the queue made of the submitted URLs: new downloads,
+    // playlists (counted as they are listed) and archived videos
+    void onSubmitted(const QList<DownloadItem> &items, const QList<quint64> &ids);
+    void recordResult(const DownloadItem &item, const QString &status, const QString &error);
+    void printLine(const QByteArray &line, bool toStdout);
+    void finish(int exitCode);
+
+    Options m_options;
+    LogModel *m_log;
+    LogSink *m_logSink;
+    ToolsManager *m_toolsManager;
+    DownloadQueue *m_queue;
+    QTimer *m_progressTimer;
+    QElapsedTimer m_elapsed;
+    bool m_stderrIsTerminal;
+    bool m_progressLineOpen; // A \r progress line is on screen
+    bool m_done;
+    int m_exitCode;
+    int m_progressTicks;
+
+    QHash<quint64, DownloadItem> m_running;
+    QHash<quint64, DownloadGroup> m_groups; // Last known state of each playlist
+    int m_expected;
+    int m_completed;
+    int m_failed;
+    int m_cancelled;
+    int m_invalid;
+    int m_skipped;  // Already in the download archive (playlist entries included)
+    qint64 m_transferredBytes;
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,107 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+#include "downloaditem.h"
+
+class DownloadQueue;
+class QTcpServer;
+class QTcpSocket;
+
+// Local HTTP/JSON control API over a DownloadQueue (daemon mode).
+//
+//   GET  /api/queue                    counters and running downloads
+//   POST /api/queue/pause | resume
+//   GET  /api/items?state=&offset=&limit=
+//   POST /api/items                    batch enqueue (JSON or one URL per line)
+//   GET  /api/items/<id>
+//   POST /api/items/<id>/cancel        (or DELETE /api/items/<id>)
+//   POST /api/items/<id>/priority      {"priority": N or "bulk"|"normal"|"urgent"}
+//   GET  /api/groups                   expanded playlists, showcases and channels
+//   GET  /api/groups/<id>
+//   POST /api/groups/<id>/cancel       (or DELETE /api/groups/<id>)
+//   GET  /api/events                   server-sent events: progress, started,
+//                                      resolved, completed, failed, group, queue
+//
+// Plain HTTP/1.1, one request per connection except the event stream. Meant
+// for the loopback interface: requests whose Host or Origin is not a
+// loopback name get 403 (DNS rebinding, cross-site forms and fetches); a
+// bearer token can be required on top.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Defaults {
+        QString username;
+        QString password;
+        QString downloadDir;
+    };
+
+    ControlServer(DownloadQueue *queue, const Defaults &defaults, QObject *parent = nullptr);
+    ~ControlServer();
+
+    bool listen(const QHostAddress &address, quint16 port);
+    quint16 serverPort() const;
+    QString errorString() const;
+    // Requests must carry "Authorization: Bearer <token>"; empty disables the check
+    void setToken(const QString &token) { m_token = token.toUtf8(); }
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void onDownloadStarted(const DownloadItem &item);
+    void onItemUpdated(const DownloadItem &item);
+    void onMetadataReady(const DownloadItem &item);
+    void onDownloadCompleted(const DownloadItem &item);
+    void onDownloadFailed(const DownloadItem &item, const QString &error);
+    void onGroupUpdated(const DownloadGroup &group);
+    void onQueueStatusChanged(int current, int total);
+    void flushEvents();
+
+private:
+    struct Request {
+        QByteArray method;
+        QByteArray path;
+        QHash<QByteArray, QByteArray> query;
+        QHash<QByteArray, QByteArray> headers; // Lower-case names
+        QByteArray body;
+    };
+
+    // 0: need more data, -1: malformed or too large, 1: complete
+    int parseRequest(QByteArray &buffer, Request &request) const;
+    void handleRequest(QTcpSocket *socket, const Request &request);
+    void handleEnqueue(QTcpSocket *socket, const Request &request);
+    void handleItemList(QTcpSocket *socket, const Request &request);
+    void openEventStream(QTcpSocket *socket);
+
+    void sendJson(QTcpSocket *socket, int status, const QJsonObject &object);
+    void sendError(QTcpSocket *socket, int status, const QString &message);
+    void sendEvent(const QByteArray &event, const QJsonObject &data);
+    QJsonObject queueStatus() const;
+    static QJsonObject itemToJson(const DownloadItem &item);
+    static QJsonObject groupToJson(const DownloadGroup &group);
+
+    DownloadQueue *m_queue;
+    Defaults m_defaults;
+    QTcpServer *m_server;
+    QByteArray m_token;
+
+    QHash<QTcpSocket *, QByteArray> m_buffers; // Requests still being received
+    QList<QTcpSocket *> m_eventClients;
+
+    // Progress is coalesced per item and sent at most every EVENT_INTERVAL_MS
+    QHash<quint64, DownloadItem> m_pendingProgress;
+    QTimer *m_eventTimer;
+    QTimer *m_keepAliveTimer;
+};
+
+#endif // CONTROLSERVER_H
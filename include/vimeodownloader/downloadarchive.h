@@ -0,0 +1,75 @@
+#ifndef DOWNLOADARCHIVE_H
+#define DOWNLOADARCHIVE_H
+
+#include <QFile>
+#include <QLockFile>
+#include <QString>
+
+// Persistent set of every video downloaded so far, keyed by
+// UrlUtils::canonicalVideoKey, so a link is recognised however it is written.
+// The file is memory-mapped: an open-addressing table of 64-bit key hashes
+// (linear probing, at most half full) with a Bloom filter in front of it, so
+// most unknown videos are answered without touching the table. Nothing is
+// read or scanned at startup; the table doubles into a new file when full.
+//
+// Layout (host byte order): header, Bloom filter words, table slots.
+// Writes go to the shared mapping and reach the file even if the process
+// crashes. One process at a time: a second one (desktop app and CLI running
+// together) finds the lock taken and works without the archive.
+// Not thread-safe: used from the thread that owns the queue.
+class DownloadArchive
+{
+public:
+    static constexpr quint32 INITIAL_CAPACITY = 1 << 16; // Slots, power of two
+
+    explicit DownloadArchive(const QString &path);
+    ~DownloadArchive();
+
+    bool isOpen() const { return m_map != nullptr; }
+    QString path() const { return m_path; }
+    QString errorString() const { return m_error; }
+
+    bool contains(const QString &url) const;
+    // False if the video was already archived or the file cannot grow
+    bool add(const QString &url);
+    int size() const;
+
+    // Lookups answered by the Bloom filter alone
+    qint64 lookups() const { return m_lookups; }
+    qint64 filteredLookups() const { return m_filtered; }
+
+    // 64-bit hash of the canonical video key; never 0 (the empty slot)
+    static quint64 keyHash(const QString &url);
+
+private:
+    struct Header {
+        quint32 magic;
+        quint32 version;
+        quint32 capacity;   // Table slots
+        quint32 count;      // Used slots
+        quint32 bloomWords; // 64-bit words of the Bloom filter
+        quint32 reserved[3];
+    };
+
+    bool open();
+    bool create(const QString &path, quint32 capacity);
+    void close();
+    bool grow();
+    bool containsHash(quint64 hash) const;
+    void insertHash(quint64 hash);
+
+    Header *header() const { return reinterpret_cast<Header *>(m_map); }
+    quint64 *bloom() const { return reinterpret_cast<quint64 *>(m_map + sizeof(Header)); }
+    quint64 *slotArray() const { return bloom() + header()->bloomWords; }
+    static qint64 fileSize(quint32 capacity);
+
+    QString m_path;
+    QString m_error;
+    QLockFile m_lock;
+    QFile m_file;
+    uchar *m_map;
+    mutable qint64 m_lookups;
+    mutable qint64 m_filtered;
+};
+
+#endif // DOWNLOADARCHIVE_H
@@ -0,0 +1,124 @@
+#ifndef DOWNLOADENGINE_H
+#define DOWNLOADENGINE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+
+#include "downloaditem.h"
+#include "logbuffer.h"
+
+class DownloadWorker;
+class QThreadPool;
+
+// State of one worker slot as last published by the engine
+struct WorkerSnapshot {
+    int slot = -1;
+    bool busy = false;
+    bool suspended = false;
+    DownloadItem item;
+};
+Q_DECLARE_METATYPE(WorkerSnapshot)
+
+// Execution engine for the worker pool. It lives in its own thread and owns
+// every DownloadWorker (and so every yt-dlp process and its output parsing).
+// Progress and log lines are not forwarded one by one: they are coalesced and
+// published at most SNAPSHOT_INTERVAL_MS apart, so the cost on the GUI thread
+// does not grow with the number of running downloads. Lifecycle events
+// (finished, rate limited, suspended, stage changes) are delivered right away,
+// after any pending batch so ordering is preserved.
+//
+// The verify and move stages of every worker share a small disk pool, so
+// file checks and cross-device copies never block the engine thread.
+//
+// With a bandwidth limit, the limit is split max-min fairly over the
+// fetching workers every BANDWIDTH_TICK_MS (a transfer slower than its share
+// keeps only what it uses, idle and finished slots take nothing) and each
+// worker spends its share from a token bucket, settled whenever the worker
+// reports progress. A worker over budget is stopped until its bucket
+// refills, so the cap follows changes without restarting any download.
+//
+// All public slots are meant to be invoked through queued connections.
+class DownloadEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int SNAPSHOT_INTERVAL_MS = 33; // ~30 Hz
+    static constexpr int DISK_POOL_THREADS = 2;
+    static constexpr int BANDWIDTH_TICK_MS = 100;
+
+    explicit DownloadEngine(QObject *parent = nullptr);
+    ~DownloadEngine();
+
+public slots:
+    void startDownload(int slot, const DownloadItem &item, const QString &ytDlpPath, const QString &ffmpegPath);
+    void cancelDownload(int slot);
+    void pauseDownload(int slot);
+    void resumeDownload(int slot);
+    void setResumeEnabled(bool enabled);
+    void setProgressInterval(double seconds);
+    void setMetadataCacheDir(const QString &directory);
+    // Prefix log lines with "[slot] " (useful with more than one slot)
+    void setSlotPrefix(bool enabled);
+    // Bytes per second shared by every download, 0 for no limit
+    void setBandwidthLimit(qint64 bytesPerSecond);
+    // Drops idle workers at or above `slotCount`
+    void trimWorkers(int slotCount);
+    // Kills every process; called before the engine thread stops
+    void shutdown();
+
+signals:
+    void snapshotsReady(const QList<WorkerSnapshot> &snapshots); // Only slots that changed
+    void logBatchReady(const QList<LogEntry> &entries);
+    void workerSuspendedChanged(int slot, bool suspended);
+    void workerRateLimited(int slot, const QString &url);
+    // Resume accounting of the finished attempt travels with the item
+    void workerFinished(int slot, const DownloadItem &item, qint64 attemptReusedBytes, qint64 attemptTransferredBytes);
+
+private slots:
+    void onWorkerProgress(int slot, int percentage);
+    void onWorkerLog(int slot, const QString &message);
+    void onWorkerRateLimited(int slot);
+    void onWorkerSuspendedChanged(int slot, bool suspended);
+    void onWorkerStageChanged(int slot, DownloadStage stage);
+    void onWorkerFinished(int slot, const DownloadItem &item);
+    void flush();
+    void balanceBandwidth();
+
+private:
+    // Token bucket of one fetching worker
+    struct BandwidthShare {
+        quint64 itemId = 0;
+        qint64 lastBytes = 0; // downloadedBytes when the bucket was last settled
+        qint64 settledMs = 0; // m_bandwidthClock time of that settlement
+        double tokens = 0.0;  // Bytes it may still transfer, negative when over
+    };
+
+    DownloadWorker *worker(int slot);
+    void scheduleFlush();
+
+    QList<DownloadWorker *> m_workers;
+    bool m_resumeEnabled;
+    double m_progressInterval;
+    QString m_metadataCacheDir;
+    bool m_slotPrefix;
+    QThreadPool *m_diskPool;
+    
+    // Bandwidth limit (0: none) and the buckets of the fetching slots
+    qint64 m_bandwidthLimit;
+    QTimer *m_bandwidthTimer;
+    QElapsedTimer m_bandwidthClock;
+    QHash<int, BandwidthShare> m_shares;
+
+    // Pending batch
+    QTimer *m_flushTimer;
+    QSet<int> m_dirtySlots;
+    QList<LogEntry> m_pendingLines;
+};
+
+#endif // DOWNLOADENGINE_H
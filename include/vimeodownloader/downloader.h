@@ -6,6 +6,9 @@
 #include <QString>
 #include <QTimer>
 
+#include "lineassembler.h"
+#include "outputparser.h"
+
 class Downloader : public QObject
 {
     Q_OBJECT
@@ -37,6 +40,9 @@ private:
     QProcess *m_process;
     bool m_isDownloading;
     QString m_currentUrl;
+    LineAssembler m_outputLines;
+    LineAssembler m_errorLines;
+    OutputParser m_parser;
 };
 
 #endif // DOWNLOADER_H
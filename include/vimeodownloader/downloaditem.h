@@ -2,7 +2,9 @@
 #define DOWNLOADITEM_H
 
 #include <QString>
+#include <QStringList>
 #include <QDateTime>
+#include <QMetaType>
 
 enum class DownloadStatus {
     Pending,
@@ -12,7 +14,30 @@ enum class DownloadStatus {
     Cancelled
 };
 
+// Pipeline of one download attempt. Resolve and Fetch use a download slot,
+// Merge the merge pool and Verify/Move the engine's disk pool.
+enum class DownloadStage {
+    Resolve,  // yt-dlp extracts the video info and formats
+    Fetch,    // Media transfer
+    Merge,    // ffmpeg merge and fixups
+    Verify,   // Output files checked in the staging folder
+    Move,     // Staging folder -> download folder
+    Count
+};
+
+// Lanes of `priority` values; an urgent item may suspend a running
+// lower-priority transfer to start right away
+enum class PriorityClass {
+    Bulk,     // priority < 0
+    Normal,   // 0 <= priority < URGENT_PRIORITY
+    Urgent    // priority >= URGENT_PRIORITY
+};
+
 struct DownloadItem {
+    static constexpr int URGENT_PRIORITY = 100; // Lowest urgent priority
+    static constexpr int BULK_PRIORITY = -10;   // What "bulk" stands for
+    
+    quint64 id;         // Unique within the queue, assigned on enqueue
     QString url;
     QString username;
     QString password;
@@ -24,22 +49,148 @@ struct DownloadItem {
     QDateTime finishTime;
     int progress;
     QString errorMessage;
+    bool rateLimited;   // A rate-limit signature was seen on stderr
+    int retryCount;     // Number of times the item was re-queued
+    int priority;       // Higher runs first, FIFO among equals (default 0)
+    quint64 groupId;    // Playlist/showcase/channel it was expanded from, 0 if none
+    qint64 firstByteMs; // Enqueue to first media byte, -1 until then (not persisted)
+    QDateTime notBefore; // Does not start before this time, invalid for no bound
+    QDateTime notAfter;  // Fails if still pending at this time, checkpointed if running
+    
+    // Resume tracking: yt-dlp destinations whose .part files can be continued
+    QStringList partialFiles;
+    qint64 reusedBytes;       // Bytes already on disk when an attempt resumed
+    qint64 transferredBytes;  // Bytes actually downloaded over all attempts
+    
+    // Live transfer state from yt-dlp's progress template (not persisted)
+    qint64 downloadedBytes;   // Completed formats plus the current one
+    qint64 totalBytes;        // Exact or estimated size, 0 when unknown
+    double speed;             // Bytes per second, 0 when unknown
+    int eta;                  // Seconds, -1 when unknown
+    
+    // Prefetched metadata (not persisted, except the title)
+    int duration;             // Seconds, -1 when unknown
+    qint64 estimatedBytes;    // Size of the selected formats, 0 when unknown
+    QString infoJsonPath;     // yt-dlp info JSON, lets the download skip extraction
+    
+    // Pipeline state, summed over all attempts (not persisted)
+    DownloadStage stage;      // Meaningful while Downloading
+    qint64 stageMs[int(DownloadStage::Count)]; // Time spent per stage, -1 if never reached
+    QStringList outputFiles;  // Final files in downloadDir once moved
     
     DownloadItem() 
-        : status(DownloadStatus::Pending)
+        : id(0)
+        , status(DownloadStatus::Pending)
         , addedTime(QDateTime::currentDateTime())
         , progress(0) 
-    {}
+        , rateLimited(false)
+        , retryCount(0)
+        , priority(0)
+        , groupId(0)
+        , firstByteMs(-1)
+        , reusedBytes(0)
+        , transferredBytes(0)
+        , downloadedBytes(0)
+        , totalBytes(0)
+        , speed(0.0)
+        , eta(-1)
+        , duration(-1)
+        , estimatedBytes(0)
+        , stage(DownloadStage::Resolve)
+    {
+        resetStageTimes();
+    }
     
     DownloadItem(const QString &url, const QString &user, const QString &pass, const QString &dir)
-        : url(url)
+        : id(0)
+        , url(url)
         , username(user)
         , password(pass)
         , downloadDir(dir)
         , status(DownloadStatus::Pending)
         , addedTime(QDateTime::currentDateTime())
         , progress(0)
-    {}
+        , rateLimited(false)
+        , retryCount(0)
+        , priority(0)
+        , groupId(0)
+        , firstByteMs(-1)
+        , reusedBytes(0)
+        , transferredBytes(0)
+        , downloadedBytes(0)
+        , totalBytes(0)
+        , speed(0.0)
+        , eta(-1)
+        , duration(-1)
+        , estimatedBytes(0)
+        , stage(DownloadStage::Resolve)
+    {
+        resetStageTimes();
+    }
+    
+    void resetStageTimes() {
+        for (qint64 &ms : stageMs) {
+            ms = -1;
+        }
+    }
+    
+    PriorityClass priorityClass() const {
+        if (priority >= URGENT_PRIORITY) {
+            return PriorityClass::Urgent;
+        }
+        return priority < 0 ? PriorityClass::Bulk : PriorityClass::Normal;
+    }
+    bool isUrgent() const { return priorityClass() == PriorityClass::Urgent; }
+    
+    // "bulk", "normal", "urgent" -> the priority the class starts at; false if unknown
+    static bool classPriority(const QString &name, int *priority) {
+        QString lower = name.trimmed().toLower();
+        if (lower == "urgent") {
+            *priority = URGENT_PRIORITY;
+        } else if (lower == "normal") {
+            *priority = 0;
+        } else if (lower == "bulk") {
+            *priority = BULK_PRIORITY;
+        } else {
+            return false;
+        }
+        return true;
+    }
+    
+    static QString className(PriorityClass priorityClass) {
+        switch (priorityClass) {
+            case PriorityClass::Bulk: return "bulk";
+            case PriorityClass::Urgent: return "urgent";
+            default: return "normal";
+        }
+    }
+    
+    // Resolve and Fetch are network-bound and hold a download slot
+    bool isNetworkStage() const {
+        return stage == DownloadStage::Resolve || stage == DownloadStage::Fetch;
+    }
+    
+    static QString stageName(DownloadStage stage) {
+        switch (stage) {
+            case DownloadStage::Resolve: return "resolve";
+            case DownloadStage::Fetch: return "fetch";
+            case DownloadStage::Merge: return "merge";
+            case DownloadStage::Verify: return "verify";
+            case DownloadStage::Move: return "move";
+            default: return "unknown";
+        }
+    }
+    
+    // "resolve 1.2 s, fetch 30.4 s, ..." for the stages that were reached
+    QString stageSummary() const {
+        QStringList parts;
+        for (int i = 0; i < int(DownloadStage::Count); ++i) {
+            if (stageMs[i] >= 0) {
+                parts << QString("%1 %2 s").arg(stageName(DownloadStage(i))).arg(stageMs[i] / 1000.0, 0, 'f', 1);
+            }
+        }
+        return parts.join(", ");
+    }
     
     bool isFinished() const {
         return status == DownloadStatus::Completed || 
@@ -59,4 +210,23 @@ struct DownloadItem {
     }
 };
 
+// A playlist, showcase or channel URL, expanded into one item per video
+struct DownloadGroup {
+    quint64 id = 0;     // Same sequence as item ids
+    QString url;
+    QString title;
+    bool expanding = true; // Entries are still being listed
+    int queued = 0;     // Items enqueued with this groupId
+    int completed = 0;
+    int failed = 0;     // Failed or cancelled
+    int skipped = 0;    // Already queued elsewhere or already downloaded
+    QString error;      // Listing error; the entries found before it are queued
+    
+    bool isFinished() const { return !expanding && completed + failed >= queued; }
+    int percent() const { return queued > 0 ? (completed + failed) * 100 / queued : (expanding ? 0 : 100); }
+};
+
+// Items cross the download engine thread through queued signals
+Q_DECLARE_METATYPE(DownloadItem)
+
 #endif // DOWNLOADITEM_H
@@ -1,34 +1,156 @@
 #ifndef DOWNLOADQUEUE_H
 #define DOWNLOADQUEUE_H
 
+#include <QHash>
 #include <QObject>
 #include <QQueue>
-#include <QProcess>
-#include <QTextEdit>
-#include <QProgressBar>
-#include <QGroupBox>
+#include <QList>
 #include <QTimer>
-#include <QMutex>
+#include <QSet>
 
+#include "bandwidthschedule.h"
 #include "downloaditem.h"
+#include "downloadengine.h"
+#include "hostthrottle.h"
+#include "metadataprefetcher.h"
+#include "playlistexpander.h"
+#include "schedulingpolicy.h"
+#include "timewindow.h"
+#include "mpscqueue.h"
 
+#include <atomic>
+#include <functional>
+
+class QThread;
+class LogModel;
 class ToolsManager;
+class MetadataCache;
+class DownloadArchive;
+class SyncStore;
+class QueueJournal;
+struct QueueJournalState;
 
+// Not thread-safe: every method must be called from the thread that owns the
+// queue, except submit(), which any thread may call.
 class DownloadQueue : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit DownloadQueue(QTextEdit *logOutput, QProgressBar *progressBar, QGroupBox *progressGroup, ToolsManager *toolsManager, QObject *parent = nullptr);
+    explicit DownloadQueue(LogModel *log, ToolsManager *toolsManager, QObject *parent = nullptr);
     ~DownloadQueue();
 
-    // Queue management
-    void addDownload(const QString &url, const QString &username, const QString &password, const QString &downloadDir);
+    // Queue management. Returns the item's id: a new one, the id of the pending or
+    // running item the same video was merged into, or 0 when the video is in the
+    // download archive and was not queued. Playlist, showcase and channel URLs
+    // return a group id instead; their videos are queued as they are listed.
+    quint64 addDownload(const QString &url, const QString &username, const QString &password, const QString &downloadDir, int priority = 0);
+    // Bulk enqueue: url, credentials, folder and priority are taken from each item.
+    // Logged, journaled and announced once for the whole batch. Returns one id
+    // per item, as addDownload() does.
+    QList<quint64> addDownloads(const QList<DownloadItem> &items);
+    // Thread-safe, lock-free enqueue for every producer that does not need the
+    // ids right away (control API, single-instance forwarding, batch runs,
+    // importers on other threads). Submissions are drained in batches on the
+    // owner thread through addDownloads(); `done`, if set, then gets the ids
+    // of its items there.
+    using SubmitCallback = std::function<void(const QList<quint64> &ids)>;
+    void submit(const DownloadItem &item);
+    void submit(const QList<DownloadItem> &items, const SubmitCallback &done = SubmitCallback());
     void startQueue();
-    void pauseQueue();
+    void pauseQueue();  // Stops dispatching and suspends running downloads
+    void resumeQueue();
     void clearQueue();
     void resetQueue(); // Complete reset including counters
-    void cancelCurrentDownload();
+    void cancelCurrentDownload(); // Cancels every running download
+    void cancelDownload(int slot);
+    // By id: pending items are finished as cancelled, running ones are stopped.
+    // A group id stops its listing and cancels all of its items.
+    bool cancelItem(quint64 id);
+    // Reorders a pending item; false if it is not pending
+    bool setItemPriority(quint64 id, int priority);
+    // Suspending a download frees its slot for the next queued item
+    bool pauseDownload(int slot);
+    bool resumeDownload(int slot);
+    
+    // Urgent lane: enqueue to first byte of urgent items, over the session
+    struct FirstByteStats {
+        int count = 0;
+        qint64 totalMs = 0;
+        qint64 maxMs = 0;
+        qint64 meanMs() const { return count > 0 ? totalMs / count : -1; }
+    };
+    FirstByteStats urgentFirstByteStats() const { return m_urgentFirstByte; }
+    int getPreemptionCount() const { return m_preemptionCount; }
+    
+    // Crash-safe persistence: restores the saved queue and journals every change
+    int enableJournal(const QString &directory);
+    
+    // Persistent metadata cache: re-queued links skip extraction while their
+    // entry is younger than `ttlSeconds`
+    void enableMetadataCache(const QString &directory, qint64 ttlSeconds);
+    const MetadataCache *metadataCache() const { return m_metadataCache; }
+    
+    // Persistent archive of downloaded videos (file at `path`): completed
+    // downloads are recorded and enqueuing them again is refused. Returns how
+    // many videos it holds, -1 if the file cannot be used.
+    int enableArchive(const QString &path);
+    const DownloadArchive *archive() const { return m_archive; }
+    // False: archived videos are downloaded again (still recorded)
+    void setSkipArchived(bool skip) { m_skipArchived = skip; }
+    bool isSkipArchived() const { return m_skipArchived; }
+    
+    // Incremental sync of playlists, showcases and channels: only entries
+    // newer than the watermark stored (file at `path`) by the last sync are listed
+    void enableSync(const QString &path);
+    bool isSyncEnabled() const { return m_syncStore != nullptr; }
+    
+    // Worker pool configuration
+    void setMaxConcurrentDownloads(int count);
+    int getMaxConcurrentDownloads() const { return m_maxConcurrent; }
+    // Merges (ffmpeg) running at once without holding a download slot;
+    // extra merges keep their slot, so the next fetch waits for them
+    void setMaxConcurrentMerges(int count);
+    int getMaxConcurrentMerges() const { return m_maxMerges; }
+    
+    // Resume mode: failed downloads with partial files are retried and continue where they stopped
+    void setResumeEnabled(bool enabled);
+    bool isResumeEnabled() const { return m_resumeEnabled; }
+    
+    // How many upcoming pending items get their metadata resolved ahead of
+    // time (title, duration, formats, size); 0 disables the prefetch
+    void setPrefetchDepth(int depth);
+    int getPrefetchDepth() const { return m_prefetchDepth; }
+    
+    // Order of the pending items within a priority (see SchedulingPolicy);
+    // items waiting `agingSeconds` go first whatever the policy
+    void setSchedulingPolicy(SchedulingPolicy::Kind kind);
+    SchedulingPolicy::Kind schedulingPolicy() const { return m_scheduler.kind(); }
+    void setSchedulingAging(qint64 seconds) { m_scheduler.setAgingSeconds(seconds); }
+    // FairShare weights, "folder=weight" entries
+    void setFolderWeights(const QStringList &entries) { m_scheduler.setFolderWeights(entries); }
+    // Mean seconds until the unfinished items complete under the policy at
+    // the current transfer rate, -1 while unknown
+    double expectedMeanCompletion() const;
+    
+    // Global bandwidth cap shared by the running downloads, by time of day;
+    // checked every minute and applied without restarting anything
+    void setBandwidthSchedule(const BandwidthSchedule &schedule);
+    qint64 currentBandwidthLimit() const { return m_bandwidthLimit; } // Bytes/s, 0 for none
+    
+    // Off-peak hours: outside the run window only urgent items start, and
+    // running transfers are checkpointed (stopped with their .part files
+    // kept) and resume when it opens again. Items may also carry their own
+    // notBefore/notAfter bounds; a pending item past notAfter fails.
+    void setRunWindow(const TimeWindow &window);
+    TimeWindow runWindow() const { return m_runWindow; }
+    bool isRunWindowOpen() const { return m_runWindow.contains(QDateTime::currentDateTime()); }
+    // Next time a window opens or closes for a queued item, invalid if none
+    QDateTime nextWindowChange() const { return m_windowWake; }
+    
+    // Sampling period of yt-dlp progress reports (bytes, speed, ETA)
+    void setProgressInterval(double seconds);
+    double getProgressInterval() const { return m_progressInterval; }
     
     // Status getters
     bool isRunning() const { return m_isRunning; }
@@ -36,57 +158,179 @@ public:
     int getCurrentIndex() const { return m_completedCount; }
     int getTotalCount() const { return m_totalCount; }
     int getQueueSize() const { return m_queue.size(); }
+    int getActiveCount() const;   // Running and suspended downloads
+    int getRunningCount() const;  // Downloads currently using a download slot
     
     // Current download info
     DownloadItem getCurrentDownload() const;
+    QList<DownloadItem> getActiveDownloads() const;
+    QList<DownloadItem> getPendingDownloads() const; // In expected dispatch order
+    bool findItem(quint64 id, DownloadItem *item) const;
     QList<DownloadItem> getCompletedDownloads() const { return m_completedDownloads; }
+    bool findGroup(quint64 id, DownloadGroup *group) const;
+    QList<DownloadGroup> getGroups() const { return m_groups.values(); }
 
 signals:
     void downloadStarted(const DownloadItem &item);
-    void downloadProgress(int percentage);
+    void downloadProgress(int percentage); // Aggregate over all active slots
+    void downloadsActiveChanged(bool active); // False once the last running download is gone
+    void slotProgress(int slot, int percentage);
+    void downloadItemUpdated(const DownloadItem &item); // Bytes, speed and ETA of a running download
+    void downloadMetadataReady(const DownloadItem &item); // A pending item's title, duration and size are known
+    void groupUpdated(const DownloadGroup &group); // Listed, queued or finished entries changed
+    void slotSuspendedChanged(int slot, bool suspended);
     void downloadCompleted(const DownloadItem &item);
     void downloadFailed(const DownloadItem &item, const QString &error);
     void queueFinished();
     void queueStatusChanged(int current, int total);
     void downloadAddedToQueue(int totalCount);
+    void scheduleEstimateChanged(double meanCompletionSeconds); // expectedMeanCompletion(), at most once a second
+    void urgentFirstByte(const DownloadItem &item, qint64 milliseconds);
 
 private slots:
     void processNextDownload();
-    void onDownloadFinished(int exitCode, QProcess::ExitStatus exitStatus);
-    void onDownloadOutput();
-    void onDownloadError();
+    void onEngineSnapshots(const QList<WorkerSnapshot> &snapshots);
+    void onEngineLogBatch(const QList<LogEntry> &entries);
+    void onWorkerRateLimited(int slot, const QString &url);
+    void onWorkerSuspendedChanged(int slot, bool suspended);
+    void onWorkerFinished(int slot, const DownloadItem &item, qint64 attemptReusedBytes, qint64 attemptTransferredBytes);
+    void compactJournal();
+    void drainSubmissions();
+    void onMetadataResolved(quint64 id, const MetadataPrefetcher::Metadata &metadata);
+    void onMetadataFailed(quint64 id, const QString &error, bool permanent);
+    void onGroupTitle(quint64 groupId, const QString &title, int count);
+    void onGroupEntries(quint64 groupId, const QList<DownloadItem> &items);
+    void onGroupListed(quint64 groupId, const QString &error);
+    void onSyncListed(quint64 groupId, const SyncWatermark &watermark, int newEntries, bool reachedKnown);
+    void applyBandwidthSchedule();
+    void onWindowTimer();
 
 private:
-    void updateProgressLabel();
-    void logMessage(const QString &message);
-    void startDownloadProcess(const DownloadItem &item);
-    void cleanupCurrentProcess();
-    
-    // UI references
-    QTextEdit *m_logOutput;
-    QProgressBar *m_progressBar;
-    QGroupBox *m_progressGroup;
+    void updateAggregateProgress();
+    void logMessage(const QString &message, quint64 itemId = 0);
+    void startDownload(int slot, const DownloadItem &item);
+    int findIdleSlot();
+    int nextDispatchableIndex() const;
+    int insertPending(const DownloadItem &item, bool front);
+    int pendingIndex(quint64 id) const;
+    // True if `url` is not to be queued: *id is the in-flight item it merges
+    // into (its priority raised to `priority`), or 0 if the video is archived
+    bool isDuplicate(const QString &url, int priority, quint64 *id);
+    void releaseInFlight(const DownloadItem &item);
+    quint64 addGroup(const DownloadItem &source);
+    void cancelGroup(quint64 groupId);
+    // Counts a finished item in its group
+    void updateGroup(const DownloadItem &item);
+    // Announces the group and logs its end once every entry is done
+    void reportGroup(const DownloadGroup &group);
+    void scheduleDispatch();
+    void setSlotSuspended(int slot, bool suspended);
+    // Checkpoints the lowest-priority transfers so waiting urgent items get a slot
+    void preemptForUrgent();
+    // Whether `item` may run at `now`: its own bounds, and the run window unless urgent
+    bool isInWindow(const DownloadItem &item, const QDateTime &now) const;
+    // Checkpoints transfers whose window closed and fails pending items past notAfter
+    void enforceWindows();
+    void expirePending(int index);
+    // Arms m_windowTimer for the next window change that matters to the queue
+    void scheduleWindowWake();
+    void schedulePrefetch();
+    void applyMetadata(DownloadItem &item, const MetadataPrefetcher::Metadata &metadata);
+    void logMetadataCacheStats();
+    void trimIdleSlots();
+    // Queues everything submitted so far; callbacks only run if `notify`
+    void takeSubmissions(bool notify);
+    QueueJournalState journalState() const;
+    void maybeCompactJournal();
+    
+    LogModel *m_log;
     ToolsManager *m_toolsManager;
     
     // Queue management
     QQueue<DownloadItem> m_queue;
     QList<DownloadItem> m_completedDownloads;
-    DownloadItem m_currentDownload;
+    quint64 m_nextId;
+    
+    // Duplicate detection: canonical video key -> pending or running item,
+    // and the archive of everything downloaded before (null until enableArchive())
+    QHash<QString, quint64> m_inFlight;
+    DownloadArchive *m_archive;
+    bool m_skipArchived;
+    
+    // Write-ahead journal (null until enableJournal())
+    QueueJournal *m_journal;
+    QTimer *m_journalTimer;
+    
+    // Worker pool - one yt-dlp process per slot, run by the engine thread.
+    // m_slots mirrors the engine: busy/suspended are set here when a request
+    // is sent, items are refreshed from the engine snapshots.
+    QThread *m_engineThread;
+    DownloadEngine *m_engine;
+    QList<WorkerSnapshot> m_slots;
+    int m_maxConcurrent;
+    int m_maxMerges;
+    QSet<quint64> m_discardedIds; // Cancelled by resetQueue(), ignored when they finish
+    
+    // Cross-thread submissions waiting for the owner thread
+    struct Submission {
+        QList<DownloadItem> items;
+        SubmitCallback done;
+    };
+    MpscQueue<Submission> m_submissions;
+    std::atomic<bool> m_drainScheduled;
+    
+    // Playlists, showcases and channels: listed into items sharing a group id
+    PlaylistExpander *m_expander;
+    QHash<quint64, DownloadGroup> m_groups;
+    // Watermarks of synced groups, stored once every new entry is downloaded
+    // (null until enableSync())
+    SyncStore *m_syncStore;
+    QHash<quint64, SyncWatermark> m_pendingWatermarks;
     
-    // Process management
-    QProcess *m_currentProcess;
-    QMutex m_queueMutex;
+    // Background metadata resolution of the next m_prefetchDepth pending items
+    MetadataPrefetcher *m_prefetcher;
+    int m_prefetchDepth;
+    MetadataCache *m_metadataCache; // Null until enableMetadataCache()
+    QSet<quint64> m_sizeOnlyIds;    // Resolved past the prefetch depth, for the policy's sizes
+    int m_loggedCacheLookups;
+    
+    // Per-host AIMD concurrency limits
+    HostThrottle m_hostThrottle;
+    QTimer *m_throttleTimer;
+    
+    // Which pending item starts next, and the completion estimate under it
+    SchedulingPolicy m_scheduler;
+    double m_slotRate;           // Last known bytes/s of one running download
+    QDateTime m_lastEstimateTime;
+    
+    // Urgent lane: transfers checkpointed for an urgent item this session
+    int m_preemptionCount;
+    FirstByteStats m_urgentFirstByte;
+    
+    // Bandwidth cap in force and the schedule it comes from
+    BandwidthSchedule m_bandwidthSchedule;
+    qint64 m_bandwidthLimit;
+    QTimer *m_bandwidthTimer;
+    
+    // Time windows: items stopped at window close are requeued, not finished
+    TimeWindow m_runWindow;
+    QSet<quint64> m_checkpointIds;
+    QTimer *m_windowTimer;
+    QDateTime m_windowWake;
+    QDateTime m_loggedWake; // Wake time last announced while everything waits
     
     // Status tracking
     bool m_isRunning;
     bool m_isPaused;
     int m_completedCount;
     int m_totalCount;
-    bool m_hasCurrentDownload;
     
-    // Fragment-based progress tracking for YouTube downloads
-    int m_totalFragments;
-    int m_currentFragment;
+    // Resume statistics for the session
+    bool m_resumeEnabled;
+    qint64 m_totalReusedBytes;
+    qint64 m_totalTransferredBytes;
+    
+    double m_progressInterval;
 };
 
 #endif // DOWNLOADQUEUE_H
@@ -0,0 +1,132 @@
+#ifndef DOWNLOADWORKER_H
+#define DOWNLOADWORKER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include "downloaditem.h"
+#include "lineassembler.h"
+#include "outputparser.h"
+
+class QThreadPool;
+
+// One slot of the DownloadQueue worker pool: owns a single yt-dlp process
+// and tracks the state, progress and cancellation of the item it runs.
+// yt-dlp writes into a per-URL staging folder; once it exits, the output is
+// verified and moved to the download folder on the disk pool, so the slot
+// stays busy (but off the network) until the item is really finished.
+class DownloadWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DownloadWorker(int slot, QObject *parent = nullptr);
+    ~DownloadWorker();
+
+    void start(const DownloadItem &item, const QString &ytDlpPath, const QString &ffmpegPath);
+    // Non-blocking: interrupts yt-dlp (keeping .part files intact) and only
+    // escalates to terminate/kill if it does not exit in time
+    void cancel();
+    // Suspends / continues the running yt-dlp process and its children
+    bool pause();
+    bool resume();
+    // Bandwidth duty cycle: stops / continues the process like pause() but
+    // keeps the slot (no suspendedChanged); a user pause takes precedence
+    bool setThrottled(bool throttled);
+    
+    // Continue .part files left by previous attempts instead of restarting them
+    void setResumeEnabled(bool enabled) { m_resumeEnabled = enabled; }
+    // Minimum seconds between two progress reports from yt-dlp
+    void setProgressInterval(double seconds) { m_progressInterval = seconds; }
+    // Thread pool for the verify and move stages (runs them inline when null)
+    void setDiskPool(QThreadPool *pool) { m_diskPool = pool; }
+    // MetadataCache folder that completed downloads add their info JSON to; empty disables
+    void setMetadataCacheDir(const QString &directory) { m_metadataCacheDir = directory; }
+    
+    // Where yt-dlp writes the item's files before they are verified and moved
+    static QString stagingDir(const DownloadItem &item);
+    // yt-dlp format selection, shared with the metadata prefetch
+    static const char FORMAT_SELECTOR[];
+    // Credentials and cookies yt-dlp needs to reach the item's site
+    static QStringList accessArguments(const DownloadItem &item);
+
+    int slot() const { return m_slot; }
+    bool isBusy() const { return m_busy; }
+    bool isSuspended() const { return m_suspended; }
+    bool isRunning() const { return m_busy && !m_suspended; }
+    bool isThrottled() const { return m_throttled; }
+    int progress() const { return m_item.progress; }
+    const DownloadItem &item() const { return m_item; }
+    
+    // Resume accounting for the last attempt only (the item accumulates all attempts)
+    qint64 attemptReusedBytes() const { return m_item.reusedBytes - m_startReusedBytes; }
+    qint64 attemptTransferredBytes() const { return m_item.transferredBytes - m_startTransferredBytes; }
+
+signals:
+    void progressChanged(int slot, int percentage);
+    void logMessage(int slot, const QString &message);
+    void rateLimited(int slot);
+    void suspendedChanged(int slot, bool suspended);
+    void stageChanged(int slot, DownloadStage stage);
+    void finished(int slot, const DownloadItem &item);
+
+private slots:
+    void onProcessOutput();
+    void onProcessError();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessErrorOccurred(QProcess::ProcessError error);
+    void onCancelTimeout();
+
+private:
+    QStringList buildArguments(const DownloadItem &item, const QString &ffmpegPath);
+    void cleanupProcess();
+    void handleOutputLine(QByteArrayView line);
+    void handleErrorLine(QByteArrayView line);
+    void handleProgress(const OutputParser::ProgressSample &sample);
+    void beginDestination(const QString &path);
+    void finishDestination();
+    void enterStage(DownloadStage stage);
+    void closeStage();
+    void finalizeOutput();
+    void onOutputFinalized(const QStringList &files, const QString &error);
+    void finish();
+    static qint64 bytesOnDisk(const QString &path);
+    static QStringList verifyStaging(const QString &staging, QString *error);
+    static QStringList moveOutput(const QStringList &files, const QString &targetDir, QString *error);
+
+    int m_slot;
+    bool m_busy;
+    bool m_cancelRequested;
+    bool m_resumeEnabled;
+    bool m_suspended;
+    bool m_throttled;
+    double m_progressInterval;
+    DownloadItem m_item;
+    QProcess *m_process;
+    LineAssembler m_stdoutLines;
+    LineAssembler m_stderrLines;
+    OutputParser m_parser;
+    
+    // Cancellation escalation: interrupt -> terminate -> kill
+    QTimer *m_cancelTimer;
+    int m_cancelStage;
+
+    // Bytes of formats already finished (video before audio, etc.)
+    qint64 m_completedFormatBytes;
+    
+    // File yt-dlp is currently writing and the byte offset it resumed from
+    QString m_currentDestination;
+    qint64 m_currentResumeOffset;
+    qint64 m_startReusedBytes;
+    qint64 m_startTransferredBytes;
+    
+    QElapsedTimer m_stageTimer; // Time in m_item.stage
+    QThreadPool *m_diskPool;
+    QString m_metadataCacheDir;
+};
+
+#endif // DOWNLOADWORKER_H
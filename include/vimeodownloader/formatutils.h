@@ -0,0 +1,17 @@
+#ifndef FORMATUTILS_H
+#define FORMATUTILS_H
+
+#include <QString>
+
+class FormatUtils
+{
+public:
+    // "1.5 GiB", "320.0 KiB", "12 B"
+    static QString formatBytes(qint64 bytes);
+    // "2.1 MiB/s"
+    static QString formatSpeed(double bytesPerSecond);
+    // "01:02:03" or "02:03", "--:--" when unknown (negative)
+    static QString formatDuration(qint64 seconds);
+};
+
+#endif // FORMATUTILS_H
@@ -0,0 +1,54 @@
+#ifndef HOSTTHROTTLE_H
+#define HOSTTHROTTLE_H
+
+#include <QHash>
+#include <QString>
+#include <QDateTime>
+
+// Per-host concurrency controller with AIMD (additive increase, multiplicative
+// decrease) limits. Successful downloads raise a host's limit by one slot per
+// "window" of completions; a rate-limit signature halves it and puts the host
+// into a short cooldown before new downloads are started against it.
+class HostThrottle
+{
+public:
+    HostThrottle();
+
+    void setMaxLimit(int maxLimit);
+    void setInitialLimit(int initialLimit) { m_initialLimit = qMax(1, initialLimit); }
+
+    bool canStart(const QString &host) const;
+    // Whether a download could start on `host` once one of its running ones stops
+    bool canStartReplacing(const QString &host) const;
+    void onStarted(const QString &host);
+    void onFinished(const QString &host, bool success);
+    // A suspended download does not count against its host until resumed
+    void onSuspended(const QString &host);
+    void onResumed(const QString &host);
+    // Returns true if the limit was actually reduced (once per burst of errors)
+    bool onRateLimited(const QString &host);
+
+    int limit(const QString &host) const;
+    int activeCount(const QString &host) const;
+    // Milliseconds until the earliest cooldown ends, or -1 if no host is cooling down
+    qint64 msUntilNextUnblock() const;
+
+    static bool isRateLimitMessage(const QString &text);
+
+private:
+    struct HostState {
+        double limit = 1.0;
+        int active = 0;
+        int backoffLevel = 0;
+        QDateTime blockedUntil;
+        QDateTime lastDecrease;
+    };
+
+    HostState &state(const QString &host);
+
+    QHash<QString, HostState> m_hosts;
+    int m_initialLimit;
+    int m_maxLimit;
+};
+
+#endif // HOSTTHROTTLE_H
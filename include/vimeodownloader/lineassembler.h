@@ -0,0 +1,46 @@
+#ifndef LINEASSEMBLER_H
+#define LINEASSEMBLER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+// Reassembles complete lines from the arbitrary chunks QProcess delivers.
+// A line may be split across reads; both '\n' and '\r' end a line. The
+// internal buffer is reused between reads, so steady-state parsing does
+// not allocate.
+class LineAssembler
+{
+public:
+    // Calls `onLine(QByteArrayView)` for every line completed by `chunk`,
+    // without terminators and skipping empty ones. Views are only valid
+    // during the call.
+    template <typename Callback>
+    void append(QByteArrayView chunk, Callback &&onLine)
+    {
+        m_pending.append(chunk);
+        
+        const char *data = m_pending.constData();
+        qsizetype start = 0;
+        for (qsizetype i = 0; i < m_pending.size(); ++i) {
+            char c = data[i];
+            if (c == '\n' || c == '\r') {
+                if (i > start) {
+                    onLine(QByteArrayView(data + start, i - start));
+                }
+                start = i + 1;
+            }
+        }
+        
+        // Keeps the capacity, only the unterminated tail is moved to the front
+        m_pending.remove(0, start);
+    }
+    
+    // Returns (and clears) an unterminated trailing line, e.g. once the process exits
+    QByteArray takeRemainder();
+    void clear() { m_pending.resize(0); }
+
+private:
+    QByteArray m_pending;
+};
+
+#endif // LINEASSEMBLER_H
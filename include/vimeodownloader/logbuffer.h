@@ -0,0 +1,69 @@
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+
+#include <QDateTime>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+enum class LogLevel {
+    Debug,    // Per-sample progress lines
+    Info,
+    Warning,
+    Error
+};
+
+struct LogEntry {
+    QDateTime timestamp;
+    LogLevel level;
+    QString source;     // "app", "queue", "tools", "yt-dlp"
+    quint64 itemId;     // DownloadItem::id, 0 when not tied to a download
+    QString message;
+    
+    LogEntry()
+        : level(LogLevel::Info)
+        , itemId(0)
+    {}
+    
+    LogEntry(LogLevel level, const QString &source, const QString &message, quint64 itemId = 0)
+        : timestamp(QDateTime::currentDateTime())
+        , level(level)
+        , source(source)
+        , itemId(itemId)
+        , message(message)
+    {}
+    
+    // Level guessed from the conventions of existing messages ("ERROR: ...", "✗ ...")
+    static LogLevel levelForMessage(const QString &message);
+    static QString levelName(LogLevel level);
+};
+
+// Entries cross the download engine thread through queued signals
+Q_DECLARE_METATYPE(LogEntry)
+
+// Fixed-capacity ring of log entries: once full, the oldest entries are
+// overwritten, so memory stays bounded however long the app runs.
+class LogBuffer
+{
+public:
+    explicit LogBuffer(int capacity);
+    
+    // Drops the oldest entry first when the buffer is full
+    void append(const LogEntry &entry);
+    // Forgets the `count` oldest entries
+    void removeFirst(int count);
+    void clear();
+    
+    // 0 is the oldest entry
+    const LogEntry &at(int index) const { return m_entries.at((m_head + index) % m_entries.size()); }
+    int size() const { return m_size; }
+    int capacity() const { return m_entries.size(); }
+    bool isFull() const { return m_size == m_entries.size(); }
+    
+private:
+    QVector<LogEntry> m_entries;
+    int m_head;  // Index of the oldest entry
+    int m_size;
+};
+
+#endif // LOGBUFFER_H
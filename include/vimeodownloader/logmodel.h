@@ -0,0 +1,83 @@
+#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QMap>
+#include <QSortFilterProxyModel>
+
+#include "logbuffer.h"
+
+class LogSink;
+
+// List model over a LogBuffer. Appending past the capacity removes the
+// oldest rows, so views only ever hold a bounded number of rows and (with
+// uniform item sizes) only lay out the visible ones.
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        TimestampRole = Qt::UserRole + 1,
+        LevelRole,
+        SourceRole,
+        ItemIdRole,
+        MessageRole
+    };
+
+    explicit LogModel(int capacity, QObject *parent = nullptr);
+
+    void append(LogLevel level, const QString &source, const QString &message, quint64 itemId = 0);
+    // Source-level convenience: the level is derived from the message text
+    void append(const QString &source, const QString &message, quint64 itemId = 0);
+    void append(const LogEntry &entry);
+    void appendBatch(const QList<LogEntry> &entries);
+    void clear();
+
+    // Every appended entry is also handed to `sink` (not owned), nullptr to stop
+    void setSink(LogSink *sink) { m_sink = sink; }
+
+    const LogEntry &entry(int row) const { return m_buffer.at(row); }
+    int capacity() const { return m_buffer.capacity(); }
+
+    // Human readable name of each download seen in the log, for filtering
+    void setItemLabel(quint64 itemId, const QString &label);
+    void setItemLabels(const QMap<quint64, QString> &labels); // One change notification
+    QMap<quint64, QString> itemLabels() const { return m_itemLabels; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+signals:
+    void itemLabelsChanged();
+
+private:
+    LogBuffer m_buffer;
+    LogSink *m_sink;
+    QMap<quint64, QString> m_itemLabels;
+};
+
+// Level / download filter on top of LogModel
+class LogFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit LogFilterModel(QObject *parent = nullptr);
+
+    void setMinimumLevel(LogLevel level);
+    LogLevel minimumLevel() const { return m_minimumLevel; }
+    // 0 shows every download
+    void setItemId(quint64 itemId);
+    quint64 itemId() const { return m_itemId; }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    LogLevel m_minimumLevel;
+    quint64 m_itemId;
+};
+
+#endif // LOGMODEL_H
@@ -0,0 +1,66 @@
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+#include "logbuffer.h"
+
+class QThread;
+
+// Persistent log: entries are written as JSON lines by a background thread.
+// write() only appends to an in-memory queue under a short lock, so producers
+// (GUI thread, download engine) never wait for the disk. The writer drains
+// the queue in batches, rotates the file once it reaches the size limit and
+// optionally gzips the rotated files.
+//
+// Files (inside `directory`):
+//   vimeodownloader.jsonl          - current file
+//   vimeodownloader.1.jsonl[.gz]   - most recent rotated file, up to maxFiles
+class LogSink
+{
+public:
+    struct Options {
+        qint64 maxFileSize = 10 * 1024 * 1024;
+        int maxFiles = 5;           // Rotated files kept besides the current one
+        bool compress = true;       // gzip rotated files
+        int maxPending = 100000;    // Entries queued before new ones are dropped
+        int flushIntervalMs = 500;  // Upper bound on how long an entry waits in memory
+    };
+
+    LogSink(const QString &directory, const Options &options);
+    ~LogSink(); // Writes whatever is still queued
+
+    void write(const LogEntry &entry);
+    void write(const QList<LogEntry> &entries);
+
+    QString currentFilePath() const;
+
+private:
+    void run();
+    void writeBatch(const QList<LogEntry> &entries, int dropped);
+    bool openCurrentFile();
+    void rotate();
+    QString rotatedFilePath(int index, bool compressed) const;
+    static QByteArray toJsonLine(const LogEntry &entry);
+    static bool gzipFile(const QString &sourcePath, const QString &targetPath);
+
+    QString m_directory;
+    Options m_options;
+    QThread *m_thread;
+
+    // Shared with producers
+    QMutex m_mutex;
+    QWaitCondition m_wakeUp;
+    QList<LogEntry> m_pending;
+    int m_dropped;
+    bool m_stopping;
+
+    // Writer thread only
+    QFile m_file;
+};
+
+#endif // LOGSINK_H
@@ -0,0 +1,37 @@
+#ifndef LOGVIEW_H
+#define LOGVIEW_H
+
+#include <QWidget>
+
+class QComboBox;
+class QListView;
+class LogModel;
+class LogFilterModel;
+
+// Log panel: a list view over LogModel with level and download filters.
+// Rows have a uniform height so only the visible ones are laid out, and the
+// view follows new entries while it is scrolled to the bottom.
+class LogView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LogView(LogModel *model, QWidget *parent = nullptr);
+
+private slots:
+    void onLevelChanged(int index);
+    void onDownloadChanged(int index);
+    void refreshDownloadFilter();
+    void onRowsAboutToBeInserted();
+    void onRowsInserted();
+
+private:
+    LogModel *m_model;
+    LogFilterModel *m_filter;
+    QListView *m_listView;
+    QComboBox *m_levelCombo;
+    QComboBox *m_downloadCombo;
+    bool m_followTail;
+};
+
+#endif // LOGVIEW_H
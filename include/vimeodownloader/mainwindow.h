@@ -8,12 +8,14 @@
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QProgressBar>
-#include <QTextEdit>
 #include <QGroupBox>
 #include <QSettings>
 
 class ToolsManager;
 class DownloadQueue;
+class LogModel;
+class LogView;
+class LogSink;
 
 QT_BEGIN_NAMESPACE
 QT_END_NAMESPACE
@@ -26,6 +28,10 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+public slots:
+    // URLs from the command line or a later launch; an empty list only raises the window
+    void openExternalUrls(const QStringList &urls);
+
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override;
 
@@ -39,7 +45,9 @@ private slots:
     void onDownloadStarted();
     void onDownloadCompleted();
     void onQueueStatusChanged(int current, int total);
+    void onDownloadsActiveChanged(bool active);
     void onDownloadAddedToQueue(int totalCount);
+    void onScheduleEstimateChanged(double meanCompletionSeconds);
     void onCancelClicked();
     void onLogToggleClicked();
     void onSettingsToggleClicked();
@@ -57,6 +65,7 @@ private:
     bool isVimeoUrl(const QString &url) const;
     bool isValidDownloadPath(const QString &path) const;
     bool shouldShowSettingsExpanded();
+    void enqueueExternalUrls();
     void setInitialSettingsState();
     
     // UI Components
@@ -78,12 +87,15 @@ private:
     
     QGroupBox *m_logGroup;
     QVBoxLayout *m_logLayout;
-    QTextEdit *m_logOutput;
+    LogView *m_logView;
+    LogModel *m_logModel;
+    LogSink *m_logSink;
     bool m_logExpanded;
 
     QGroupBox *m_settingsGroup;
     QVBoxLayout *m_settingsLayout;
     bool m_settingsExpanded;
+    QStringList m_pendingExternalUrls; // Received before the tools check finished
     QHBoxLayout *m_credentialsLayout;
     QHBoxLayout *m_folderLayout;
     QHBoxLayout *m_toolsLayout;
@@ -0,0 +1,58 @@
+#ifndef METADATACACHE_H
+#define METADATACACHE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+
+// Persistent cache of resolved video metadata, keyed by canonical site and
+// video id (UrlUtils::canonicalVideoKey), so re-queuing the same link does
+// not extract it again. Each entry is two files: the yt-dlp info JSON, which
+// a download loads with --load-info-json, and a small summary read on
+// lookup. Entries older than the TTL count as misses and are deleted.
+//
+// store() only touches files and may run on any thread; lookups and the
+// hit/miss counters belong to the thread that owns the cache.
+class MetadataCache
+{
+public:
+    static constexpr qint64 DEFAULT_TTL_S = 6 * 3600;
+
+    struct Entry {
+        QString title;
+        int duration = -1;        // Seconds
+        qint64 estimatedBytes = 0;
+        QString formatId;         // e.g. "hls-1080p+dash-audio"
+        QString infoJsonPath;
+        QDateTime fetchedTime;
+    };
+
+    explicit MetadataCache(const QString &directory, qint64 ttlSeconds = DEFAULT_TTL_S);
+
+    QString directory() const { return m_directory; }
+    qint64 ttl() const { return m_ttl; }
+
+    bool lookup(const QString &url, Entry *entry);
+    bool store(const QString &url, const QByteArray &infoJson, Entry *entry) { return store(m_directory, url, infoJson, entry); }
+    // Saves the info JSON of the URL's video in `directory`; false if it is not a single video
+    static bool store(const QString &directory, const QString &url, const QByteArray &infoJson, Entry *entry);
+    void remove(const QString &url);
+    // Deletes expired entries, returns how many
+    int prune();
+
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+    // Title, duration, selected format and size of a single-video info JSON
+    static bool parseInfo(const QByteArray &json, Entry *entry);
+
+private:
+    static QString entryPath(const QString &directory, const QString &url, const char *suffix);
+
+    QString m_directory;
+    qint64 m_ttl;
+    int m_hits;
+    int m_misses;
+};
+
+#endif // METADATACACHE_H
@@ -0,0 +1,69 @@
+#ifndef METADATAPREFETCHER_H
+#define METADATAPREFETCHER_H
+
+#include <QHash>
+#include <QObject>
+#include <QProcess>
+#include <QSet>
+#include <QString>
+#include <QTemporaryDir>
+
+#include "downloaditem.h"
+#include "metadatacache.h"
+
+// Resolves upcoming queue items ahead of their download with
+// `yt-dlp --dump-single-json`: title, duration, the selected formats and
+// their sizes. The info JSON is kept on disk (in the metadata cache when one
+// is set) so the download itself can start with --load-info-json instead of
+// extracting the page again. Cache hits need no process at all.
+//
+// At most MAX_PROCESSES resolutions run at once; every item is tried once.
+class MetadataPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_PROCESSES = 2;
+    // Milliseconds before a yt-dlp resolution is given up
+    static constexpr int TIMEOUT_MS = 60000;
+
+    using Metadata = MetadataCache::Entry;
+
+    explicit MetadataPrefetcher(QObject *parent = nullptr);
+    ~MetadataPrefetcher();
+
+    // Consulted before running yt-dlp and filled with every resolution (not owned)
+    void setCache(MetadataCache *cache) { m_cache = cache; }
+
+    // Starts resolving the item; false if it was already tried or every process is busy
+    bool prefetch(const DownloadItem &item, const QString &ytDlpPath);
+    // Cache only, looked up once per item: true (and delivered like prefetch())
+    // on a hit, false on a miss without running anything
+    bool resolveCached(const DownloadItem &item);
+    bool hasCapacity() const { return m_processes.size() < MAX_PROCESSES; }
+    bool wasTried(quint64 id) const { return m_tried.contains(id); }
+    // Stops a running resolution (the item started downloading or left the queue)
+    void cancel(quint64 id);
+    void cancelAll();
+    // Drops the item's info JSON and its tried mark
+    void forget(quint64 id);
+
+    // Errors after which downloading is pointless (removed, private, 404...)
+    static bool isPermanentError(const QString &message);
+
+signals:
+    void resolved(quint64 id, const MetadataPrefetcher::Metadata &metadata);
+    void failed(quint64 id, const QString &error, bool permanent);
+
+private:
+    void onProcessFinished(QProcess *process, int exitCode, QProcess::ExitStatus exitStatus);
+    void release(QProcess *process);
+
+    MetadataCache *m_cache;
+    QTemporaryDir m_infoDir; // Info JSON of uncached resolutions
+    QHash<QProcess *, quint64> m_processes;
+    QSet<quint64> m_tried;
+    QSet<quint64> m_cacheMisses; // resolveCached() found nothing
+};
+
+#endif // METADATAPREFETCHER_H
@@ -0,0 +1,139 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded multi-producer single-consumer queue (Vyukov's intrusive MPSC
+// algorithm). push() never blocks or retries: one atomic exchange links the
+// node. pop() must only be called from the single consumer thread.
+//
+// Nodes are recycled instead of going back to the allocator, whose locks
+// would otherwise be the contended part of every push: the consumer puts
+// drained nodes on a free list, and a producer whose own thread-local cache
+// is empty takes the whole list with one exchange. Only a producer that
+// finds both empty allocates. Cached nodes are freed when their thread exits.
+//
+// A push that is halfway through (exchanged but not yet linked) is not
+// visible to pop() yet; whoever pushed is expected to wake the consumer
+// after push() returns, so nothing is missed.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+        : m_head(&m_stub)
+        , m_tail(&m_stub)
+        , m_free(nullptr)
+    {
+        m_stub.next.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue()
+    {
+        T discarded;
+        while (pop(discarded)) {
+        }
+        if (m_tail != &m_stub) {
+            delete m_tail;
+        }
+        deleteChain(m_free.load(std::memory_order_acquire));
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // Any thread
+    void push(T value)
+    {
+        Node *node = takeNode();
+        node->value = std::move(value);
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node *previous = m_head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer thread only. False when empty (or the next push is not linked yet)
+    bool pop(T &value)
+    {
+        Node *tail = m_tail;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+
+        // `next` becomes the new stub; its value is moved out
+        value = std::move(next->value);
+        m_tail = next;
+        if (tail != &m_stub) {
+            recycle(tail);
+        }
+        return true;
+    }
+
+    // Consumer thread only
+    bool isEmpty() const
+    {
+        return m_tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node *> next { nullptr };
+        T value;
+    };
+
+    // Spare nodes of one producer thread, linked through `next`. Shared by
+    // every queue of the same T: a node is just memory until it is pushed.
+    struct NodeCache {
+        Node *nodes = nullptr;
+        ~NodeCache() { deleteChain(nodes); }
+    };
+
+    static NodeCache &nodeCache()
+    {
+        thread_local NodeCache cache;
+        return cache;
+    }
+
+    static void deleteChain(Node *node)
+    {
+        while (node) {
+            Node *next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+
+    // Any thread
+    Node *takeNode()
+    {
+        NodeCache &cache = nodeCache();
+        if (!cache.nodes) {
+            // Producers only ever take the whole list, so there is no ABA
+            cache.nodes = m_free.exchange(nullptr, std::memory_order_acquire);
+            if (!cache.nodes) {
+                return new Node();
+            }
+        }
+        Node *node = cache.nodes;
+        cache.nodes = node->next.load(std::memory_order_relaxed);
+        return node;
+    }
+
+    // Consumer thread only; the moved-from value stays until the node is reused
+    void recycle(Node *node)
+    {
+        Node *top = m_free.load(std::memory_order_relaxed);
+        do {
+            node->next.store(top, std::memory_order_relaxed);
+        } while (!m_free.compare_exchange_weak(top, node, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    alignas(64) std::atomic<Node *> m_head; // Producers
+    alignas(64) Node *m_tail;               // Consumer
+    alignas(64) std::atomic<Node *> m_free; // Drained nodes, consumer to producers
+    Node m_stub;
+};
+
+#endif // MPSCQUEUE_H
@@ -0,0 +1,73 @@
+#ifndef OUTPUTPARSER_H
+#define OUTPUTPARSER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+// Incremental parser for yt-dlp stdout, one instance per process. It works on
+// complete raw lines (see LineAssembler) and never allocates: numbers are
+// parsed in place and paths are returned as views into the parsed line.
+//
+// Recognized lines:
+//   [vdprogress] <status> <downloaded> <total> <estimate> <speed> <eta> <frag> <frags>
+//   [download]  45.2% of ~ 123.45MiB at 1.23MiB/s ETA 00:30 (frag 3/10)
+//   [hlsnative] Total fragments: 10
+//   [download] Destination: /path/to/file.mp4
+//   [download] Resuming download at byte 1234
+//   [Merger] Merging formats into "/path/to/file.mp4"
+//   [FixupM3u8] Fixing MPEG-TS in MP4 container of "/path/to/file.mp4"
+class OutputParser
+{
+public:
+    enum LineType {
+        Other,
+        Progress,
+        TotalFragments,
+        Destination,
+        ResumeOffset,
+        Merge,
+        PostProcess, // ffmpeg fixups run after the transfer
+        LineTypeCount
+    };
+
+    // Last progress sample; unknown values are -1
+    struct ProgressSample {
+        bool finished = false;
+        bool structured = false; // From the progress template (bytes/speed/eta are exact)
+        qint64 downloadedBytes = -1;
+        qint64 totalBytes = -1;   // Exact size, or yt-dlp's estimate
+        double speed = -1.0;      // Bytes per second
+        int eta = -1;             // Seconds
+        int fragmentIndex = -1;
+        int fragmentCount = -1;
+        double percent = -1.0;    // Of the current file
+    };
+
+    // Value for yt-dlp's --progress-template producing the [vdprogress] lines
+    static const char PROGRESS_TEMPLATE[];
+
+    OutputParser();
+
+    // Forget everything about the previous process
+    void reset();
+
+    LineType parseLine(QByteArrayView line);
+
+    const ProgressSample &progress() const { return m_progress; }
+    int totalFragments() const { return m_totalFragments; }
+    qint64 resumeOffset() const { return m_resumeOffset; }
+    // Valid until the parsed line's buffer changes
+    QByteArrayView destination() const { return m_destination; }
+    QByteArrayView destinationFileName() const;
+
+private:
+    bool parseStructuredProgress(QByteArrayView fields);
+    bool parseHumanProgress(QByteArrayView text);
+
+    ProgressSample m_progress;
+    int m_totalFragments;
+    qint64 m_resumeOffset;
+    QByteArrayView m_destination;
+};
+
+#endif // OUTPUTPARSER_H
@@ -0,0 +1,102 @@
+#ifndef PLAYLISTEXPANDER_H
+#define PLAYLISTEXPANDER_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+
+#include "downloaditem.h"
+#include "syncstore.h"
+
+// Lists the videos of playlists, showcases and channels with
+// `yt-dlp --flat-playlist --dump-single-json -I start:end`, one page of
+// PAGE_SIZE entries per process. The first page gives the title and, when
+// the site reports it, the entry count; the remaining pages are then listed
+// in parallel (or speculatively, a few pages ahead, when the count is
+// unknown). Pages are delivered in playlist order as soon as every earlier
+// page is in. Collections nested in a collection (channel tabs) are listed
+// into the same group.
+//
+// Incremental sync: given the watermark of the previous sync, pages are
+// listed one at a time and listing stops at the first entry the watermark
+// knows (same key, or uploaded before its newest entry), so only the new
+// entries above it are delivered. If the site's entry count shows more new
+// entries than were found (a collection not sorted newest first), the rest
+// is listed in full after all. The new watermark is reported at the end.
+//
+// At most MAX_PROCESSES listings run at once, over all groups.
+class PlaylistExpander : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_PROCESSES = 4;
+    static constexpr int PAGE_SIZE = 100;
+    // Milliseconds before a page listing is given up
+    static constexpr int TIMEOUT_MS = 120000;
+
+    explicit PlaylistExpander(QObject *parent = nullptr);
+    ~PlaylistExpander();
+
+    // Lists `source.url`; entries inherit its credentials, folder and priority.
+    // With `previous` (empty on the first sync) the listing is incremental.
+    void expand(quint64 groupId, const DownloadItem &source, const QString &ytDlpPath,
+                const SyncWatermark *previous = nullptr);
+    void cancel(quint64 groupId);
+    void cancelAll();
+    bool isBusy() const { return !m_jobs.isEmpty(); }
+
+signals:
+    // First page of the top-level collection; `count` is -1 when unknown
+    void titleResolved(quint64 groupId, const QString &title, int count);
+    // Items with url, title, duration and groupId set, in playlist order
+    void entriesReady(quint64 groupId, const QList<DownloadItem> &items);
+    // Incremental listings, right before finished(): the watermark to store
+    // once the new entries are downloaded
+    void syncListed(quint64 groupId, const SyncWatermark &watermark, int newEntries, bool reachedKnown);
+    // Every page is in; `error` is empty unless a page could not be listed
+    void finished(quint64 groupId, const QString &error);
+
+private:
+    struct Job {
+        quint64 groupId = 0;
+        DownloadItem source;
+        QString ytDlpPath;
+        bool nested = false;   // A tab or sub-playlist of the group's URL
+        bool sync = false;     // Sequential pages, stops at known content
+        int count = -1;        // Entries reported by the site
+        int lastPage = -1;     // Known once the count or a short page is seen
+        int nextPage = 0;      // Next page to start
+        int deliveredPages = 0;
+        QMap<int, QList<DownloadItem>> done; // Pages waiting for an earlier one
+        QHash<QProcess *, int> running;      // Process -> page
+        QString error;
+    };
+
+    struct SyncProgress {
+        SyncWatermark previous;
+        SyncWatermark next;
+        int newEntries = 0;
+        bool reachedKnown = false;
+    };
+
+    void addJob(quint64 groupId, const DownloadItem &source, const QString &ytDlpPath, bool nested);
+    void launchPages();
+    bool wantsPage(const Job &job) const;
+    void startPage(int jobId, Job &job);
+    void onPageFinished(QProcess *process, int exitCode, QProcess::ExitStatus exitStatus);
+    void deliverPages(Job &job);
+    void finishJobIfDone(int jobId);
+    void release(QProcess *process);
+
+    int m_nextJobId;
+    QMap<int, Job> m_jobs;              // Ordered: earlier jobs get processes first
+    QHash<QProcess *, int> m_processes; // Process -> job
+    QHash<quint64, QString> m_errors;   // First listing error of each group
+    QHash<quint64, SyncProgress> m_syncs; // Incremental listings by group
+};
+
+#endif // PLAYLISTEXPANDER_H
@@ -0,0 +1,77 @@
+#ifndef QUEUEJOURNAL_H
+#define QUEUEJOURNAL_H
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "downloaditem.h"
+
+// Queue contents rebuilt from (or written to) the journal
+struct QueueJournalState {
+    QList<DownloadItem> pending;   // Interrupted downloads first, then by enqueue order
+    QList<DownloadItem> finished;
+    quint64 nextId = 1;
+    int interruptedCount = 0;
+};
+
+// Crash-safe persistence for DownloadQueue: an append-only journal of queue
+// events plus a compacted snapshot. Restoring reads the snapshot and replays
+// the journal on top of it; compacting writes a new snapshot atomically and
+// truncates the journal.
+//
+// Files (inside the configuration folder):
+//   queue.snapshot  - full state at the last compaction
+//   queue.journal   - length + checksum framed records written since then
+class QueueJournal
+{
+public:
+    explicit QueueJournal(const QString &directory);
+    ~QueueJournal();
+
+    // Rebuilds the last known state and opens the journal for appending
+    QueueJournalState restore();
+
+    void recordEnqueue(const DownloadItem &item);
+    void recordEnqueue(const QList<DownloadItem> &items); // One write for the whole batch
+    void recordStart(const DownloadItem &item);
+    void recordProgress(const DownloadItem &item); // Throttled per item
+    void recordPriority(const DownloadItem &item);
+    void recordFinish(const DownloadItem &item);
+    void recordClear();
+    void recordReset(const QueueJournalState &stateBeforeReset);
+
+    // Writes `state` as the new snapshot and empties the journal
+    bool compact(const QueueJournalState &state);
+    int recordsSinceCompaction() const { return m_recordCount; }
+
+    QString journalPath() const;
+    QString snapshotPath() const;
+    QString resetBackupPath() const;
+
+private:
+    enum RecordType : quint8 {
+        RecordEnqueue = 1,
+        RecordStart = 2,
+        RecordProgress = 3,
+        RecordFinish = 4,
+        RecordClear = 5,
+        RecordReset = 6,
+        RecordPriority = 7
+    };
+
+    static void appendFrame(QByteArray &out, RecordType type, const QByteArray &payload);
+    void appendRecord(RecordType type, const QByteArray &payload);
+    bool openJournal(bool truncate);
+    bool readSnapshot(const QString &path, QueueJournalState &state) const;
+    bool writeSnapshot(const QString &path, const QueueJournalState &state) const;
+    void replayJournal(QHash<quint64, DownloadItem> &pending, QList<DownloadItem> &finished, quint64 &maxId);
+
+    QString m_directory;
+    QFile m_journal;
+    int m_recordCount;
+    QHash<quint64, qint64> m_lastProgressCheckpoint;
+};
+
+#endif // QUEUEJOURNAL_H
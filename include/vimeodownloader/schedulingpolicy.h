@@ -0,0 +1,81 @@
+#ifndef SCHEDULINGPOLICY_H
+#define SCHEDULINGPOLICY_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+#include "downloaditem.h"
+
+// Chooses which pending item starts next. Priorities always come first; the
+// policy orders the items of the highest priority that can start:
+//  - Fifo: in the order they were queued.
+//  - ShortestFirst: smallest expected size first (prefetched estimatedBytes;
+//    items of unknown size count as the mean known size).
+//  - FairShare: destination folders take turns in proportion to their
+//    weight, measured in expected bytes started (weighted fair queuing).
+// Aging: an item waiting longer than the aging time starts before every
+// younger item of its priority, whatever the policy, so large downloads
+// cannot starve.
+class SchedulingPolicy
+{
+public:
+    enum Kind {
+        Fifo,
+        ShortestFirst,
+        FairShare
+    };
+
+    SchedulingPolicy();
+
+    void setKind(Kind kind) { m_kind = kind; }
+    Kind kind() const { return m_kind; }
+    // "fifo", "shortest", "fair"; unknown names give Fifo and *ok = false
+    static Kind kindFromName(const QString &name, bool *ok = nullptr);
+    static QString kindName(Kind kind);
+
+    // Seconds an item may wait before it goes first, 0 disables aging
+    void setAgingSeconds(qint64 seconds) { m_agingSeconds = qMax<qint64>(0, seconds); }
+    qint64 agingSeconds() const { return m_agingSeconds; }
+    // FairShare weights by folder ("folder=weight" entries), 1 for the others
+    void setFolderWeights(const QStringList &entries);
+
+    // Index in `pending` (highest priority first, FIFO among equals) of the
+    // next item to start among those `canStart` accepts, -1 if none
+    int pick(const QList<DownloadItem> &pending, const std::function<bool(const DownloadItem &)> &canStart,
+             const QDateTime &now) const;
+    // Accounts the item `pick` chose, taken out of `pending`
+    void onDispatched(const DownloadItem &item, const QList<DownloadItem> &pending);
+    // Forgets the FairShare history (queue reset)
+    void reset();
+
+    // Start order of every pending item, ignoring host limits
+    QList<int> order(const QList<DownloadItem> &pending, const QDateTime &now) const;
+    // Mean seconds until the running and pending items complete if they start
+    // in order() on `slots` slots transferring `slotRate` bytes/s each;
+    // -1 without a rate or a single known size
+    double meanCompletionSeconds(const QList<DownloadItem> &running, const QList<DownloadItem> &pending,
+                                 int slots, double slotRate, const QDateTime &now) const;
+
+private:
+    bool isAged(const DownloadItem &item, const QDateTime &now) const;
+    double weight(const QString &folder) const;
+    // Mean estimatedBytes of the items that have one, 0 if none
+    static qint64 meanKnownBytes(const QList<DownloadItem> &items);
+    static qint64 expectedBytes(const DownloadItem &item, qint64 fallback);
+    static QString folderKey(const DownloadItem &item);
+
+    Kind m_kind;
+    qint64 m_agingSeconds;
+    QHash<QString, double> m_weights;
+    // FairShare: weighted bytes started per folder, and the start tag of the
+    // last dispatch so a folder that was idle does not bank credit
+    QHash<QString, double> m_served;
+    double m_virtualTime;
+};
+
+#endif // SCHEDULINGPOLICY_H
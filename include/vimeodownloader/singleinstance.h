@@ -0,0 +1,50 @@
+#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+class QLocalSocket;
+
+// One desktop instance per user. The first launch owns a local socket
+// (named pipe on Windows); later launches hand their URLs to it and exit.
+//
+// Message: "VDIPC1\n", one URL per line, then an empty line. The owner
+// answers "OK\n" once it has taken the URLs.
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SingleInstance(const QString &key, QObject *parent = nullptr);
+    ~SingleInstance();
+
+    // Per-user socket name
+    static QString defaultKey();
+
+    // Client side, usable before any widget exists (a QCoreApplication is
+    // enough). True if a running instance acknowledged the URLs.
+    static bool sendToRunning(const QString &key, const QStringList &urls, int timeoutMs = 1000);
+
+    // Owner side. A socket left behind by a crashed instance is replaced;
+    // false if another live instance owns the key.
+    bool listen();
+
+signals:
+    // Empty when a later launch had no URLs: just bring the window up
+    void urlsReceived(const QStringList &urls);
+
+private slots:
+    void onNewConnection();
+
+private:
+    void readMessage(QLocalSocket *socket);
+
+    QString m_key;
+    QLocalServer *m_server;
+    QHash<QLocalSocket *, QByteArray> m_buffers; // Messages still being received
+};
+
+#endif // SINGLEINSTANCE_H
@@ -0,0 +1,38 @@
+#ifndef SYNCSTORE_H
+#define SYNCSTORE_H
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+// What an incremental sync saw at the top of a collection last time
+struct SyncWatermark {
+    QStringList keys;           // Canonical keys of the newest entries, newest first
+    qint64 newestTimestamp = 0; // Upload time (seconds since epoch) of the newest entry, 0 if unknown
+    int count = -1;             // Entries the site reported, -1 if unknown
+    QDateTime syncedTime;
+
+    bool isEmpty() const { return keys.isEmpty(); }
+};
+
+// Watermarks of synced playlists, showcases and channels, keyed by the
+// collection URL, in one small JSON file rewritten atomically on save.
+class SyncStore
+{
+public:
+    // Entries kept per watermark: deleting that many top videos still leaves a match
+    static constexpr int WATERMARK_KEYS = 50;
+
+    explicit SyncStore(const QString &path);
+
+    QString path() const { return m_path; }
+    SyncWatermark watermark(const QString &url) const;
+    bool save(const QString &url, const SyncWatermark &watermark);
+
+private:
+    QString m_path;
+    QJsonObject m_collections;
+};
+
+#endif // SYNCSTORE_H
@@ -0,0 +1,37 @@
+#ifndef TIMEWINDOW_H
+#define TIMEWINDOW_H
+
+#include <QDateTime>
+#include <QString>
+
+// Recurring time of day range "[days ]HH:mm-HH:mm", e.g. "22:00-07:00" or
+// "Sat-Sun 00:00-24:00"; days are Mon..Sun, ranges and commas allowed, all
+// days when omitted. A range may cross midnight and then belongs to the day
+// it starts on; equal ends cover the whole day. A default constructed
+// window is always open.
+class TimeWindow
+{
+public:
+    TimeWindow();
+
+    // False if `text` cannot be parsed; *window is left untouched then
+    static bool parse(const QString &text, TimeWindow *window);
+    bool isAlways() const { return m_always; }
+    QString toString() const { return m_text; }
+
+    bool contains(const QDateTime &time) const;
+    // First time after `time` at which contains() changes, invalid if never
+    QDateTime nextChange(const QDateTime &time) const;
+
+private:
+    static bool parseDays(const QString &text, int *days);
+    static bool parseMinute(const QString &text, int *minute);
+
+    bool m_always;
+    int m_days;        // Bit 0 = Monday ... bit 6 = Sunday
+    int m_startMinute; // Minutes after midnight
+    int m_endMinute;
+    QString m_text;
+};
+
+#endif // TIMEWINDOW_H
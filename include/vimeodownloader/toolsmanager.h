@@ -2,19 +2,19 @@
 #define TOOLSMANAGER_H
 
 #include <QObject>
-#include <QTextEdit>
-#include <QPushButton>
 #include <QProcess>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QTimer>
 
+class LogModel;
+
 class ToolsManager : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit ToolsManager(QTextEdit *logOutput, QPushButton *toolsButton, QObject *parent = nullptr);
+    explicit ToolsManager(LogModel *log, QObject *parent = nullptr);
     ~ToolsManager();
 
     // Public interface
@@ -33,6 +33,10 @@ public:
 signals:
     void toolsStatusChanged(bool allInstalled);
     void installationFinished(bool success);
+    // State of the install/update action, for whatever front end presents it
+    void actionEnabledChanged(bool enabled);
+    void actionTextChanged(const QString &text);
+    void actionStyleChanged(const QString &styleClass); // "" or "danger"
 
 private slots:
     void onInstallUpdateClicked();
@@ -60,9 +64,7 @@ private:
     void setButtonStyle(const QString &styleClass);
     QString getBrewPath() const;
     
-    // UI references
-    QTextEdit *m_logOutput;
-    QPushButton *m_toolsButton;
+    LogModel *m_log;
     
     // Tool status
     bool m_ytDlpInstalled;
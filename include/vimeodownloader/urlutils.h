@@ -0,0 +1,28 @@
+#ifndef URLUTILS_H
+#define URLUTILS_H
+
+#include <QString>
+
+class UrlUtils
+{
+public:
+    // Hosts recognized by the application
+    static const QString HOST_VIMEO;
+    static const QString HOST_YOUTUBE;
+    static const QString HOST_OTHER;
+
+    static bool isValidVideoUrl(const QString &url);
+    static bool isVimeoUrl(const QString &url);
+    static bool isYouTubeUrl(const QString &url);
+    // Playlists, showcases, albums, channels and user pages: expanded into
+    // their videos instead of being downloaded as one item
+    static bool isCollectionUrl(const QString &url);
+
+    // Host key used for per-host limits (HOST_VIMEO, HOST_YOUTUBE or HOST_OTHER)
+    static QString hostKey(const QString &url);
+    // Same key for every link to one video: "vimeo:76979871", "youtube:dQw4w9WgXcQ",
+    // otherwise (collections included) "url:" and the URL without fragment
+    static QString canonicalVideoKey(const QString &url);
+};
+
+#endif // URLUTILS_H
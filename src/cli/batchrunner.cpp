@@ -0,0 +1,414 @@
+#include "vimeodownloader/batchrunner.h"
+#include "vimeodownloader/apppaths.h"
+#include "vimeodownloader/downloadqueue.h"
+#include "vimeodownloader/formatutils.h"
+#include "vimeodownloader/logmodel.h"
+#include "vimeodownloader/logsink.h"
+#include "vimeodownloader/toolsmanager.h"
+#include "vimeodownloader/urlutils.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QStandardPaths>
+
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+// Redraw period of the progress line; without a terminal a line is only
+// printed every PLAIN_PROGRESS_TICKS redraws so logs stay readable
+constexpr int PROGRESS_INTERVAL_MS = 1000;
+constexpr int PLAIN_PROGRESS_TICKS = 10;
+constexpr int PROGRESS_LINE_WIDTH = 110;
+
+bool isTerminal(FILE *stream)
+{
+#ifdef Q_OS_WIN
+    return _isatty(_fileno(stream));
+#else
+    return isatty(fileno(stream));
+#endif
+}
+
+QString displayName(const DownloadItem &item)
+{
+    return item.title.isEmpty() ? item.url : item.title;
+}
+}
+
+BatchRunner::BatchRunner(const Options &options, QObject *parent)
+    : QObject(parent)
+    , m_options(options)
+    , m_log(nullptr)
+    , m_logSink(nullptr)
+    , m_toolsManager(nullptr)
+    , m_queue(nullptr)
+    , m_progressTimer(nullptr)
+    , m_stderrIsTerminal(isTerminal(stderr))
+    , m_progressLineOpen(false)
+    , m_done(false)
+    , m_exitCode(ExitOk)
+    , m_progressTicks(0)
+    , m_expected(0)
+    , m_completed(0)
+    , m_failed(0)
+    , m_cancelled(0)
+    , m_invalid(0)
+    , m_skipped(0)
+    , m_transferredBytes(0)
+{
+    // Nothing is displayed, a small buffer is enough for --verbose
+    m_log = new LogModel(1000, this);
+    if (m_options.verbose) {
+        connect(m_log, &LogModel::rowsInserted, this, &BatchRunner::onLogRowsInserted);
+    }
+    if (!m_options.logDir.isEmpty()) {
+        m_logSink = new LogSink(m_options.logDir, LogSink::Options());
+        m_log->setSink(m_logSink);
+    }
+
+    m_toolsManager = new ToolsManager(m_log, this);
+
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setInterval(PROGRESS_INTERVAL_MS);
+    connect(m_progressTimer, &QTimer::timeout, this, &BatchRunner::printProgress);
+}
+
+BatchRunner::~BatchRunner()
+{
+    // Kills whatever is still running before the log goes away
+    delete m_queue;
+    m_queue = nullptr;
+
+    if (m_logSink) {
+        m_log->setSink(nullptr);
+        delete m_logSink;
+    }
+}
+
+bool BatchRunner::start()
+{
+    if (m_options.urls.isEmpty()) {
+        std::fprintf(stderr, "No URLs given\n");
+        m_exitCode = ExitUsage;
+        return false;
+    }
+    if (m_options.downloadDir.isEmpty()) {
+        std::fprintf(stderr, "No download folder: set download/folder in config.ini or use --output\n");
+        m_exitCode = ExitUsage;
+        return false;
+    }
+    if (!QDir().mkpath(m_options.downloadDir)) {
+        std::fprintf(stderr, "Cannot create download folder %s\n", qPrintable(m_options.downloadDir));
+        m_exitCode = ExitUsage;
+        return false;
+    }
+
+    // No full tools check (it spawns processes): yt-dlp only has to be there
+    QString ytDlpPath = m_toolsManager->getYtDlpPath();
+    QFileInfo ytDlp(ytDlpPath);
+    bool found = ytDlp.isAbsolute() ? ytDlp.isExecutable() : !QStandardPaths::findExecutable(ytDlpPath).isEmpty();
+    if (!found) {
+        std::fprintf(stderr, "yt-dlp not found (%s)\n", qPrintable(ytDlpPath));
+        m_exitCode = ExitMissingTools;
+        return false;
+    }
+
+    m_elapsed.start();
+
+    QStringList valid;
+    for (const QString &url : std::as_const(m_options.urls)) {
+        if (UrlUtils::isValidVideoUrl(url)) {
+            valid << url;
+        } else {
+            DownloadItem item(url, QString(), QString(), m_options.downloadDir);
+            recordResult(item, "invalid", "Unsupported URL");
+        }
+    }
+    if (valid.isEmpty()) {
+        finish(ExitFailures);
+        return false;
+    }
+
+    m_queue = new DownloadQueue(m_log, m_toolsManager);
+    m_queue->setMaxConcurrentDownloads(m_options.maxConcurrent);
+    if (m_options.maxMerges > 0) {
+        m_queue->setMaxConcurrentMerges(m_options.maxMerges);
+    }
+    m_queue->setResumeEnabled(m_options.resume);
+    m_queue->setProgressInterval(m_options.progressInterval);
+    m_queue->setPrefetchDepth(m_options.prefetchDepth);
+    m_queue->enableMetadataCache(AppPaths::cacheDir() + "/metadata", qint64(m_options.metadataCacheHours) * 3600);
+    m_queue->enableArchive(AppPaths::archivePath());
+    m_queue->setSkipArchived(m_options.skipArchived);
+    if (m_options.sync) {
+        m_queue->enableSync(AppPaths::syncStatePath());
+    }
+    m_queue->setSchedulingPolicy(SchedulingPolicy::kindFromName(m_options.scheduling));
+    m_queue->setSchedulingAging(qint64(m_options.agingMinutes) * 60);
+    m_queue->setFolderWeights(m_options.folderWeights);
+    m_queue->setBandwidthSchedule(m_options.bandwidth);
+    m_queue->setRunWindow(m_options.runWindow);
+    connect(m_queue, &DownloadQueue::downloadStarted, this, &BatchRunner::onDownloadStarted);
+    connect(m_queue, &DownloadQueue::downloadItemUpdated, this, &BatchRunner::onItemUpdated);
+    connect(m_queue, &DownloadQueue::downloadCompleted, this, &BatchRunner::onDownloadCompleted);
+    connect(m_queue, &DownloadQueue::downloadFailed, this, &BatchRunner::onDownloadFailed);
+    connect(m_queue, &DownloadQueue::queueFinished, this, &BatchRunner::onQueueFinished);
+    connect(m_queue, &DownloadQueue::groupUpdated, this, &BatchRunner::onGroupUpdated);
+
+    // Through the submission queue like the daemon; counted once it is drained
+    QList<DownloadItem> items;
+    items.reserve(valid.size());
+    for (const QString &url : std::as_const(valid)) {
+        // Vimeo credentials only go with Vimeo links, as in the GUI
+        bool vimeo = UrlUtils::isVimeoUrl(url);
+        items.append(DownloadItem(url, vimeo ? m_options.username : QString(), vimeo ? m_options.password : QString(),
+                                  m_options.downloadDir));
+    }
+    m_queue->submit(items, [this, items](const QList<quint64> &ids) { onSubmitted(items, ids); });
+    return true;
+}
+
+void BatchRunner::onSubmitted(const QList<DownloadItem> &items, const QList<quint64> &ids)
+{
+    // Archived videos are reported right away; a repeated link is one download.
+    // Playlists count their entries as they are listed (onGroupUpdated).
+    QSet<quint64> queued;
+    for (int i = 0; i < ids.size(); ++i) {
+        DownloadGroup group;
+        if (ids.at(i) == 0) {
+            recordResult(DownloadItem(items.at(i).url, QString(), QString(), m_options.downloadDir), "skipped", "Already downloaded");
+        } else if (!m_queue->findGroup(ids.at(i), &group)) {
+            queued.insert(ids.at(i));
+        }
+    }
+    m_expected += int(queued.size());
+    if (m_expected == 0 && m_groups.isEmpty()) {
+        finish(m_invalid == 0 ? ExitOk : ExitFailures);
+        return;
+    }
+
+    if (!m_options.quiet) {
+        std::fprintf(stderr, "%d URLs, %d parallel, saving to %s\n", m_expected, m_options.maxConcurrent,
+                     qPrintable(QDir::toNativeSeparators(m_options.downloadDir)));
+        m_progressTimer->start();
+    }
+}
+
+void BatchRunner::interrupt()
+{
+    if (m_done) {
+        return;
+    }
+    // Whatever is running is killed with the queue; .part files stay for a later --resume
+    for (const DownloadItem &item : std::as_const(m_running)) {
+        recordResult(item, "cancelled", "Interrupted");
+    }
+    m_running.clear();
+    finish(ExitInterrupted);
+}
+
+void BatchRunner::onDownloadStarted(const DownloadItem &item)
+{
+    m_running.insert(item.id, item);
+}
+
+void BatchRunner::onItemUpdated(const DownloadItem &item)
+{
+    if (m_running.contains(item.id)) {
+        m_running[item.id] = item;
+    }
+}
+
+void BatchRunner::onDownloadCompleted(const DownloadItem &item)
+{
+    m_running.remove(item.id);
+    recordResult(item, "completed", QString());
+}
+
+void BatchRunner::onDownloadFailed(const DownloadItem &item, const QString &error)
+{
+    m_running.remove(item.id);
+    recordResult(item, item.status == DownloadStatus::Cancelled ? "cancelled" : "failed", error);
+}
+
+void BatchRunner::onGroupUpdated(const DownloadGroup &group)
+{
+    DownloadGroup previous = m_groups.value(group.id);
+    m_groups.insert(group.id, group);
+    m_expected += group.queued - previous.queued;
+    m_skipped += group.skipped - previous.skipped;
+
+    // A listing that failed counts as one failed download
+    if (!group.error.isEmpty() && previous.error.isEmpty()) {
+        m_expected++;
+        recordResult(DownloadItem(group.url, QString(), QString(), m_options.downloadDir), "failed", group.error);
+    }
+
+    if (group.isFinished() && !previous.isFinished()) {
+        QJsonObject object;
+        object.insert("type", "group");
+        object.insert("url", group.url);
+        if (!group.title.isEmpty()) {
+            object.insert("title", group.title);
+        }
+        object.insert("queued", group.queued);
+        object.insert("completed", group.completed);
+        object.insert("failed", group.failed);
+        object.insert("skipped", group.skipped);
+        if (!group.error.isEmpty()) {
+            object.insert("error", group.error);
+        }
+        printLine(QJsonDocument(object).toJson(QJsonDocument::Compact), true);
+    }
+}
+
+void BatchRunner::onQueueFinished()
+{
+    bool allOk = m_failed == 0 && m_cancelled == 0 && m_invalid == 0;
+    finish(allOk ? ExitOk : ExitFailures);
+}
+
+void BatchRunner::onLogRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    Q_UNUSED(parent);
+    for (int row = first; row <= last; ++row) {
+        const LogEntry &entry = m_log->entry(row);
+        QByteArray line = QString("[%1] %2").arg(entry.source, entry.message).toUtf8();
+        printLine(line, false);
+    }
+}
+
+void BatchRunner::printProgress()
+{
+    if (!m_stderrIsTerminal && ++m_progressTicks % PLAIN_PROGRESS_TICKS != 0) {
+        return;
+    }
+
+    int finished = m_completed + m_failed + m_cancelled;
+    double speed = 0.0;
+    for (const DownloadItem &item : std::as_const(m_running)) {
+        speed += item.speed;
+    }
+
+    QString line = QString("[%1/%2] %3 running, %4")
+                       .arg(finished).arg(m_expected).arg(m_running.size())
+                       .arg(FormatUtils::formatSpeed(speed));
+    for (const DownloadItem &item : std::as_const(m_running)) {
+        line += QString(" | %1 %2% %3").arg(displayName(item).left(24)).arg(item.progress)
+                    .arg(FormatUtils::formatDuration(item.eta));
+    }
+
+    if (m_stderrIsTerminal) {
+        // Redrawn in place: \r and clear to end of line
+        std::fprintf(stderr, "\r\x1b[K%s", qPrintable(line.left(PROGRESS_LINE_WIDTH)));
+        std::fflush(stderr);
+        m_progressLineOpen = true;
+    } else {
+        std::fprintf(stderr, "%s\n", qPrintable(line));
+    }
+}
+
+void BatchRunner::recordResult(const DownloadItem &item, const QString &status, const QString &error)
+{
+    if (status == "completed") {
+        m_completed++;
+    } else if (status == "cancelled") {
+        m_cancelled++;
+    } else if (status == "invalid") {
+        m_invalid++;
+    } else if (status == "skipped") {
+        m_skipped++;
+    } else {
+        m_failed++;
+    }
+    m_transferredBytes += item.transferredBytes;
+
+    QJsonObject object;
+    object.insert("type", "item");
+    object.insert("url", item.url);
+    object.insert("status", status);
+    if (!item.title.isEmpty()) {
+        object.insert("title", item.title);
+    }
+    object.insert("bytes", item.transferredBytes);
+    object.insert("reusedBytes", item.reusedBytes);
+    if (item.startTime.isValid() && item.finishTime.isValid()) {
+        object.insert("seconds", item.startTime.msecsTo(item.finishTime) / 1000.0);
+    }
+    object.insert("retries", item.retryCount);
+    if (item.firstByteMs >= 0) {
+        object.insert("firstByteMs", item.firstByteMs);
+    }
+    // Milliseconds per reached stage, to see where the time went
+    QJsonObject stages;
+    for (int i = 0; i < int(DownloadStage::Count); ++i) {
+        if (item.stageMs[i] >= 0) {
+            stages.insert(DownloadItem::stageName(DownloadStage(i)), item.stageMs[i]);
+        }
+    }
+    if (!stages.isEmpty()) {
+        object.insert("stages", stages);
+    }
+    if (!item.outputFiles.isEmpty()) {
+        object.insert("files", QJsonArray::fromStringList(item.outputFiles));
+    }
+    if (!error.isEmpty()) {
+        object.insert("error", error);
+    }
+    printLine(QJsonDocument(object).toJson(QJsonDocument::Compact), true);
+
+    if (!m_options.quiet) {
+        QString text = status == "completed" ? QString("done   %1").arg(displayName(item))
+                                             : QString("%1 %2: %3").arg(status.toUpper(), displayName(item), error);
+        printLine(text.toUtf8(), false);
+    }
+}
+
+void BatchRunner::printLine(const QByteArray &line, bool toStdout)
+{
+    // Wipe the progress line first so output does not land on top of it
+    if (m_progressLineOpen) {
+        std::fprintf(stderr, "\r\x1b[K");
+        m_progressLineOpen = false;
+    }
+    FILE *stream = toStdout ? stdout : stderr;
+    std::fwrite(line.constData(), 1, size_t(line.size()), stream);
+    std::fputc('\n', stream);
+    std::fflush(stream);
+}
+
+void BatchRunner::finish(int exitCode)
+{
+    if (m_done) {
+        return;
+    }
+    m_done = true;
+    m_exitCode = exitCode;
+    m_progressTimer->stop();
+
+    QJsonObject summary;
+    summary.insert("type", "summary");
+    summary.insert("total", m_expected + m_invalid + m_skipped);
+    summary.insert("completed", m_completed);
+    summary.insert("failed", m_failed);
+    summary.insert("cancelled", m_cancelled);
+    summary.insert("invalid", m_invalid);
+    summary.insert("skipped", m_skipped);
+    summary.insert("pending", m_expected - m_completed - m_failed - m_cancelled);
+    summary.insert("bytes", m_transferredBytes);
+    summary.insert("seconds", m_elapsed.isValid() ? m_elapsed.elapsed() / 1000.0 : 0.0);
+    summary.insert("exitCode", exitCode);
+    printLine(QJsonDocument(summary).toJson(QJsonDocument::Compact), true);
+
+    emit finished(exitCode);
+}
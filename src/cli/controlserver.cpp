@@ -0,0 +1,718 @@
+#include "vimeodownloader/controlserver.h"
+#include "vimeodownloader/downloadarchive.h"
+#include "vimeodownloader/downloadqueue.h"
+#include "vimeodownloader/metadatacache.h"
+#include "vimeodownloader/urlutils.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+
+namespace {
+constexpr int MAX_HEADER_SIZE = 64 * 1024;
+constexpr qint64 MAX_BODY_SIZE = 64 * 1024 * 1024; // ~500k URLs
+constexpr int EVENT_INTERVAL_MS = 250;
+constexpr int KEEP_ALIVE_INTERVAL_MS = 15000;
+constexpr int DEFAULT_PAGE_SIZE = 100;
+constexpr int MAX_PAGE_SIZE = 1000;
+
+QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    default: return "Error";
+    }
+}
+
+// "127.0.0.1", "localhost" or "[::1]", with or without a port
+bool isLoopbackHost(QByteArray host)
+{
+    host = host.trimmed().toLower();
+    if (host.startsWith('[')) {
+        host = host.mid(1, host.indexOf(']') - 1);
+    } else if (host.count(':') == 1) {
+        host = host.left(host.indexOf(':'));
+    }
+    return host == "127.0.0.1" || host == "localhost" || host == "::1";
+}
+
+QString timeToJson(const QDateTime &time)
+{
+    return time.isValid() ? time.toString(Qt::ISODateWithMs) : QString();
+}
+
+// Milliseconds per reached stage, e.g. {"resolve": 850, "fetch": 30120}
+QJsonObject stagesToJson(const DownloadItem &item)
+{
+    QJsonObject stages;
+    for (int i = 0; i < int(DownloadStage::Count); ++i) {
+        if (item.stageMs[i] >= 0) {
+            stages.insert(DownloadItem::stageName(DownloadStage(i)), item.stageMs[i]);
+        }
+    }
+    return stages;
+}
+
+// A number or a class name ("bulk", "normal", "urgent"); `fallback` when absent
+bool priorityFromJson(const QJsonValue &value, int fallback, int *priority)
+{
+    if (value.isUndefined() || value.isNull()) {
+        *priority = fallback;
+        return true;
+    }
+    if (value.isDouble()) {
+        *priority = value.toInt();
+        return true;
+    }
+    return value.isString() && DownloadItem::classPriority(value.toString(), priority);
+}
+
+// An ISO date-time, or "HH:mm" for its next occurrence after `after`;
+// `fallback` when absent
+bool windowTimeFromJson(const QJsonValue &value, const QDateTime &fallback, const QDateTime &after, QDateTime *time)
+{
+    if (value.isUndefined() || value.isNull()) {
+        *time = fallback;
+        return true;
+    }
+    QString text = value.toString().trimmed();
+    QTime clock = QTime::fromString(text, "H:mm");
+    if (clock.isValid()) {
+        *time = QDateTime(after.date(), clock);
+        if (*time <= after) {
+            *time = time->addDays(1);
+        }
+        return true;
+    }
+    *time = QDateTime::fromString(text, Qt::ISODate);
+    return time->isValid();
+}
+
+// notBefore/notAfter of `object`, "HH:mm" ends counted from its start
+bool windowFromJson(const QJsonObject &object, const DownloadItem &fallback, DownloadItem *item)
+{
+    QDateTime now = QDateTime::currentDateTime();
+    if (!windowTimeFromJson(object.value("notBefore"), fallback.notBefore, now, &item->notBefore)) {
+        return false;
+    }
+    QDateTime start = item->notBefore.isValid() ? item->notBefore : now;
+    return windowTimeFromJson(object.value("notAfter"), fallback.notAfter, start, &item->notAfter)
+           && (!item->notBefore.isValid() || !item->notAfter.isValid() || item->notBefore < item->notAfter);
+}
+}
+
+ControlServer::ControlServer(DownloadQueue *queue, const Defaults &defaults, QObject *parent)
+    : QObject(parent)
+    , m_queue(queue)
+    , m_defaults(defaults)
+    , m_server(nullptr)
+    , m_eventTimer(nullptr)
+    , m_keepAliveTimer(nullptr)
+{
+    m_server = new QTcpServer(this);
+    connect(m_server, &QTcpServer::newConnection, this, &ControlServer::onNewConnection);
+
+    m_eventTimer = new QTimer(this);
+    m_eventTimer->setSingleShot(true);
+    connect(m_eventTimer, &QTimer::timeout, this, &ControlServer::flushEvents);
+
+    // Comment lines keep idle event streams from being closed by proxies
+    m_keepAliveTimer = new QTimer(this);
+    connect(m_keepAliveTimer, &QTimer::timeout, this, [this]() {
+        for (QTcpSocket *client : std::as_const(m_eventClients)) {
+            client->write(": ping\n\n");
+        }
+    });
+    m_keepAliveTimer->start(KEEP_ALIVE_INTERVAL_MS);
+
+    connect(m_queue, &DownloadQueue::downloadStarted, this, &ControlServer::onDownloadStarted);
+    connect(m_queue, &DownloadQueue::downloadItemUpdated, this, &ControlServer::onItemUpdated);
+    connect(m_queue, &DownloadQueue::downloadMetadataReady, this, &ControlServer::onMetadataReady);
+    connect(m_queue, &DownloadQueue::groupUpdated, this, &ControlServer::onGroupUpdated);
+    connect(m_queue, &DownloadQueue::downloadCompleted, this, &ControlServer::onDownloadCompleted);
+    connect(m_queue, &DownloadQueue::downloadFailed, this, &ControlServer::onDownloadFailed);
+    connect(m_queue, &DownloadQueue::queueStatusChanged, this, &ControlServer::onQueueStatusChanged);
+}
+
+ControlServer::~ControlServer()
+{
+    m_queue->disconnect(this);
+}
+
+bool ControlServer::listen(const QHostAddress &address, quint16 port)
+{
+    return m_server->listen(address, port);
+}
+
+quint16 ControlServer::serverPort() const
+{
+    return m_server->serverPort();
+}
+
+QString ControlServer::errorString() const
+{
+    return m_server->errorString();
+}
+
+void ControlServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        m_buffers.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, &ControlServer::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, &ControlServer::onDisconnected);
+    }
+}
+
+void ControlServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    auto it = m_buffers.find(socket);
+    if (it == m_buffers.end()) {
+        socket->readAll(); // Request already handled, nothing more is expected
+        return;
+    }
+
+    it->append(socket->readAll());
+    Request request;
+    int result = parseRequest(*it, request);
+    if (result == 0) {
+        return;
+    }
+
+    m_buffers.erase(it);
+    if (result < 0) {
+        sendError(socket, result == -2 ? 413 : 400, "Malformed request");
+        return;
+    }
+    handleRequest(socket, request);
+}
+
+void ControlServer::onDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    m_buffers.remove(socket);
+    m_eventClients.removeAll(socket);
+    socket->deleteLater();
+}
+
+int ControlServer::parseRequest(QByteArray &buffer, Request &request) const
+{
+    int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        return buffer.size() > MAX_HEADER_SIZE ? -2 : 0;
+    }
+
+    const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() != 3 || !requestLine.at(2).startsWith("HTTP/1.")) {
+        return -1;
+    }
+    request.method = requestLine.at(0);
+
+    QByteArray target = requestLine.at(1);
+    int queryStart = target.indexOf('?');
+    request.path = target.left(queryStart < 0 ? target.size() : queryStart);
+    if (queryStart >= 0) {
+        for (const QByteArray &pair : target.mid(queryStart + 1).split('&')) {
+            int equals = pair.indexOf('=');
+            QByteArray key = equals < 0 ? pair : pair.left(equals);
+            QByteArray value = equals < 0 ? QByteArray() : pair.mid(equals + 1);
+            request.query.insert(QByteArray::fromPercentEncoding(key), QByteArray::fromPercentEncoding(value));
+        }
+    }
+
+    for (int i = 1; i < lines.size(); ++i) {
+        int colon = lines.at(i).indexOf(':');
+        if (colon > 0) {
+            request.headers.insert(lines.at(i).left(colon).trimmed().toLower(), lines.at(i).mid(colon + 1).trimmed());
+        }
+    }
+
+    bool ok = true;
+    qint64 length = request.headers.value("content-length", "0").toLongLong(&ok);
+    if (!ok || length < 0) {
+        return -1;
+    }
+    if (length > MAX_BODY_SIZE) {
+        return -2;
+    }
+    qint64 bodyStart = headerEnd + 4;
+    if (buffer.size() < bodyStart + length) {
+        return 0;
+    }
+    request.body = buffer.mid(bodyStart, length);
+    return 1;
+}
+
+void ControlServer::handleRequest(QTcpSocket *socket, const Request &request)
+{
+    // Web pages must not drive the daemon: a rebound DNS name shows up in
+    // Host, a cross-site request (even a plain-text POST without preflight)
+    // carries its Origin. Local tools send neither or loopback values.
+    QByteArray origin = request.headers.value("origin");
+    if (!isLoopbackHost(request.headers.value("host"))
+        || (!origin.isEmpty() && !isLoopbackHost(QUrl(QString::fromUtf8(origin)).host().toUtf8()))) {
+        sendError(socket, 403, "Only local clients are accepted");
+        return;
+    }
+    if (!m_token.isEmpty() && request.headers.value("authorization") != "Bearer " + m_token) {
+        sendError(socket, 401, "Missing or wrong token");
+        return;
+    }
+
+    // "/api/items/12/cancel" -> ["api", "items", "12", "cancel"]
+    const QList<QByteArray> parts = request.path.split('/');
+    QList<QByteArray> segments;
+    for (const QByteArray &part : parts) {
+        if (!part.isEmpty()) {
+            segments.append(part);
+        }
+    }
+    if (segments.isEmpty() || segments.first() != "api") {
+        sendError(socket, 404, "Unknown path");
+        return;
+    }
+    segments.removeFirst();
+
+    const QByteArray &method = request.method;
+    if (segments == QList<QByteArray>{ "queue" } && method == "GET") {
+        sendJson(socket, 200, queueStatus());
+    } else if (segments == QList<QByteArray>{ "queue", "pause" } && method == "POST") {
+        m_queue->pauseQueue();
+        sendJson(socket, 200, queueStatus());
+    } else if (segments == QList<QByteArray>{ "queue", "resume" } && method == "POST") {
+        m_queue->startQueue(); // Also resumes a paused queue
+        sendJson(socket, 200, queueStatus());
+    } else if (segments == QList<QByteArray>{ "items" } && method == "GET") {
+        handleItemList(socket, request);
+    } else if (segments == QList<QByteArray>{ "items" } && method == "POST") {
+        handleEnqueue(socket, request);
+    } else if (segments == QList<QByteArray>{ "events" } && method == "GET") {
+        openEventStream(socket);
+    } else if (segments == QList<QByteArray>{ "groups" } && method == "GET") {
+        QJsonArray groups;
+        const QList<DownloadGroup> all = m_queue->getGroups();
+        for (const DownloadGroup &group : all) {
+            groups.append(groupToJson(group));
+        }
+        sendJson(socket, 200, QJsonObject{ { "groups", groups } });
+    } else if (segments.size() >= 2 && segments.first() == "groups") {
+        bool ok = false;
+        quint64 id = segments.at(1).toULongLong(&ok);
+        DownloadGroup group;
+        if (!ok || !m_queue->findGroup(id, &group)) {
+            sendError(socket, 404, "Unknown group");
+            return;
+        }
+        
+        QByteArray action = segments.size() > 2 ? segments.at(2) : QByteArray();
+        if (action.isEmpty() && method == "GET") {
+            sendJson(socket, 200, groupToJson(group));
+        } else if ((action == "cancel" && method == "POST") || (action.isEmpty() && method == "DELETE")) {
+            if (group.isFinished()) {
+                sendError(socket, 409, "Group already finished");
+                return;
+            }
+            m_queue->cancelItem(id);
+            sendJson(socket, 200, QJsonObject{ { "id", qint64(id) }, { "cancelled", true } });
+        } else {
+            sendError(socket, 405, "Unsupported method");
+        }
+    } else if (segments.size() >= 2 && segments.first() == "items") {
+        bool ok = false;
+        quint64 id = segments.at(1).toULongLong(&ok);
+        DownloadItem item;
+        if (!ok || !m_queue->findItem(id, &item)) {
+            sendError(socket, 404, "Unknown item");
+            return;
+        }
+
+        QByteArray action = segments.size() > 2 ? segments.at(2) : QByteArray();
+        if (action.isEmpty() && method == "GET") {
+            sendJson(socket, 200, itemToJson(item));
+        } else if ((action == "cancel" && method == "POST") || (action.isEmpty() && method == "DELETE")) {
+            if (item.isFinished() || !m_queue->cancelItem(id)) {
+                sendError(socket, 409, "Item already finished");
+                return;
+            }
+            sendJson(socket, 200, QJsonObject{ { "id", qint64(id) }, { "cancelled", true } });
+        } else if ((action == "priority" && method == "POST") || (action.isEmpty() && method == "PATCH")) {
+            QJsonObject body = QJsonDocument::fromJson(request.body).object();
+            int priority = 0;
+            if (!body.contains("priority") || !priorityFromJson(body.value("priority"), 0, &priority)) {
+                sendError(socket, 400, "Expected {\"priority\": N or \"bulk\"|\"normal\"|\"urgent\"}");
+                return;
+            }
+            if (!m_queue->setItemPriority(id, priority)) {
+                sendError(socket, 409, "Only pending items can be reprioritized");
+                return;
+            }
+            sendJson(socket, 200, QJsonObject{ { "id", qint64(id) }, { "priority", priority } });
+        } else {
+            sendError(socket, 405, "Unsupported method");
+        }
+    } else {
+        sendError(socket, 404, "Unknown path");
+    }
+}
+
+void ControlServer::handleEnqueue(QTcpSocket *socket, const Request &request)
+{
+    QList<DownloadItem> items;
+    QList<int> itemIndexes; // Position of each item in the request
+    QJsonArray rejected;
+    int index = 0;
+
+    auto addUrl = [&](const QString &url, int priority, const QString &folder,
+                      const QString &username, const QString &password, const DownloadItem &window) {
+        if (!UrlUtils::isValidVideoUrl(url)) {
+            rejected.append(QJsonObject{ { "index", index }, { "url", url } });
+        } else {
+            // Vimeo credentials only go with Vimeo links, as in the GUI
+            bool vimeo = UrlUtils::isVimeoUrl(url);
+            DownloadItem item(url, vimeo ? username : QString(), vimeo ? password : QString(), folder);
+            item.priority = priority;
+            item.notBefore = window.notBefore;
+            item.notAfter = window.notAfter;
+            items.append(item);
+            itemIndexes.append(index);
+        }
+        index++;
+    };
+
+    QByteArray trimmed = request.body.trimmed();
+    if (trimmed.startsWith('{') || trimmed.startsWith('[')) {
+        // {"urls": [...], "items": [{"url", "priority", "folder", "notBefore", "notAfter"}],
+        //  "priority", "folder", "username", "password", "notBefore", "notAfter"}
+        // or a bare array of URLs / item objects
+        QJsonParseError error;
+        QJsonDocument document = QJsonDocument::fromJson(trimmed, &error);
+        if (error.error != QJsonParseError::NoError) {
+            sendError(socket, 400, error.errorString());
+            return;
+        }
+
+        QJsonObject batch = document.isObject() ? document.object() : QJsonObject();
+        int priority = 0;
+        if (!priorityFromJson(batch.value("priority"), 0, &priority)) {
+            sendError(socket, 400, "Unknown priority class");
+            return;
+        }
+        QString folder = batch.value("folder").toString(m_defaults.downloadDir);
+        QString username = batch.value("username").toString(m_defaults.username);
+        QString password = batch.value("password").toString(m_defaults.password);
+        DownloadItem window;
+        if (!windowFromJson(batch, DownloadItem(), &window)) {
+            sendError(socket, 400, "Invalid notBefore/notAfter");
+            return;
+        }
+
+        QJsonArray entries = document.isArray() ? document.array() : batch.value("urls").toArray();
+        if (document.isObject()) {
+            const QJsonArray objects = batch.value("items").toArray();
+            for (const QJsonValue &value : objects) {
+                entries.append(value);
+            }
+        }
+        items.reserve(entries.size());
+        for (const QJsonValue &entry : std::as_const(entries)) {
+            if (entry.isObject()) {
+                QJsonObject object = entry.toObject();
+                int itemPriority = priority;
+                if (!priorityFromJson(object.value("priority"), priority, &itemPriority)) {
+                    sendError(socket, 400, "Unknown priority class");
+                    return;
+                }
+                DownloadItem itemWindow;
+                if (!windowFromJson(object, window, &itemWindow)) {
+                    sendError(socket, 400, "Invalid notBefore/notAfter");
+                    return;
+                }
+                addUrl(object.value("url").toString().trimmed(), itemPriority,
+                       object.value("folder").toString(folder), username, password, itemWindow);
+            } else {
+                addUrl(entry.toString().trimmed(), priority, folder, username, password, window);
+            }
+        }
+    } else {
+        // text/plain: one URL per line
+        for (const QByteArray &line : request.body.split('\n')) {
+            QByteArray url = line.trimmed();
+            if (!url.isEmpty() && !url.startsWith('#')) {
+                addUrl(QString::fromUtf8(url), 0, m_defaults.downloadDir, m_defaults.username, m_defaults.password,
+                       DownloadItem());
+            }
+        }
+    }
+
+    for (const DownloadItem &item : std::as_const(items)) {
+        if (item.downloadDir.isEmpty()) {
+            sendError(socket, 400, "No download folder: pass \"folder\" or set download/folder");
+            return;
+        }
+    }
+
+    // Through the submission queue like every other producer; answered once
+    // it is drained. Links already queued get the id of that item; archived
+    // videos are skipped.
+    QPointer<ControlServer> self(this);
+    QPointer<QTcpSocket> client(socket);
+    m_queue->submit(items, [self, client, items, itemIndexes, rejected](const QList<quint64> &ids) {
+        if (!self || !client) {
+            return;
+        }
+        QJsonArray idArray;
+        QJsonArray skipped;
+        for (int i = 0; i < ids.size(); ++i) {
+            if (ids.at(i) == 0) {
+                skipped.append(QJsonObject{ { "index", itemIndexes.at(i) }, { "url", items.at(i).url } });
+            } else {
+                idArray.append(qint64(ids.at(i)));
+            }
+        }
+        self->sendJson(client, 201, QJsonObject{ { "accepted", int(idArray.size()) }, { "ids", idArray },
+                                                 { "rejected", rejected }, { "skipped", skipped } });
+    });
+}
+
+void ControlServer::handleItemList(QTcpSocket *socket, const Request &request)
+{
+    QByteArray state = request.query.value("state", "all");
+    int offset = qMax(0, request.query.value("offset", "0").toInt());
+    int limit = qBound(1, request.query.value("limit", QByteArray::number(DEFAULT_PAGE_SIZE)).toInt(), MAX_PAGE_SIZE);
+
+    QList<DownloadItem> items;
+    if (state == "active" || state == "all") {
+        items += m_queue->getActiveDownloads();
+    }
+    if (state == "pending" || state == "all") {
+        items += m_queue->getPendingDownloads();
+    }
+    if (state == "finished" || state == "all") {
+        items += m_queue->getCompletedDownloads();
+    }
+
+    QJsonArray page;
+    for (int i = offset; i < items.size() && i < offset + limit; ++i) {
+        page.append(itemToJson(items.at(i)));
+    }
+    sendJson(socket, 200, QJsonObject{ { "total", int(items.size()) }, { "offset", offset }, { "items", page } });
+}
+
+void ControlServer::openEventStream(QTcpSocket *socket)
+{
+    socket->write("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: text/event-stream\r\n"
+                  "Cache-Control: no-cache\r\n"
+                  "Connection: keep-alive\r\n\r\n");
+    m_eventClients.append(socket);
+
+    QByteArray data = QJsonDocument(queueStatus()).toJson(QJsonDocument::Compact);
+    socket->write("event: queue\ndata: " + data + "\n\n");
+}
+
+void ControlServer::sendJson(QTcpSocket *socket, int status, const QJsonObject &object)
+{
+    QByteArray body = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reasonPhrase(status) + "\r\n"
+                          "Content-Type: application/json\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n";
+    socket->write(response + body);
+    socket->disconnectFromHost(); // After the pending data is written
+}
+
+void ControlServer::sendError(QTcpSocket *socket, int status, const QString &message)
+{
+    sendJson(socket, status, QJsonObject{ { "error", message } });
+}
+
+void ControlServer::sendEvent(const QByteArray &event, const QJsonObject &data)
+{
+    if (m_eventClients.isEmpty()) {
+        return;
+    }
+    QByteArray message = "event: " + event + "\ndata: " + QJsonDocument(data).toJson(QJsonDocument::Compact) + "\n\n";
+    for (QTcpSocket *client : std::as_const(m_eventClients)) {
+        client->write(message);
+    }
+}
+
+void ControlServer::onDownloadStarted(const DownloadItem &item)
+{
+    sendEvent("started", itemToJson(item));
+}
+
+void ControlServer::onMetadataReady(const DownloadItem &item)
+{
+    sendEvent("resolved", itemToJson(item));
+}
+
+void ControlServer::onItemUpdated(const DownloadItem &item)
+{
+    if (m_eventClients.isEmpty()) {
+        return;
+    }
+    m_pendingProgress.insert(item.id, item);
+    if (!m_eventTimer->isActive()) {
+        m_eventTimer->start(EVENT_INTERVAL_MS);
+    }
+}
+
+void ControlServer::onDownloadCompleted(const DownloadItem &item)
+{
+    // The last progress sample must not arrive after the completion
+    m_pendingProgress.remove(item.id);
+    sendEvent("completed", itemToJson(item));
+}
+
+void ControlServer::onDownloadFailed(const DownloadItem &item, const QString &error)
+{
+    m_pendingProgress.remove(item.id);
+    QJsonObject data = itemToJson(item);
+    data.insert("error", error);
+    sendEvent("failed", data);
+}
+
+void ControlServer::onGroupUpdated(const DownloadGroup &group)
+{
+    sendEvent("group", groupToJson(group));
+}
+
+void ControlServer::onQueueStatusChanged(int current, int total)
+{
+    Q_UNUSED(current);
+    Q_UNUSED(total);
+    sendEvent("queue", queueStatus());
+}
+
+void ControlServer::flushEvents()
+{
+    if (m_pendingProgress.isEmpty()) {
+        return;
+    }
+    // One event per tick with every item that moved
+    QJsonArray items;
+    for (const DownloadItem &item : std::as_const(m_pendingProgress)) {
+        items.append(itemToJson(item));
+    }
+    m_pendingProgress.clear();
+    sendEvent("progress", QJsonObject{ { "items", items } });
+}
+
+QJsonObject ControlServer::queueStatus() const
+{
+    QJsonArray active;
+    const QList<DownloadItem> running = m_queue->getActiveDownloads();
+    for (const DownloadItem &item : running) {
+        active.append(itemToJson(item));
+    }
+
+    QJsonObject status;
+    status.insert("running", m_queue->isRunning());
+    status.insert("paused", m_queue->isPaused());
+    status.insert("total", m_queue->getTotalCount());
+    status.insert("finished", m_queue->getCurrentIndex());
+    status.insert("pending", m_queue->getQueueSize());
+    status.insert("active", m_queue->getActiveCount());
+    status.insert("maxConcurrent", m_queue->getMaxConcurrentDownloads());
+    status.insert("maxMerges", m_queue->getMaxConcurrentMerges());
+    if (const MetadataCache *cache = m_queue->metadataCache()) {
+        status.insert("metadataCacheHits", cache->hits());
+        status.insert("metadataCacheMisses", cache->misses());
+    }
+    if (const DownloadArchive *archive = m_queue->archive()) {
+        status.insert("archivedVideos", archive->size());
+    }
+    DownloadQueue::FirstByteStats firstByte = m_queue->urgentFirstByteStats();
+    status.insert("bandwidthLimit", m_queue->currentBandwidthLimit());
+    status.insert("preemptions", m_queue->getPreemptionCount());
+    status.insert("urgentFirstByte", QJsonObject{ { "count", firstByte.count },
+                                                  { "meanMs", firstByte.meanMs() },
+                                                  { "maxMs", firstByte.maxMs } });
+    status.insert("runWindow", m_queue->runWindow().toString());
+    status.insert("runWindowOpen", m_queue->isRunWindowOpen());
+    status.insert("nextWindowChange", timeToJson(m_queue->nextWindowChange()));
+    status.insert("schedulingPolicy", SchedulingPolicy::kindName(m_queue->schedulingPolicy()));
+    status.insert("expectedMeanCompletion", m_queue->expectedMeanCompletion());
+    status.insert("activeItems", active);
+    return status;
+}
+
+QJsonObject ControlServer::itemToJson(const DownloadItem &item)
+{
+    // Credentials never leave the daemon
+    QJsonObject object;
+    object.insert("id", qint64(item.id));
+    object.insert("url", item.url);
+    object.insert("title", item.title);
+    object.insert("folder", item.downloadDir);
+    object.insert("status", item.getStatusString().toLower());
+    if (item.status == DownloadStatus::Downloading) {
+        object.insert("stage", DownloadItem::stageName(item.stage));
+    }
+    object.insert("priority", item.priority);
+    object.insert("priorityClass", DownloadItem::className(item.priorityClass()));
+    if (item.firstByteMs >= 0) {
+        object.insert("firstByteMs", item.firstByteMs);
+    }
+    if (item.groupId != 0) {
+        object.insert("groupId", qint64(item.groupId));
+    }
+    if (item.duration >= 0) {
+        object.insert("duration", item.duration);
+    }
+    if (item.estimatedBytes > 0) {
+        object.insert("estimatedBytes", item.estimatedBytes);
+    }
+    object.insert("progress", item.progress);
+    object.insert("downloadedBytes", item.downloadedBytes);
+    object.insert("totalBytes", item.totalBytes);
+    object.insert("speed", item.speed);
+    object.insert("eta", item.eta);
+    object.insert("retries", item.retryCount);
+    object.insert("addedTime", timeToJson(item.addedTime));
+    object.insert("startTime", timeToJson(item.startTime));
+    object.insert("finishTime", timeToJson(item.finishTime));
+    if (item.notBefore.isValid()) {
+        object.insert("notBefore", timeToJson(item.notBefore));
+    }
+    if (item.notAfter.isValid()) {
+        object.insert("notAfter", timeToJson(item.notAfter));
+    }
+    object.insert("stages", stagesToJson(item));
+    if (!item.errorMessage.isEmpty()) {
+        object.insert("error", item.errorMessage);
+    }
+    return object;
+}
+
+QJsonObject ControlServer::groupToJson(const DownloadGroup &group)
+{
+    QJsonObject object;
+    object.insert("id", qint64(group.id));
+    object.insert("url", group.url);
+    object.insert("title", group.title);
+    object.insert("expanding", group.expanding);
+    object.insert("queued", group.queued);
+    object.insert("completed", group.completed);
+    object.insert("failed", group.failed);
+    object.insert("skipped", group.skipped);
+    object.insert("progress", group.percent());
+    object.insert("finished", group.isFinished());
+    if (!group.error.isEmpty()) {
+        object.insert("error", group.error);
+    }
+    return object;
+}
@@ -0,0 +1,283 @@
+#include "vimeodownloader/apppaths.h"
+#include "vimeodownloader/batchrunner.h"
+#include "vimeodownloader/controlserver.h"
+#include "vimeodownloader/downloadqueue.h"
+#include "vimeodownloader/logmodel.h"
+#include "vimeodownloader/logsink.h"
+#include "vimeodownloader/toolsmanager.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QSettings>
+#include <QTextStream>
+#include <QTimer>
+
+#include <csignal>
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+volatile std::sig_atomic_t g_interrupted = 0;
+
+void onInterruptSignal(int)
+{
+    g_interrupted = 1;
+}
+
+// One URL per line; blank lines and # comments are skipped
+bool readUrlList(const QString &path, QStringList &urls)
+{
+    QFile file;
+    bool opened = false;
+    if (path == "-") {
+        opened = file.open(stdin, QIODevice::ReadOnly | QIODevice::Text);
+    } else {
+        file.setFileName(path);
+        opened = file.open(QIODevice::ReadOnly | QIODevice::Text);
+    }
+    if (!opened) {
+        std::fprintf(stderr, "Cannot read %s\n", qPrintable(path));
+        return false;
+    }
+
+    QTextStream stream(&file);
+    QString line;
+    while (stream.readLineInto(&line)) {
+        line = line.trimmed();
+        if (!line.isEmpty() && !line.startsWith('#')) {
+            urls << line;
+        }
+    }
+    return true;
+}
+
+// Ctrl+C / SIGTERM: the handler only sets a flag, the event loop acts on it
+template <typename Callback>
+void onInterrupt(QTimer &poll, QObject *context, Callback callback)
+{
+    std::signal(SIGINT, onInterruptSignal);
+    std::signal(SIGTERM, onInterruptSignal);
+    QObject::connect(&poll, &QTimer::timeout, context, [callback]() {
+        if (g_interrupted) {
+            callback();
+        }
+    });
+    poll.start(200);
+}
+
+// Long-running queue behind the HTTP control API; its journal lives apart
+// from the desktop app's so both can run on the same machine
+int runDaemon(QCoreApplication &app, const BatchRunner::Options &options, quint16 port, const QString &token)
+{
+    LogModel log(1000);
+    if (options.verbose) {
+        QObject::connect(&log, &LogModel::rowsInserted, &log, [&log](const QModelIndex &, int first, int last) {
+            for (int row = first; row <= last; ++row) {
+                std::fprintf(stderr, "[%s] %s\n", qPrintable(log.entry(row).source), qPrintable(log.entry(row).message));
+            }
+        });
+    }
+    LogSink *sink = nullptr;
+    if (!options.logDir.isEmpty()) {
+        sink = new LogSink(options.logDir, LogSink::Options());
+        log.setSink(sink);
+    }
+
+    int exitCode = BatchRunner::ExitOk;
+    {
+        ToolsManager tools(&log);
+        DownloadQueue queue(&log, &tools);
+        queue.setMaxConcurrentDownloads(options.maxConcurrent);
+        if (options.maxMerges > 0) {
+            queue.setMaxConcurrentMerges(options.maxMerges);
+        }
+        queue.setResumeEnabled(options.resume);
+        queue.setProgressInterval(options.progressInterval);
+        queue.setPrefetchDepth(options.prefetchDepth);
+        queue.enableMetadataCache(AppPaths::cacheDir() + "/metadata", qint64(options.metadataCacheHours) * 3600);
+        queue.enableJournal(AppPaths::configDir() + "/daemon");
+        queue.enableArchive(AppPaths::archivePath());
+        queue.setSkipArchived(options.skipArchived);
+        if (options.sync) {
+            queue.enableSync(AppPaths::syncStatePath());
+        }
+        queue.setSchedulingPolicy(SchedulingPolicy::kindFromName(options.scheduling));
+        queue.setSchedulingAging(qint64(options.agingMinutes) * 60);
+        queue.setFolderWeights(options.folderWeights);
+        queue.setBandwidthSchedule(options.bandwidth);
+        queue.setRunWindow(options.runWindow);
+
+        ControlServer::Defaults defaults;
+        defaults.username = options.username;
+        defaults.password = options.password;
+        defaults.downloadDir = options.downloadDir;
+        ControlServer server(&queue, defaults);
+        server.setToken(token);
+        if (!server.listen(QHostAddress::LocalHost, port)) {
+            std::fprintf(stderr, "Cannot listen on 127.0.0.1:%u: %s\n", unsigned(port), qPrintable(server.errorString()));
+            exitCode = BatchRunner::ExitUsage;
+        } else {
+            std::fprintf(stderr, "Listening on http://127.0.0.1:%u/api\n", unsigned(server.serverPort()));
+
+            QTimer interruptPoll;
+            onInterrupt(interruptPoll, &app, [&app]() { app.quit(); });
+            exitCode = app.exec();
+        }
+        // The queue destructor saves whatever is still pending in the journal
+    }
+
+    if (sink) {
+        log.setSink(nullptr);
+        delete sink;
+    }
+    return exitCode;
+}
+
+bool stdinIsTerminal()
+{
+#ifdef Q_OS_WIN
+    return _isatty(_fileno(stdin));
+#else
+    return isatty(fileno(stdin));
+#endif
+}
+}
+
+int main(int argc, char *argv[])
+{
+    // Sin GUI: no se cargan fuentes, estilos ni plugins de plataforma
+    QCoreApplication app(argc, argv);
+
+    // Mismos nombres que la aplicación de escritorio, para compartir config.ini
+    app.setApplicationName("VimeoDownloader");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("LGA");
+    app.setOrganizationDomain("lga.com");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Downloads every URL given on the command line, in list files or on stdin.\n"
+                                     "Progress goes to stderr; stdout gets one JSON line per URL and a final summary.\n"
+                                     "Exit codes: 0 all downloaded, 1 some failed, 2 usage error, 3 yt-dlp missing, 130 interrupted.\n"
+                                     "With --daemon it keeps a queue open behind a local HTTP API instead.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("urls", "URLs, or files with one URL per line (\"-\" reads stdin).", "[url|file...]");
+
+    QCommandLineOption inputOption({ "i", "input" }, "Read URLs from <file> (\"-\" for stdin). Repeatable.", "file");
+    QCommandLineOption jobsOption({ "j", "jobs" }, "Parallel downloads (default: download/maxConcurrent).", "n");
+    QCommandLineOption outputOption({ "o", "output" }, "Download folder (default: download/folder).", "dir");
+    QCommandLineOption userOption({ "u", "username" }, "Vimeo username (default: vimeo/username).", "user");
+    QCommandLineOption passwordOption("password", "Vimeo password (default: vimeo/password).", "password");
+    QCommandLineOption configOption("config", "Settings file (default: the desktop app's config.ini).", "path");
+    QCommandLineOption noResumeOption("no-resume", "Do not continue partial downloads.");
+    QCommandLineOption forceOption("force", "Download videos again even if the download archive has them.");
+    QCommandLineOption syncOption("sync", "Only list playlist, showcase and channel entries newer than the last sync.");
+    QCommandLineOption scheduleOption("schedule", "Order of pending downloads: fifo, shortest or fair (default: download/scheduling).", "policy");
+    QCommandLineOption limitRateOption("limit-rate", "Bandwidth shared by all downloads, e.g. 20M; 0 for none (default: download/bandwidthLimit).", "rate");
+    QCommandLineOption windowOption("window", "Only download during this time window, e.g. 22:00-07:00 (default: download/runWindow).", "window");
+    QCommandLineOption logDirOption("log-dir", "Write the JSON-lines log to <dir>.", "dir");
+    QCommandLineOption quietOption({ "q", "quiet" }, "No progress on stderr.");
+    QCommandLineOption verboseOption({ "v", "verbose" }, "Print the yt-dlp and queue log on stderr.");
+    QCommandLineOption daemonOption("daemon", "Run as a daemon with an HTTP control API on 127.0.0.1.");
+    QCommandLineOption portOption("port", "Daemon port (default: daemon/port or 8765).", "port");
+    QCommandLineOption tokenOption("token", "Require \"Authorization: Bearer <token>\" (default: daemon/token).", "token");
+    parser.addOptions({ inputOption, jobsOption, outputOption, userOption, passwordOption, configOption,
+                        noResumeOption, forceOption, syncOption, scheduleOption, limitRateOption, windowOption, logDirOption, quietOption, verboseOption, daemonOption, portOption, tokenOption });
+    parser.process(app);
+
+    QSettings settings(parser.isSet(configOption) ? parser.value(configOption) : AppPaths::configPath(),
+                       QSettings::IniFormat);
+
+    BatchRunner::Options options;
+    options.username = parser.isSet(userOption) ? parser.value(userOption) : settings.value("vimeo/username").toString();
+    options.password = parser.isSet(passwordOption) ? parser.value(passwordOption) : settings.value("vimeo/password").toString();
+    options.downloadDir = parser.isSet(outputOption) ? parser.value(outputOption) : settings.value("download/folder").toString();
+    options.maxConcurrent = qMax(1, parser.isSet(jobsOption) ? parser.value(jobsOption).toInt()
+                                                               : settings.value("download/maxConcurrent", 3).toInt());
+    options.maxMerges = settings.value("download/maxMerges", 0).toInt();
+    options.resume = !parser.isSet(noResumeOption) && settings.value("download/resume", true).toBool();
+    options.progressInterval = settings.value("download/progressInterval", 1.0).toDouble();
+    options.prefetchDepth = settings.value("download/prefetch", 3).toInt();
+    options.metadataCacheHours = settings.value("download/metadataCacheHours", 6).toInt();
+    options.skipArchived = !parser.isSet(forceOption) && settings.value("download/skipArchived", true).toBool();
+    options.sync = parser.isSet(syncOption) || settings.value("download/incrementalSync", false).toBool();
+    options.scheduling = parser.isSet(scheduleOption) ? parser.value(scheduleOption)
+                                                      : settings.value("download/scheduling", "fifo").toString();
+    options.agingMinutes = settings.value("download/agingMinutes", 30).toInt();
+    options.folderWeights = settings.value("download/folderWeights").toStringList();
+    bool knownPolicy = false;
+    SchedulingPolicy::kindFromName(options.scheduling, &knownPolicy);
+    if (!knownPolicy) {
+        std::fprintf(stderr, "Unknown scheduling policy: %s (fifo, shortest or fair)\n", qPrintable(options.scheduling));
+        return BatchRunner::ExitUsage;
+    }
+    // A rate given on the command line replaces the whole schedule
+    QString rate = parser.isSet(limitRateOption) ? parser.value(limitRateOption)
+                                                  : settings.value("download/bandwidthLimit", "0").toString();
+    bool validRate = false;
+    options.bandwidth.setDefaultLimit(BandwidthSchedule::parseRate(rate, &validRate));
+    if (!validRate) {
+        std::fprintf(stderr, "Invalid bandwidth limit: %s\n", qPrintable(rate));
+        return BatchRunner::ExitUsage;
+    }
+    QString badRule;
+    if (!parser.isSet(limitRateOption)
+        && !options.bandwidth.parse(settings.value("download/bandwidthSchedule").toStringList(), &badRule)) {
+        std::fprintf(stderr, "Invalid download/bandwidthSchedule entry: %s\n", qPrintable(badRule));
+        return BatchRunner::ExitUsage;
+    }
+    QString window = parser.isSet(windowOption) ? parser.value(windowOption)
+                                                : settings.value("download/runWindow").toString();
+    if (!window.trimmed().isEmpty() && !TimeWindow::parse(window, &options.runWindow)) {
+        std::fprintf(stderr, "Invalid download window: %s (e.g. 22:00-07:00 or \"Sat-Sun 00:00-24:00\")\n", qPrintable(window));
+        return BatchRunner::ExitUsage;
+    }
+    options.quiet = parser.isSet(quietOption);
+    options.verbose = parser.isSet(verboseOption);
+    options.logDir = parser.value(logDirOption);
+
+    if (parser.isSet(daemonOption)) {
+        quint16 port = quint16(parser.isSet(portOption) ? parser.value(portOption).toUInt()
+                                                         : settings.value("daemon/port", 8765).toUInt());
+        QString token = parser.isSet(tokenOption) ? parser.value(tokenOption) : settings.value("daemon/token").toString();
+        return runDaemon(app, options, port, token);
+    }
+
+    // URLs: positional arguments that look like URLs, everything else is a list file
+    QStringList urls;
+    QStringList inputs = parser.values(inputOption);
+    for (const QString &argument : parser.positionalArguments()) {
+        if (argument.contains("://")) {
+            urls << argument;
+        } else {
+            inputs << argument;
+        }
+    }
+    if (urls.isEmpty() && inputs.isEmpty() && !stdinIsTerminal()) {
+        inputs << "-";
+    }
+    for (const QString &input : std::as_const(inputs)) {
+        if (!readUrlList(input, urls)) {
+            return BatchRunner::ExitUsage;
+        }
+    }
+
+    options.urls = urls;
+
+    BatchRunner runner(options);
+    QObject::connect(&runner, &BatchRunner::finished, &app, &QCoreApplication::exit);
+    if (!runner.start()) {
+        return runner.exitCode();
+    }
+
+    QTimer interruptPoll;
+    onInterrupt(interruptPoll, &runner, [&runner]() { runner.interrupt(); });
+
+    return app.exec();
+}
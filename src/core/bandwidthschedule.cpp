@@ -0,0 +1,81 @@
+#include "vimeodownloader/bandwidthschedule.h"
+
+BandwidthSchedule::BandwidthSchedule()
+    : m_defaultLimit(0)
+{
+}
+
+bool BandwidthSchedule::parse(const QStringList &entries, QString *error)
+{
+    m_rules.clear();
+    bool valid = true;
+    for (const QString &entry : entries) {
+        QString text = entry.trimmed();
+        if (text.isEmpty()) {
+            continue;
+        }
+
+        Rule rule;
+        int separator = text.lastIndexOf('=');
+        bool ok = separator > 0 && TimeWindow::parse(text.left(separator), &rule.window);
+        if (ok) {
+            rule.limit = parseRate(text.mid(separator + 1), &ok);
+        }
+        if (!ok) {
+            if (valid && error) {
+                *error = text;
+            }
+            valid = false;
+            continue;
+        }
+        m_rules.append(rule);
+    }
+    return valid;
+}
+
+qint64 BandwidthSchedule::limitAt(const QDateTime &time) const
+{
+    for (const Rule &rule : m_rules) {
+        if (rule.window.contains(time)) {
+            return rule.limit;
+        }
+    }
+    return m_defaultLimit;
+}
+
+qint64 BandwidthSchedule::parseRate(const QString &text, bool *ok)
+{
+    QString value = text.trimmed().toLower();
+    if (value == "off" || value == "unlimited" || value == "none") {
+        if (ok) {
+            *ok = true;
+        }
+        return 0;
+    }
+    if (value.endsWith("/s")) {
+        value.chop(2);
+    }
+    if (value.endsWith('b')) {
+        value.chop(1);
+    }
+
+    double multiplier = 1.0;
+    if (value.endsWith('k')) {
+        multiplier = 1024.0;
+    } else if (value.endsWith('m')) {
+        multiplier = 1024.0 * 1024.0;
+    } else if (value.endsWith('g')) {
+        multiplier = 1024.0 * 1024.0 * 1024.0;
+    }
+    if (multiplier > 1.0) {
+        value.chop(1);
+    }
+
+    bool parsed = false;
+    double number = value.trimmed().toDouble(&parsed);
+    parsed = parsed && number >= 0;
+    if (ok) {
+        *ok = parsed;
+    }
+    return parsed ? qint64(number * multiplier) : 0;
+}
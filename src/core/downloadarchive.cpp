@@ -0,0 +1,256 @@
+#include "vimeodownloader/downloadarchive.h"
+#include "vimeodownloader/urlutils.h"
+
+#include <QCryptographicHash>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+constexpr quint32 ARCHIVE_MAGIC = 0x56444141; // "VDAA"
+constexpr quint32 FORMAT_VERSION = 1;
+// Bloom filter: 8 bits per table slot (16 per entry at the maximum load), 5 probes
+constexpr quint32 BLOOM_BITS_PER_SLOT = 8;
+constexpr int BLOOM_PROBES = 5;
+
+bool isPowerOfTwo(quint32 value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+}
+
+DownloadArchive::DownloadArchive(const QString &path)
+    : m_path(path)
+    , m_lock(path + ".lock")
+    , m_map(nullptr)
+    , m_lookups(0)
+    , m_filtered(0)
+{
+    open();
+}
+
+DownloadArchive::~DownloadArchive()
+{
+    close();
+}
+
+quint64 DownloadArchive::keyHash(const QString &url)
+{
+    QByteArray digest = QCryptographicHash::hash(UrlUtils::canonicalVideoKey(url).toUtf8(), QCryptographicHash::Sha1);
+    quint64 hash = qFromLittleEndian<quint64>(digest.constData());
+    return hash != 0 ? hash : 1;
+}
+
+qint64 DownloadArchive::fileSize(quint32 capacity)
+{
+    return qint64(sizeof(Header)) + qint64(capacity) * BLOOM_BITS_PER_SLOT / 8 + qint64(capacity) * qint64(sizeof(quint64));
+}
+
+bool DownloadArchive::contains(const QString &url) const
+{
+    if (!isOpen()) {
+        return false;
+    }
+    m_lookups++;
+    return containsHash(keyHash(url));
+}
+
+bool DownloadArchive::add(const QString &url)
+{
+    if (!isOpen()) {
+        return false;
+    }
+    quint64 hash = keyHash(url);
+    if (containsHash(hash)) {
+        return false;
+    }
+    // Linear probing stays short while the table is at most half full
+    if (quint64(header()->count + 1) * 2 > header()->capacity && !grow()) {
+        return false;
+    }
+    insertHash(hash);
+    return true;
+}
+
+int DownloadArchive::size() const
+{
+    return isOpen() ? int(header()->count) : 0;
+}
+
+bool DownloadArchive::containsHash(quint64 hash) const
+{
+    const quint64 *filter = bloom();
+    quint64 bitMask = quint64(header()->bloomWords) * 64 - 1;
+    quint32 h1 = quint32(hash);
+    quint32 h2 = quint32(hash >> 32) | 1;
+    for (int i = 0; i < BLOOM_PROBES; ++i) {
+        quint64 bit = (h1 + quint64(i) * h2) & bitMask;
+        if (!(filter[bit / 64] & (quint64(1) << (bit % 64)))) {
+            m_filtered++;
+            return false;
+        }
+    }
+
+    const quint64 *table = slotArray();
+    quint32 mask = header()->capacity - 1;
+    for (quint32 index = quint32(hash) & mask;; index = (index + 1) & mask) {
+        if (table[index] == hash) {
+            return true;
+        }
+        if (table[index] == 0) {
+            return false;
+        }
+    }
+}
+
+void DownloadArchive::insertHash(quint64 hash)
+{
+    // The filter is set first: a crash in between can only cost a table probe
+    quint64 *filter = bloom();
+    quint64 bitMask = quint64(header()->bloomWords) * 64 - 1;
+    quint32 h1 = quint32(hash);
+    quint32 h2 = quint32(hash >> 32) | 1;
+    for (int i = 0; i < BLOOM_PROBES; ++i) {
+        quint64 bit = (h1 + quint64(i) * h2) & bitMask;
+        filter[bit / 64] |= quint64(1) << (bit % 64);
+    }
+
+    quint64 *table = slotArray();
+    quint32 mask = header()->capacity - 1;
+    quint32 index = quint32(hash) & mask;
+    while (table[index] != 0) {
+        index = (index + 1) & mask;
+    }
+    table[index] = hash;
+    header()->count++;
+}
+
+bool DownloadArchive::open()
+{
+    if (!m_lock.isLocked() && !m_lock.tryLock(0)) {
+        m_error = QString("%1 is in use by another process").arg(m_path);
+        return false;
+    }
+    
+    QString newPath = m_path + ".new";
+    if (!QFile::exists(m_path) && QFile::exists(newPath)) {
+        // grow() stopped between removing the old table and renaming the new one
+        QFile::rename(newPath, m_path);
+    } else {
+        QFile::remove(newPath);
+    }
+    if (!QFile::exists(m_path) && !create(m_path, INITIAL_CAPACITY)) {
+        return false;
+    }
+
+    m_file.setFileName(m_path);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    Header stored;
+    bool valid = m_file.read(reinterpret_cast<char *>(&stored), sizeof(Header)) == qint64(sizeof(Header))
+                 && stored.magic == ARCHIVE_MAGIC && stored.version == FORMAT_VERSION
+                 && isPowerOfTwo(stored.capacity) && stored.count < stored.capacity
+                 && stored.bloomWords == stored.capacity * BLOOM_BITS_PER_SLOT / 64
+                 && m_file.size() == fileSize(stored.capacity);
+    if (!valid) {
+        // Kept for inspection; downloads are not blocked by a damaged archive
+        m_file.close();
+        QString badPath = m_path + ".bad";
+        QFile::remove(badPath);
+        QFile::rename(m_path, badPath);
+        if (!create(m_path, INITIAL_CAPACITY) || !m_file.open(QIODevice::ReadWrite)) {
+            m_error = QString("Cannot recreate %1").arg(m_path);
+            return false;
+        }
+        m_error = QString("Damaged archive moved to %1").arg(badPath);
+    }
+
+    m_map = m_file.map(0, m_file.size());
+    if (!m_map) {
+        m_error = m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+bool DownloadArchive::create(const QString &path, quint32 capacity)
+{
+    Header fresh;
+    std::memset(&fresh, 0, sizeof(Header));
+    fresh.magic = ARCHIVE_MAGIC;
+    fresh.version = FORMAT_VERSION;
+    fresh.capacity = capacity;
+    fresh.bloomWords = capacity * BLOOM_BITS_PER_SLOT / 64;
+
+    // resize() fills the filter and the table with zeros
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(reinterpret_cast<const char *>(&fresh), sizeof(Header)) != qint64(sizeof(Header))
+        || !file.resize(fileSize(capacity))) {
+        m_error = file.errorString();
+        file.close();
+        QFile::remove(path);
+        return false;
+    }
+    return true;
+}
+
+void DownloadArchive::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_file.close();
+}
+
+bool DownloadArchive::grow()
+{
+    quint32 capacity = header()->capacity;
+    if (capacity > (1u << 30)) {
+        m_error = "Archive is full";
+        return false;
+    }
+
+    // The bigger table is built next to the current one and replaces it
+    // only when complete
+    QString newPath = m_path + ".new";
+    if (!create(newPath, capacity * 2)) {
+        return false;
+    }
+    QFile newFile(newPath);
+    uchar *newMap = nullptr;
+    if (newFile.open(QIODevice::ReadWrite)) {
+        newMap = newFile.map(0, newFile.size());
+    }
+    if (!newMap) {
+        m_error = newFile.errorString();
+        newFile.close();
+        QFile::remove(newPath);
+        return false;
+    }
+
+    const quint64 *oldTable = slotArray();
+    uchar *oldMap = m_map;
+    m_map = newMap;
+    for (quint32 i = 0; i < capacity; ++i) {
+        if (oldTable[i] != 0) {
+            insertHash(oldTable[i]);
+        }
+    }
+    m_map = oldMap;
+    newFile.unmap(newMap);
+    newFile.close();
+
+    // Windows cannot replace a mapped file
+    close();
+    QFile::remove(m_path);
+    if (!QFile::rename(newPath, m_path)) {
+        m_error = QString("Cannot replace %1").arg(m_path);
+    }
+    return open();
+}
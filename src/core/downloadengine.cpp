@@ -0,0 +1,326 @@
+#include "vimeodownloader/downloadengine.h"
+#include "vimeodownloader/downloadworker.h"
+
+#include <QThreadPool>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+// A bucket holds at most this many seconds of its share (burst allowance)
+constexpr double BANDWIDTH_BURST_SECONDS = 1.0;
+// A transfer slower than its share is given this much more than its speed
+constexpr double BANDWIDTH_HEADROOM = 1.25;
+}
+
+DownloadEngine::DownloadEngine(QObject *parent)
+    : QObject(parent)
+    , m_resumeEnabled(true)
+    , m_progressInterval(0.5)
+    , m_slotPrefix(false)
+    , m_diskPool(nullptr)
+    , m_bandwidthLimit(0)
+    , m_bandwidthTimer(nullptr)
+    , m_flushTimer(nullptr)
+{
+    m_diskPool = new QThreadPool(this);
+    m_diskPool->setMaxThreadCount(DISK_POOL_THREADS);
+    
+    // Child of the engine, so it follows it to the engine thread
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    connect(m_flushTimer, &QTimer::timeout, this, &DownloadEngine::flush);
+    
+    m_bandwidthTimer = new QTimer(this);
+    m_bandwidthTimer->setInterval(BANDWIDTH_TICK_MS);
+    connect(m_bandwidthTimer, &QTimer::timeout, this, &DownloadEngine::balanceBandwidth);
+}
+
+DownloadEngine::~DownloadEngine()
+{
+    shutdown();
+}
+
+DownloadWorker *DownloadEngine::worker(int slot)
+{
+    while (m_workers.size() <= slot) {
+        m_workers.append(nullptr);
+    }
+
+    DownloadWorker *worker = m_workers[slot];
+    if (!worker) {
+        worker = new DownloadWorker(slot, this);
+        worker->setResumeEnabled(m_resumeEnabled);
+        worker->setProgressInterval(m_progressInterval);
+        worker->setDiskPool(m_diskPool);
+        connect(worker, &DownloadWorker::progressChanged, this, &DownloadEngine::onWorkerProgress);
+        connect(worker, &DownloadWorker::logMessage, this, &DownloadEngine::onWorkerLog);
+        connect(worker, &DownloadWorker::rateLimited, this, &DownloadEngine::onWorkerRateLimited);
+        connect(worker, &DownloadWorker::suspendedChanged, this, &DownloadEngine::onWorkerSuspendedChanged);
+        connect(worker, &DownloadWorker::stageChanged, this, &DownloadEngine::onWorkerStageChanged);
+        connect(worker, &DownloadWorker::finished, this, &DownloadEngine::onWorkerFinished);
+        m_workers[slot] = worker;
+    }
+    return worker;
+}
+
+void DownloadEngine::startDownload(int slot, const DownloadItem &item, const QString &ytDlpPath, const QString &ffmpegPath)
+{
+    DownloadWorker *target = worker(slot);
+    target->setResumeEnabled(m_resumeEnabled);
+    target->setProgressInterval(m_progressInterval);
+    target->setMetadataCacheDir(m_metadataCacheDir);
+    target->start(item, ytDlpPath, ffmpegPath);
+    m_dirtySlots.insert(slot);
+    scheduleFlush();
+}
+
+void DownloadEngine::cancelDownload(int slot)
+{
+    if (slot >= 0 && slot < m_workers.size() && m_workers[slot]) {
+        m_workers[slot]->cancel();
+    }
+}
+
+void DownloadEngine::pauseDownload(int slot)
+{
+    if (slot < 0 || slot >= m_workers.size() || !m_workers[slot]) {
+        return;
+    }
+
+    // The queue marks the slot suspended when it asks; correct it if that was not possible
+    if (!m_workers[slot]->pause()) {
+        emit workerSuspendedChanged(slot, m_workers[slot]->isSuspended());
+    }
+}
+
+void DownloadEngine::resumeDownload(int slot)
+{
+    if (slot < 0 || slot >= m_workers.size() || !m_workers[slot]) {
+        return;
+    }
+
+    if (!m_workers[slot]->resume()) {
+        emit workerSuspendedChanged(slot, m_workers[slot]->isSuspended());
+    }
+}
+
+void DownloadEngine::setResumeEnabled(bool enabled)
+{
+    m_resumeEnabled = enabled;
+}
+
+void DownloadEngine::setProgressInterval(double seconds)
+{
+    m_progressInterval = seconds;
+}
+
+void DownloadEngine::setMetadataCacheDir(const QString &directory)
+{
+    m_metadataCacheDir = directory;
+}
+
+void DownloadEngine::setSlotPrefix(bool enabled)
+{
+    m_slotPrefix = enabled;
+}
+
+void DownloadEngine::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    m_bandwidthLimit = qMax<qint64>(0, bytesPerSecond);
+    if (m_bandwidthLimit > 0) {
+        if (!m_bandwidthTimer->isActive()) {
+            m_bandwidthClock.start();
+            m_bandwidthTimer->start();
+        }
+        return;
+    }
+    
+    m_bandwidthTimer->stop();
+    m_shares.clear();
+    for (DownloadWorker *worker : std::as_const(m_workers)) {
+        if (worker && worker->isThrottled()) {
+            worker->setThrottled(false);
+        }
+    }
+}
+
+void DownloadEngine::balanceBandwidth()
+{
+    qint64 now = m_bandwidthClock.elapsed();
+    // Bytes only move when yt-dlp reports progress, so a bucket holds at least two reports
+    double burstSeconds = qMax(BANDWIDTH_BURST_SECONDS, 2.0 * m_progressInterval);
+    
+    // Only transfers use the link; anything else gives its share back
+    QList<QPair<double, int>> demands; // Bytes/s it would use, slot
+    for (int slot = 0; slot < m_workers.size(); ++slot) {
+        DownloadWorker *worker = m_workers[slot];
+        bool fetching = worker && worker->isBusy() && !worker->isSuspended()
+                        && worker->item().stage == DownloadStage::Fetch;
+        if (!fetching) {
+            if (worker && worker->isThrottled()) {
+                worker->setThrottled(false);
+            }
+            m_shares.remove(slot);
+            continue;
+        }
+        // Last reported speed, unknown (infinite) before the first sample
+        double speed = worker->item().speed;
+        demands.append({ speed > 0 ? speed * BANDWIDTH_HEADROOM : std::numeric_limits<double>::infinity(), slot });
+    }
+    if (demands.isEmpty()) {
+        return;
+    }
+    
+    // Max-min fair: slowest first, each takes its demand or an equal part of what is left
+    std::sort(demands.begin(), demands.end());
+    double remaining = double(m_bandwidthLimit);
+    int left = demands.size();
+    for (const auto &demand : std::as_const(demands)) {
+        double allocation = qMin(demand.first, remaining / left);
+        remaining -= allocation;
+        left--;
+        
+        DownloadWorker *worker = m_workers[demand.second];
+        const DownloadItem &item = worker->item();
+        BandwidthShare &share = m_shares[demand.second];
+        if (share.itemId != item.id) {
+            share = BandwidthShare();
+            share.itemId = item.id;
+            share.lastBytes = item.downloadedBytes;
+            share.settledMs = now;
+        }
+        // Settled per progress report, so refill and spending cover the same
+        // span; a stopped worker reports nothing and refills on every tick
+        if (item.downloadedBytes != share.lastBytes || worker->isThrottled()) {
+            double seconds = (now - share.settledMs) / 1000.0;
+            qint64 spent = qMax<qint64>(0, item.downloadedBytes - share.lastBytes);
+            share.tokens = qMin(share.tokens + allocation * seconds, allocation * burstSeconds) - double(spent);
+            share.lastBytes = item.downloadedBytes;
+            share.settledMs = now;
+        }
+        
+        bool overBudget = share.tokens < 0;
+        if (overBudget != worker->isThrottled()) {
+            worker->setThrottled(overBudget);
+        }
+    }
+}
+
+void DownloadEngine::trimWorkers(int slotCount)
+{
+    // Only trailing slots can be removed so slot numbers stay stable
+    while (m_workers.size() > slotCount && (!m_workers.last() || !m_workers.last()->isBusy())) {
+        DownloadWorker *last = m_workers.takeLast();
+        if (last) {
+            last->disconnect(this);
+            last->deleteLater();
+        }
+    }
+}
+
+void DownloadEngine::shutdown()
+{
+    m_flushTimer->stop();
+    m_bandwidthTimer->stop();
+    m_shares.clear();
+    // Verify/move jobs report back to their worker, which must still exist
+    m_diskPool->waitForDone();
+    // Worker destructors kill their process groups
+    for (DownloadWorker *worker : m_workers) {
+        if (worker) {
+            worker->disconnect(this);
+            delete worker;
+        }
+    }
+    m_workers.clear();
+    m_dirtySlots.clear();
+    m_pendingLines.clear();
+}
+
+void DownloadEngine::onWorkerProgress(int slot, int percentage)
+{
+    Q_UNUSED(percentage);
+    m_dirtySlots.insert(slot);
+    scheduleFlush();
+}
+
+void DownloadEngine::onWorkerLog(int slot, const QString &message)
+{
+    // Timestamped here, not when the batch reaches the log
+    QString text = m_slotPrefix ? QString("[%1] %2").arg(slot + 1).arg(message) : message;
+    quint64 itemId = m_workers[slot] ? m_workers[slot]->item().id : 0;
+    m_pendingLines.append(LogEntry(LogEntry::levelForMessage(message), "yt-dlp", text, itemId));
+    scheduleFlush();
+}
+
+void DownloadEngine::onWorkerRateLimited(int slot)
+{
+    flush();
+    emit workerRateLimited(slot, m_workers[slot]->item().url);
+}
+
+void DownloadEngine::onWorkerSuspendedChanged(int slot, bool suspended)
+{
+    flush();
+    emit workerSuspendedChanged(slot, suspended);
+}
+
+void DownloadEngine::onWorkerStageChanged(int slot, DownloadStage stage)
+{
+    Q_UNUSED(stage);
+    // Leaving the network stages frees a download slot: publish it now
+    m_dirtySlots.insert(slot);
+    flush();
+}
+
+void DownloadEngine::onWorkerFinished(int slot, const DownloadItem &item)
+{
+    // Deliver the last progress and log lines before the completion
+    m_dirtySlots.remove(slot);
+    flush();
+
+    DownloadWorker *finished = m_workers[slot];
+    emit workerFinished(slot, item, finished->attemptReusedBytes(), finished->attemptTransferredBytes());
+}
+
+void DownloadEngine::scheduleFlush()
+{
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start(SNAPSHOT_INTERVAL_MS);
+    }
+}
+
+void DownloadEngine::flush()
+{
+    m_flushTimer->stop();
+
+    if (!m_pendingLines.isEmpty()) {
+        emit logBatchReady(m_pendingLines);
+        m_pendingLines.clear();
+    }
+
+    if (m_dirtySlots.isEmpty()) {
+        return;
+    }
+
+    QList<WorkerSnapshot> snapshots;
+    snapshots.reserve(m_dirtySlots.size());
+    for (int slot : std::as_const(m_dirtySlots)) {
+        if (slot < 0 || slot >= m_workers.size() || !m_workers[slot] || !m_workers[slot]->isBusy()) {
+            continue;
+        }
+        WorkerSnapshot snapshot;
+        snapshot.slot = slot;
+        snapshot.busy = true;
+        snapshot.suspended = m_workers[slot]->isSuspended();
+        snapshot.item = m_workers[slot]->item();
+        snapshots.append(snapshot);
+    }
+    m_dirtySlots.clear();
+
+    if (!snapshots.isEmpty()) {
+        emit snapshotsReady(snapshots);
+    }
+}
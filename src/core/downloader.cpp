@@ -4,7 +4,6 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QCoreApplication>
-#include <QRegularExpression>
 #include <QFile>
 
 Downloader::Downloader(QObject *parent)
@@ -67,6 +66,9 @@ void Downloader::downloadVideo(const QString &url)
     
     m_currentUrl = url;
     m_isDownloading = true;
+    m_parser.reset();
+    m_outputLines.clear();
+    m_errorLines.clear();
     
     // Directorio de descarga (Escritorio del usuario)
     QString downloadDir = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
@@ -74,7 +76,7 @@ void Downloader::downloadVideo(const QString &url)
     // Argumentos para yt-dlp
     QStringList arguments;
     // Use a safer output template that avoids problematic characters
-    arguments << "--output" << downloadDir + "/%(title).200s.%(ext)s";
+    arguments << "--output" << QString(downloadDir).replace("%", "%%") + "/%(title).200s.%(ext)s";
     arguments << "--restrict-filenames"; // Restrict filenames to ASCII characters
     // Use QuickTime-compatible formats: MP4 video + M4A audio, fallback to best MP4
     arguments << "--format" << "bestvideo[vcodec^=avc1][ext=mp4]+bestaudio[acodec^=mp4a][ext=m4a]/best[vcodec^=avc1][ext=mp4]";
@@ -186,32 +188,18 @@ void Downloader::onProcessOutput()
 {
     if (!m_process) return;
     
-    // Leer salida estándar
-    QByteArray data = m_process->readAllStandardOutput();
-    if (!data.isEmpty()) {
-        QString output = QString::fromUtf8(data).trimmed();
-        emit logMessage(output);
+    // Leer salida estándar línea a línea (un chunk puede cortar una línea)
+    m_outputLines.append(m_process->readAllStandardOutput(), [this](QByteArrayView line) {
+        emit logMessage(QString::fromUtf8(line).trimmed());
         
-        // Intentar extraer progreso si está disponible
-        if (output.contains("%")) {
-            // Buscar patrones de progreso típicos de yt-dlp
-            // Ejemplo: "[download]  45.2% of 123.45MiB at 1.23MiB/s ETA 00:30"
-            QRegularExpression progressRegex("\\[download\\]\\s+(\\d+(?:\\.\\d+)?)%");
-            QRegularExpressionMatch match = progressRegex.match(output);
-            if (match.hasMatch()) {
-                bool ok;
-                double progress = match.captured(1).toDouble(&ok);
-                if (ok) {
-                    emit downloadProgress(static_cast<int>(progress));
-                }
-            }
+        // Ejemplo: "[download]  45.2% of 123.45MiB at 1.23MiB/s ETA 00:30"
+        if (m_parser.parseLine(line) == OutputParser::Progress && m_parser.progress().percent >= 0) {
+            emit downloadProgress(static_cast<int>(m_parser.progress().percent));
         }
-    }
+    });
     
     // Leer salida de error
-    QByteArray errorData = m_process->readAllStandardError();
-    if (!errorData.isEmpty()) {
-        QString errorOutput = QString::fromUtf8(errorData).trimmed();
-        emit logMessage(QString("ERROR: %1").arg(errorOutput));
-    }
+    m_errorLines.append(m_process->readAllStandardError(), [this](QByteArrayView line) {
+        emit logMessage(QString("ERROR: %1").arg(QString::fromUtf8(line).trimmed()));
+    });
 }
@@ -1,59 +1,1120 @@
 #include "vimeodownloader/downloadqueue.h"
+#include "vimeodownloader/downloadarchive.h"
+#include "vimeodownloader/formatutils.h"
+#include "vimeodownloader/logmodel.h"
+#include "vimeodownloader/metadatacache.h"
+#include "vimeodownloader/queuejournal.h"
+#include "vimeodownloader/syncstore.h"
 #include "vimeodownloader/toolsmanager.h"
+#include "vimeodownloader/urlutils.h"
 
-#include <QRegularExpression>
-#include <QMutexLocker>
+#include <QHash>
+#include <QMap>
+#include <QThread>
 #include <QTimer>
 
-DownloadQueue::DownloadQueue(QTextEdit *logOutput, QProgressBar *progressBar, QGroupBox *progressGroup, ToolsManager *toolsManager, QObject *parent)
+namespace {
+// How many times a rate-limited download is put back in the queue
+constexpr int MAX_RATE_LIMIT_RETRIES = 3;
+// How many times a failed download with partial files is resumed
+constexpr int MAX_RESUME_RETRIES = 3;
+// Journal compaction: periodically, or as soon as this many records piled up
+constexpr int JOURNAL_COMPACT_INTERVAL_MS = 60000;
+constexpr int JOURNAL_COMPACT_RECORDS = 10000;
+// Finished items kept in the snapshot: the latest ones, plus older failed
+// ones whose partial files can still be resumed
+constexpr int JOURNAL_FINISHED_HISTORY = 1000;
+// How often the bandwidth schedule is looked at
+constexpr int BANDWIDTH_CHECK_INTERVAL_MS = 60000;
+// Longest sleep until a window change, so clock changes are caught up
+constexpr qint64 WINDOW_MAX_SLEEP_MS = 3600000;
+}
+
+DownloadQueue::DownloadQueue(LogModel *log, ToolsManager *toolsManager, QObject *parent)
     : QObject(parent)
-    , m_logOutput(logOutput)
-    , m_progressBar(progressBar)
-    , m_progressGroup(progressGroup)
+    , m_log(log)
     , m_toolsManager(toolsManager)
-    , m_currentProcess(nullptr)
+    , m_nextId(1)
+    , m_archive(nullptr)
+    , m_skipArchived(true)
+    , m_journal(nullptr)
+    , m_journalTimer(nullptr)
+    , m_engineThread(nullptr)
+    , m_engine(nullptr)
+    , m_maxConcurrent(1)
+    , m_maxMerges(qMax(1, QThread::idealThreadCount() / 2))
+    , m_drainScheduled(false)
+    , m_expander(nullptr)
+    , m_syncStore(nullptr)
+    , m_prefetcher(nullptr)
+    , m_prefetchDepth(3)
+    , m_metadataCache(nullptr)
+    , m_loggedCacheLookups(0)
+    , m_throttleTimer(nullptr)
+    , m_slotRate(0.0)
+    , m_preemptionCount(0)
+    , m_bandwidthLimit(0)
+    , m_bandwidthTimer(nullptr)
+    , m_windowTimer(nullptr)
     , m_isRunning(false)
     , m_isPaused(false)
     , m_completedCount(0)
     , m_totalCount(0)
-    , m_hasCurrentDownload(false)
-    , m_totalFragments(0)
-    , m_currentFragment(0)
+    , m_resumeEnabled(true)
+    , m_totalReusedBytes(0)
+    , m_totalTransferredBytes(0)
+    , m_progressInterval(0.5)
+{
+    // Wakes the queue when a rate-limited host leaves its cooldown
+    m_throttleTimer = new QTimer(this);
+    m_throttleTimer->setSingleShot(true);
+    connect(m_throttleTimer, &QTimer::timeout, this, &DownloadQueue::processNextDownload);
+    
+    // Time-of-day bandwidth changes
+    m_bandwidthTimer = new QTimer(this);
+    m_bandwidthTimer->setInterval(BANDWIDTH_CHECK_INTERVAL_MS);
+    connect(m_bandwidthTimer, &QTimer::timeout, this, &DownloadQueue::applyBandwidthSchedule);
+    
+    // Wakes the queue when a run window or an item's window opens or closes
+    m_windowTimer = new QTimer(this);
+    m_windowTimer->setSingleShot(true);
+    connect(m_windowTimer, &QTimer::timeout, this, &DownloadQueue::onWindowTimer);
+    
+    m_hostThrottle.setMaxLimit(m_maxConcurrent);
+    
+    m_prefetcher = new MetadataPrefetcher(this);
+    connect(m_prefetcher, &MetadataPrefetcher::resolved, this, &DownloadQueue::onMetadataResolved);
+    connect(m_prefetcher, &MetadataPrefetcher::failed, this, &DownloadQueue::onMetadataFailed);
+    
+    m_expander = new PlaylistExpander(this);
+    connect(m_expander, &PlaylistExpander::titleResolved, this, &DownloadQueue::onGroupTitle);
+    connect(m_expander, &PlaylistExpander::entriesReady, this, &DownloadQueue::onGroupEntries);
+    connect(m_expander, &PlaylistExpander::syncListed, this, &DownloadQueue::onSyncListed);
+    connect(m_expander, &PlaylistExpander::finished, this, &DownloadQueue::onGroupListed);
+    
+    // yt-dlp processes and their output parsing run off the GUI thread
+    m_engineThread = new QThread(this);
+    m_engineThread->setObjectName("DownloadEngine");
+    m_engine = new DownloadEngine;
+    m_engine->moveToThread(m_engineThread);
+    connect(m_engine, &DownloadEngine::snapshotsReady, this, &DownloadQueue::onEngineSnapshots);
+    connect(m_engine, &DownloadEngine::logBatchReady, this, &DownloadQueue::onEngineLogBatch);
+    connect(m_engine, &DownloadEngine::workerRateLimited, this, &DownloadQueue::onWorkerRateLimited);
+    connect(m_engine, &DownloadEngine::workerSuspendedChanged, this, &DownloadQueue::onWorkerSuspendedChanged);
+    connect(m_engine, &DownloadEngine::workerFinished, this, &DownloadQueue::onWorkerFinished);
+    m_engineThread->start();
+}
+
+DownloadQueue::~DownloadQueue()
+{
+    // Running downloads are saved as interrupted and resume on next start;
+    // submissions not drained yet are journaled first so they are not lost
+    // (their submitters may be gone: no callbacks)
+    if (m_journal) {
+        takeSubmissions(false);
+        m_journal->compact(journalState());
+        delete m_journal;
+    }
+    
+    // Stop every process from the engine thread, then the thread itself
+    m_engine->disconnect(this);
+    QMetaObject::invokeMethod(m_engine, &DownloadEngine::shutdown, Qt::BlockingQueuedConnection);
+    m_engineThread->quit();
+    m_engineThread->wait();
+    delete m_engine;
+    
+    m_prefetcher->setCache(nullptr);
+    delete m_metadataCache;
+    delete m_archive;
+    delete m_syncStore;
+}
+
+int DownloadQueue::enableJournal(const QString &directory)
+{
+    if (m_journal) {
+        return 0;
+    }
+    
+    m_journal = new QueueJournal(directory);
+    QueueJournalState state = m_journal->restore();
+    
+    m_nextId = qMax(m_nextId, state.nextId);
+    m_completedDownloads = state.finished;
+    m_completedCount = m_completedDownloads.size();
+    QMap<quint64, QString> labels;
+    for (const DownloadItem &item : state.pending) {
+        insertPending(item, false);
+        m_inFlight.insert(UrlUtils::canonicalVideoKey(item.url), item.id);
+        labels.insert(item.id, item.title.isEmpty() ? item.url : item.title);
+    }
+    
+    // Groups are rebuilt from their items; listings cut short are not resumed
+    auto countInGroup = [this](const DownloadItem &item) {
+        if (item.groupId == 0) {
+            return;
+        }
+        DownloadGroup &group = m_groups[item.groupId];
+        group.id = item.groupId;
+        group.expanding = false;
+        group.queued++;
+        if (item.status == DownloadStatus::Completed) {
+            group.completed++;
+        } else if (item.isFinished()) {
+            group.failed++;
+        }
+        m_nextId = qMax(m_nextId, item.groupId + 1);
+    };
+    for (const DownloadItem &item : std::as_const(m_completedDownloads)) {
+        countInGroup(item);
+    }
+    for (const DownloadItem &item : std::as_const(m_queue)) {
+        countInGroup(item);
+    }
+    if (m_log) {
+        m_log->setItemLabels(labels);
+    }
+    m_totalCount = m_completedCount + m_queue.size();
+    
+    // Start from a fresh snapshot so the journal only holds new events
+    m_journal->compact(journalState());
+    
+    m_journalTimer = new QTimer(this);
+    connect(m_journalTimer, &QTimer::timeout, this, &DownloadQueue::compactJournal);
+    m_journalTimer->start(JOURNAL_COMPACT_INTERVAL_MS);
+    
+    if (!state.pending.isEmpty()) {
+        logMessage(QString("=== Restored %1 queued downloads (%2 interrupted, resuming) ===")
+                   .arg(state.pending.size()).arg(state.interruptedCount));
+        emit queueStatusChanged(m_completedCount, m_totalCount);
+        
+        if (!m_isRunning && !m_isPaused) {
+            QTimer::singleShot(100, this, &DownloadQueue::startQueue);
+        }
+    }
+    
+    return state.pending.size();
+}
+
+void DownloadQueue::enableMetadataCache(const QString &directory, qint64 ttlSeconds)
+{
+    m_prefetcher->setCache(nullptr);
+    delete m_metadataCache;
+    m_metadataCache = nullptr;
+    
+    QString cacheDir;
+    if (ttlSeconds > 0) {
+        m_metadataCache = new MetadataCache(directory, ttlSeconds);
+        m_loggedCacheLookups = 0;
+        int expired = m_metadataCache->prune();
+        if (expired > 0) {
+            logMessage(QString("Metadata cache: %1 expired entries removed").arg(expired));
+        }
+        cacheDir = directory;
+    }
+    m_prefetcher->setCache(m_metadataCache);
+    QMetaObject::invokeMethod(m_engine, [engine = m_engine, cacheDir]() { engine->setMetadataCacheDir(cacheDir); });
+}
+
+int DownloadQueue::enableArchive(const QString &path)
+{
+    delete m_archive;
+    m_archive = new DownloadArchive(path);
+    if (!m_archive->errorString().isEmpty()) {
+        logMessage(QString("WARNING: Download archive: %1").arg(m_archive->errorString()));
+    }
+    if (!m_archive->isOpen()) {
+        delete m_archive;
+        m_archive = nullptr;
+        return -1;
+    }
+    
+    // Downloads finished before the archive existed (restored from the journal)
+    for (const DownloadItem &item : std::as_const(m_completedDownloads)) {
+        if (item.status == DownloadStatus::Completed) {
+            m_archive->add(item.url);
+        }
+    }
+    return m_archive->size();
+}
+
+void DownloadQueue::enableSync(const QString &path)
+{
+    delete m_syncStore;
+    m_syncStore = new SyncStore(path);
+}
+
+QueueJournalState DownloadQueue::journalState() const
+{
+    QueueJournalState state;
+    state.nextId = m_nextId;
+    state.pending = getActiveDownloads();
+    for (const DownloadItem &item : m_queue) {
+        state.pending.append(item);
+    }
+    // The full history stays in memory; the snapshot written every minute
+    // stays bounded however long the queue runs
+    int recent = qMax(0, int(m_completedDownloads.size()) - JOURNAL_FINISHED_HISTORY);
+    for (int i = 0; i < m_completedDownloads.size(); ++i) {
+        const DownloadItem &item = m_completedDownloads.at(i);
+        if (i >= recent || (item.status != DownloadStatus::Completed && !item.partialFiles.isEmpty())) {
+            state.finished.append(item);
+        }
+    }
+    return state;
+}
+
+void DownloadQueue::compactJournal()
+{
+    if (m_journal && m_journal->recordsSinceCompaction() > 0) {
+        m_journal->compact(journalState());
+    }
+}
+
+void DownloadQueue::maybeCompactJournal()
+{
+    if (m_journal && m_journal->recordsSinceCompaction() >= JOURNAL_COMPACT_RECORDS) {
+        m_journal->compact(journalState());
+    }
+}
+
+quint64 DownloadQueue::addDownload(const QString &url, const QString &username, const QString &password, const QString &downloadDir, int priority)
+{
+    if (UrlUtils::isCollectionUrl(url)) {
+        DownloadItem source(url, username, password, downloadDir);
+        source.priority = priority;
+        return addGroup(source);
+    }
+    
+    quint64 existingId = 0;
+    if (isDuplicate(url, priority, &existingId)) {
+        if (existingId != 0) {
+            logMessage(QString("Already in the queue, merged: %1").arg(url), existingId);
+        } else {
+            logMessage(QString("Already downloaded (download archive), skipped: %1").arg(url));
+        }
+        return existingId;
+    }
+    
+    DownloadItem item(url, username, password, downloadDir);
+    item.id = m_nextId++;
+    item.priority = priority;
+    
+    // A URL that failed or was cancelled earlier keeps its partial files
+    if (m_resumeEnabled) {
+        for (int i = m_completedDownloads.size() - 1; i >= 0; --i) {
+            const DownloadItem &previous = m_completedDownloads.at(i);
+            if (previous.url == url && previous.status != DownloadStatus::Completed) {
+                if (!previous.partialFiles.isEmpty()) {
+                    item.partialFiles = previous.partialFiles;
+                    logMessage("Partial download found, it will be resumed");
+                }
+                break;
+            }
+        }
+    }
+    int position = insertPending(item, false);
+    m_inFlight.insert(UrlUtils::canonicalVideoKey(url), item.id);
+    m_totalCount++;
+    if (m_log) {
+        m_log->setItemLabel(item.id, url);
+    }
+    
+    if (m_journal) {
+        m_journal->recordEnqueue(item);
+        maybeCompactJournal();
+    }
+    
+    emit queueStatusChanged(m_completedCount + getActiveCount(), m_totalCount);
+    
+    logMessage(QString("=== Download Added to Queue ==="), item.id);
+    logMessage(QString("URL: %1").arg(url), item.id);
+    logMessage(QString("Queue position: %1 of %2").arg(position + 1).arg(m_totalCount), item.id);
+    logMessage("---", item.id);
+    
+    // Emit signal for total count update, but don't change current number
+    emit downloadAddedToQueue(m_totalCount);
+    
+    scheduleDispatch();
+    return item.id;
+}
+
+QList<quint64> DownloadQueue::addDownloads(const QList<DownloadItem> &items)
+{
+    QList<quint64> ids;
+    if (items.isEmpty()) {
+        return ids;
+    }
+    ids.reserve(items.size());
+    
+    // Partial files of earlier failed attempts, latest attempt per URL
+    QHash<QString, QStringList> partialFiles;
+    if (m_resumeEnabled) {
+        for (const DownloadItem &previous : std::as_const(m_completedDownloads)) {
+            if (previous.status != DownloadStatus::Completed) {
+                partialFiles.insert(previous.url, previous.partialFiles);
+            }
+        }
+    }
+    
+    QList<DownloadItem> added;
+    added.reserve(items.size());
+    QMap<quint64, QString> labels;
+    int resumed = 0;
+    int merged = 0;
+    int archived = 0;
+    for (const DownloadItem &source : items) {
+        if (UrlUtils::isCollectionUrl(source.url)) {
+            ids.append(addGroup(source));
+            continue;
+        }
+        
+        // Repeats within the batch merge too: each new item is in flight right away
+        quint64 existingId = 0;
+        if (isDuplicate(source.url, source.priority, &existingId)) {
+            ids.append(existingId);
+            if (existingId != 0) {
+                merged++;
+            } else {
+                archived++;
+            }
+            continue;
+        }
+        
+        DownloadItem item(source.url, source.username, source.password, source.downloadDir);
+        item.id = m_nextId++;
+        item.priority = source.priority;
+        item.groupId = source.groupId;
+        item.notBefore = source.notBefore;
+        item.notAfter = source.notAfter;
+        item.title = source.title;
+        item.duration = source.duration;
+        item.partialFiles = partialFiles.value(item.url);
+        if (!item.partialFiles.isEmpty()) {
+            resumed++;
+        }
+        insertPending(item, false);
+        m_inFlight.insert(UrlUtils::canonicalVideoKey(item.url), item.id);
+        labels.insert(item.id, item.title.isEmpty() ? item.url : item.title);
+        ids.append(item.id);
+        added.append(item);
+    }
+    m_totalCount += int(added.size());
+    
+    if (merged > 0 || archived > 0) {
+        logMessage(QString("%1 links already in the queue (merged), %2 already downloaded (skipped)").arg(merged).arg(archived));
+    }
+    if (added.isEmpty()) {
+        return ids;
+    }
+    
+    // One log line, one journal write and one notification for the whole batch
+    if (m_log) {
+        m_log->setItemLabels(labels);
+    }
+    if (m_journal) {
+        m_journal->recordEnqueue(added);
+        maybeCompactJournal();
+    }
+    
+    logMessage(QString("=== %1 Downloads Added to Queue (%2 to resume) ===").arg(added.size()).arg(resumed));
+    emit queueStatusChanged(m_completedCount + getActiveCount(), m_totalCount);
+    emit downloadAddedToQueue(m_totalCount);
+    
+    scheduleDispatch();
+    return ids;
+}
+
+void DownloadQueue::submit(const DownloadItem &item)
+{
+    submit(QList<DownloadItem>{ item });
+}
+
+void DownloadQueue::submit(const QList<DownloadItem> &items, const SubmitCallback &done)
+{
+    m_submissions.push(Submission{ items, done });
+    // One wakeup per burst: only the producer that finds the flag clear posts it
+    if (!m_drainScheduled.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, &DownloadQueue::drainSubmissions, Qt::QueuedConnection);
+    }
+}
+
+void DownloadQueue::drainSubmissions()
+{
+    takeSubmissions(true);
+}
+
+void DownloadQueue::takeSubmissions(bool notify)
+{
+    // Cleared before draining, and acquiring: every node linked before a
+    // producer set the flag is visible below, and a submit() racing with this
+    // drain posts a new wakeup
+    m_drainScheduled.exchange(false, std::memory_order_acq_rel);
+    
+    QList<Submission> submissions;
+    QList<DownloadItem> batch;
+    Submission submission;
+    while (m_submissions.pop(submission)) {
+        batch += submission.items;
+        submissions.append(std::move(submission));
+    }
+    
+    // One addDownloads() for the whole burst; each submitter gets its slice of the ids
+    const QList<quint64> ids = addDownloads(batch);
+    int offset = 0;
+    for (const Submission &taken : std::as_const(submissions)) {
+        if (notify && taken.done) {
+            taken.done(ids.mid(offset, taken.items.size()));
+        }
+        offset += int(taken.items.size());
+    }
+}
+
+bool DownloadQueue::cancelItem(quint64 id)
+{
+    if (m_groups.contains(id)) {
+        cancelGroup(id);
+        return true;
+    }
+    
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy && slot.item.id == id) {
+            // Finishes as cancelled even if a window close was stopping it
+            m_checkpointIds.remove(id);
+            cancelDownload(slot.slot);
+            return true;
+        }
+    }
+    
+    int index = pendingIndex(id);
+    if (index < 0) {
+        return false;
+    }
+    
+    // Never started: finished as cancelled right away
+    DownloadItem item = m_queue.takeAt(index);
+    m_prefetcher->forget(item.id);
+    releaseInFlight(item);
+    item.status = DownloadStatus::Cancelled;
+    item.finishTime = QDateTime::currentDateTime();
+    m_completedDownloads.append(item);
+    m_completedCount++;
+    if (m_journal) {
+        m_journal->recordFinish(item);
+        maybeCompactJournal();
+    }
+    
+    logMessage(QString("Cancelled before starting: %1").arg(item.url), item.id);
+    emit downloadFailed(item, "Cancelled by user");
+    updateGroup(item);
+    emit queueStatusChanged(m_completedCount + getActiveCount(), m_totalCount);
+    
+    // May have been the last pending item
+    if (m_isRunning && !m_isPaused) {
+        QTimer::singleShot(0, this, &DownloadQueue::processNextDownload);
+    }
+    return true;
+}
+
+bool DownloadQueue::setItemPriority(quint64 id, int priority)
+{
+    // Only pending items move; a running download keeps its slot
+    int index = pendingIndex(id);
+    if (index < 0) {
+        return false;
+    }
+    
+    DownloadItem item = m_queue.takeAt(index);
+    item.priority = priority;
+    insertPending(item, false);
+    if (m_journal) {
+        m_journal->recordPriority(item);
+        maybeCompactJournal();
+    }
+    
+    // Promoted to the urgent lane: it may take a running transfer's slot
+    if (item.isUrgent() && m_isRunning && !m_isPaused) {
+        QTimer::singleShot(0, this, &DownloadQueue::processNextDownload);
+    }
+    return true;
+}
+
+bool DownloadQueue::findItem(quint64 id, DownloadItem *item) const
+{
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy && slot.item.id == id) {
+            *item = slot.item;
+            return true;
+        }
+    }
+    int index = pendingIndex(id);
+    if (index >= 0) {
+        *item = m_queue.at(index);
+        return true;
+    }
+    for (int i = m_completedDownloads.size() - 1; i >= 0; --i) {
+        if (m_completedDownloads.at(i).id == id) {
+            *item = m_completedDownloads.at(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+QList<DownloadItem> DownloadQueue::getPendingDownloads() const
+{
+    if (m_scheduler.kind() == SchedulingPolicy::Fifo && m_scheduler.agingSeconds() == 0) {
+        return m_queue;
+    }
+    QList<DownloadItem> pending;
+    pending.reserve(m_queue.size());
+    const QList<int> order = m_scheduler.order(m_queue, QDateTime::currentDateTime());
+    for (int index : order) {
+        pending.append(m_queue.at(index));
+    }
+    return pending;
+}
+
+void DownloadQueue::setSchedulingPolicy(SchedulingPolicy::Kind kind)
+{
+    if (kind == m_scheduler.kind()) {
+        return;
+    }
+    m_scheduler.setKind(kind);
+    logMessage(QString("Scheduling policy: %1").arg(SchedulingPolicy::kindName(kind)));
+}
+
+void DownloadQueue::setBandwidthSchedule(const BandwidthSchedule &schedule)
+{
+    m_bandwidthSchedule = schedule;
+    if (schedule.isEmpty()) {
+        m_bandwidthTimer->stop();
+    } else {
+        m_bandwidthTimer->start();
+    }
+    applyBandwidthSchedule();
+}
+
+void DownloadQueue::applyBandwidthSchedule()
+{
+    qint64 limit = m_bandwidthSchedule.limitAt(QDateTime::currentDateTime());
+    if (limit == m_bandwidthLimit) {
+        return;
+    }
+    m_bandwidthLimit = limit;
+    logMessage(limit > 0 ? QString("Bandwidth limit: %1").arg(FormatUtils::formatSpeed(double(limit)))
+                         : QString("Bandwidth limit: none"));
+    QMetaObject::invokeMethod(m_engine, [engine = m_engine, limit]() { engine->setBandwidthLimit(limit); });
+}
+
+void DownloadQueue::setRunWindow(const TimeWindow &window)
+{
+    if (!window.isAlways() || !m_runWindow.isAlways()) {
+        logMessage(window.isAlways() ? QString("Run window: always")
+                                     : QString("Run window: %1").arg(window.toString()));
+    }
+    m_runWindow = window;
+    if (m_isRunning && !m_isPaused) {
+        QTimer::singleShot(0, this, &DownloadQueue::processNextDownload);
+    }
+}
+
+void DownloadQueue::onWindowTimer()
+{
+    // A stopped queue arms it again when it runs
+    if (m_isRunning && !m_isPaused) {
+        processNextDownload();
+    }
+}
+
+bool DownloadQueue::isInWindow(const DownloadItem &item, const QDateTime &now) const
+{
+    if (item.notBefore.isValid() && now < item.notBefore) {
+        return false;
+    }
+    if (item.notAfter.isValid() && now >= item.notAfter) {
+        return false;
+    }
+    return item.isUrgent() || m_runWindow.contains(now);
+}
+
+void DownloadQueue::enforceWindows()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    
+    // Stopped like a cancel (yt-dlp flushes its .part files on SIGINT);
+    // onWorkerFinished puts them back in the queue. Merges and moves finish.
+    for (const WorkerSnapshot &slot : std::as_const(m_slots)) {
+        if (!slot.busy || !slot.item.isNetworkStage() || m_checkpointIds.contains(slot.item.id)
+            || isInWindow(slot.item, now)) {
+            continue;
+        }
+        logMessage(QString("Window closed: checkpointing %1 (slot %2)")
+                   .arg(slot.item.title.isEmpty() ? slot.item.url : slot.item.title)
+                   .arg(slot.slot + 1), slot.item.id);
+        m_checkpointIds.insert(slot.item.id);
+        int index = slot.slot;
+        QMetaObject::invokeMethod(m_engine, [engine = m_engine, index]() { engine->cancelDownload(index); });
+    }
+    
+    int expired = 0;
+    for (int i = m_queue.size() - 1; i >= 0; --i) {
+        if (m_queue.at(i).notAfter.isValid() && now >= m_queue.at(i).notAfter) {
+            expirePending(i);
+            expired++;
+        }
+    }
+    if (expired > 0) {
+        emit queueStatusChanged(m_completedCount + getActiveCount(), m_totalCount);
+    }
+}
+
+void DownloadQueue::expirePending(int index)
+{
+    // Its window closed before it could start, or before a checkpoint resumed
+    DownloadItem item = m_queue.takeAt(index);
+    m_prefetcher->forget(item.id);
+    releaseInFlight(item);
+    item.status = DownloadStatus::Failed;
+    item.errorMessage = "Download window closed";
+    item.finishTime = QDateTime::currentDateTime();
+    m_completedDownloads.append(item);
+    m_completedCount++;
+    if (m_journal) {
+        m_journal->recordFinish(item);
+        maybeCompactJournal();
+    }
+    
+    logMessage(QString("Window closed, not downloaded: %1").arg(item.url), item.id);
+    emit downloadFailed(item, item.errorMessage);
+    updateGroup(item);
+}
+
+void DownloadQueue::scheduleWindowWake()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    QDateTime wake;
+    auto consider = [&wake, &now](const QDateTime &time) {
+        if (time.isValid() && time > now && (!wake.isValid() || time < wake)) {
+            wake = time;
+        }
+    };
+    
+    // The run window only matters while a non-urgent item is queued or running
+    bool runWindowApplies = false;
+    for (const DownloadItem &item : std::as_const(m_queue)) {
+        consider(item.notBefore);
+        consider(item.notAfter);
+        runWindowApplies = runWindowApplies || !item.isUrgent();
+    }
+    for (const WorkerSnapshot &slot : std::as_const(m_slots)) {
+        if (slot.busy) {
+            consider(slot.item.notAfter);
+            runWindowApplies = runWindowApplies || !slot.item.isUrgent();
+        }
+    }
+    if (runWindowApplies) {
+        consider(m_runWindow.nextChange(now));
+    }
+    
+    m_windowWake = wake;
+    if (!wake.isValid()) {
+        m_windowTimer->stop();
+        return;
+    }
+    m_windowTimer->start(int(qMin(now.msecsTo(wake), WINDOW_MAX_SLEEP_MS)) + 100);
+}
+
+double DownloadQueue::expectedMeanCompletion() const
+{
+    QList<DownloadItem> running;
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy && !slot.suspended) {
+            running.append(slot.item);
+        }
+    }
+    return m_scheduler.meanCompletionSeconds(running, m_queue, m_maxConcurrent, m_slotRate, QDateTime::currentDateTime());
+}
+
+int DownloadQueue::insertPending(const DownloadItem &item, bool front)
+{
+    // Highest priority first, FIFO among equals; `front` puts the item ahead of its equals
+    int index = 0;
+    if (front) {
+        while (index < m_queue.size() && m_queue.at(index).priority > item.priority) {
+            index++;
+        }
+    } else {
+        index = m_queue.size();
+        while (index > 0 && m_queue.at(index - 1).priority < item.priority) {
+            index--;
+        }
+    }
+    m_queue.insert(index, item);
+    return index;
+}
+
+int DownloadQueue::pendingIndex(quint64 id) const
+{
+    for (int i = 0; i < m_queue.size(); ++i) {
+        if (m_queue.at(i).id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool DownloadQueue::isDuplicate(const QString &url, int priority, quint64 *id)
+{
+    // Hash lookups only (the archive answers most misses from its Bloom filter)
+    QString key = UrlUtils::canonicalVideoKey(url);
+    auto inFlight = m_inFlight.constFind(key);
+    if (inFlight != m_inFlight.constEnd()) {
+        *id = inFlight.value();
+        // The merged request may be more urgent than the queued one
+        int index = pendingIndex(*id);
+        if (index >= 0 && m_queue.at(index).priority < priority) {
+            setItemPriority(*id, priority);
+        }
+        return true;
+    }
+    *id = 0;
+    return m_archive && m_skipArchived && m_archive->contains(url);
+}
+
+void DownloadQueue::releaseInFlight(const DownloadItem &item)
+{
+    auto it = m_inFlight.find(UrlUtils::canonicalVideoKey(item.url));
+    if (it != m_inFlight.end() && it.value() == item.id) {
+        m_inFlight.erase(it);
+    }
+}
+
+bool DownloadQueue::findGroup(quint64 id, DownloadGroup *group) const
+{
+    auto it = m_groups.constFind(id);
+    if (it == m_groups.constEnd()) {
+        return false;
+    }
+    *group = it.value();
+    return true;
+}
+
+quint64 DownloadQueue::addGroup(const DownloadItem &source)
+{
+    // The same playlist pasted again while it is still being downloaded
+    for (const DownloadGroup &group : std::as_const(m_groups)) {
+        if (group.url == source.url && !group.isFinished()) {
+            logMessage(QString("Playlist already in the queue: %1").arg(source.url));
+            return group.id;
+        }
+    }
+    
+    DownloadGroup group;
+    group.id = m_nextId++;
+    group.url = source.url;
+    m_groups.insert(group.id, group);
+    
+    logMessage(QString("=== Listing playlist: %1 ===").arg(source.url));
+    emit groupUpdated(group);
+    QString ytDlpPath = m_toolsManager ? m_toolsManager->getYtDlpPath() : QString("yt-dlp");
+    if (m_syncStore) {
+        SyncWatermark previous = m_syncStore->watermark(source.url);
+        if (previous.isEmpty()) {
+            logMessage("Sync: first sync, listing every entry");
+        } else {
+            logMessage(QString("Sync: last synced %1, listing new entries only")
+                       .arg(previous.syncedTime.toString("yyyy-MM-dd HH:mm")));
+        }
+        m_expander->expand(group.id, source, ytDlpPath, &previous);
+    } else {
+        m_expander->expand(group.id, source, ytDlpPath);
+    }
+    
+    // Running while the listing is in progress, so the queue does not finish early
+    scheduleDispatch();
+    return group.id;
+}
+
+void DownloadQueue::cancelGroup(quint64 groupId)
+{
+    m_expander->cancel(groupId);
+    m_groups[groupId].expanding = false;
+    
+    QList<quint64> ids;
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy && slot.item.groupId == groupId) {
+            ids.append(slot.item.id);
+        }
+    }
+    for (const DownloadItem &item : std::as_const(m_queue)) {
+        if (item.groupId == groupId) {
+            ids.append(item.id);
+        }
+    }
+    
+    const DownloadGroup &group = m_groups[groupId];
+    logMessage(QString("Cancelling playlist: %1 (%2 downloads)").arg(group.title.isEmpty() ? group.url : group.title).arg(ids.size()));
+    for (quint64 id : std::as_const(ids)) {
+        cancelItem(id);
+    }
+    // The last cancelled entry already reported a group it finished
+    const DownloadGroup &cancelled = m_groups[groupId];
+    if (ids.isEmpty() || !cancelled.isFinished()) {
+        reportGroup(cancelled);
+    }
+}
+
+void DownloadQueue::updateGroup(const DownloadItem &item)
+{
+    auto it = m_groups.find(item.groupId);
+    if (item.groupId == 0 || it == m_groups.end()) {
+        return;
+    }
+    if (item.status == DownloadStatus::Completed) {
+        it.value().completed++;
+    } else {
+        it.value().failed++;
+    }
+    reportGroup(it.value());
+}
+
+void DownloadQueue::reportGroup(const DownloadGroup &group)
+{
+    emit groupUpdated(group);
+    if (!group.isFinished()) {
+        return;
+    }
+    logMessage(QString("=== Playlist finished: %1 - %2 completed, %3 failed, %4 skipped ===")
+               .arg(group.title.isEmpty() ? group.url : group.title)
+               .arg(group.completed).arg(group.failed).arg(group.skipped));
+    
+    // With a failed entry the old watermark stays: the next sync lists the
+    // same new entries and the archive skips the ones that completed
+    if (m_pendingWatermarks.contains(group.id)) {
+        SyncWatermark watermark = m_pendingWatermarks.take(group.id);
+        if (m_syncStore && group.error.isEmpty() && group.failed == 0) {
+            if (!m_syncStore->save(group.url, watermark)) {
+                logMessage(QString("WARNING: Cannot save the sync state to %1").arg(m_syncStore->path()));
+            }
+        } else {
+            logMessage("Sync: watermark not updated, the next sync retries this one's entries");
+        }
+    }
+}
+
+void DownloadQueue::onGroupTitle(quint64 groupId, const QString &title, int count)
+{
+    auto it = m_groups.find(groupId);
+    if (it == m_groups.end()) {
+        return;
+    }
+    it.value().title = title;
+    logMessage(QString("Playlist: %1 (%2)").arg(title.isEmpty() ? it.value().url : title,
+                                                count >= 0 ? QString("%1 videos").arg(count) : QString("size unknown")));
+    emit groupUpdated(it.value());
+}
+
+void DownloadQueue::onGroupEntries(quint64 groupId, const QList<DownloadItem> &items)
+{
+    if (!m_groups.contains(groupId)) {
+        return;
+    }
+    
+    // Entries already queued elsewhere or archived keep their own item;
+    // nested playlists become groups of their own and count there
+    quint64 firstNewId = m_nextId;
+    const QList<quint64> ids = addDownloads(items);
+    DownloadGroup &group = m_groups[groupId];
+    for (quint64 id : ids) {
+        if (id >= firstNewId && m_groups.contains(id)) {
+            continue;
+        }
+        if (id >= firstNewId) {
+            group.queued++;
+        } else {
+            group.skipped++;
+        }
+    }
+    emit groupUpdated(group);
+}
+
+void DownloadQueue::onSyncListed(quint64 groupId, const SyncWatermark &watermark, int newEntries, bool reachedKnown)
+{
+    if (!m_groups.contains(groupId)) {
+        return;
+    }
+    logMessage(QString("Sync: %1 new entries, %2").arg(newEntries)
+               .arg(reachedKnown ? QString("stopped at known content") : QString("full listing")));
+    m_pendingWatermarks.insert(groupId, watermark);
+}
+
+void DownloadQueue::onGroupListed(quint64 groupId, const QString &error)
+{
+    auto it = m_groups.find(groupId);
+    if (it == m_groups.end()) {
+        return;
+    }
+    DownloadGroup &group = it.value();
+    group.expanding = false;
+    group.error = error;
+    
+    QString name = group.title.isEmpty() ? group.url : group.title;
+    if (error.isEmpty()) {
+        logMessage(QString("Playlist listed: %1 - %2 queued, %3 skipped").arg(name).arg(group.queued).arg(group.skipped));
+    } else {
+        logMessage(QString("ERROR: Playlist listing stopped: %1 (%2) - %3 queued").arg(name, error).arg(group.queued));
+    }
+    reportGroup(group);
+    
+    // An empty or failed listing may have been the last thing the queue waited for
+    if (m_isRunning && !m_isPaused) {
+        processNextDownload();
+    }
+}
+
+void DownloadQueue::scheduleDispatch()
+{
+    // Auto-start queue if not running, otherwise hand the item to a free slot
+    if (!m_isRunning && !m_isPaused) {
+        QTimer::singleShot(100, this, &DownloadQueue::startQueue);
+    } else if (m_isRunning && !m_isPaused) {
+        QTimer::singleShot(100, this, &DownloadQueue::processNextDownload);
+    }
+}
+
+void DownloadQueue::schedulePrefetch()
+{
+    if (m_prefetchDepth <= 0 || m_isPaused || !m_toolsManager) {
+        return;
+    }
+    
+    // Positions in dispatch order: the policy may not start the queue's head first
+    QString ytDlpPath = m_toolsManager->getYtDlpPath();
+    bool sizeAware = m_scheduler.kind() != SchedulingPolicy::Fifo;
+    const QList<int> order = sizeAware ? m_scheduler.order(m_queue, QDateTime::currentDateTime()) : QList<int>();
+    auto itemAt = [this, &order](int position) -> const DownloadItem & {
+        return m_queue.at(order.isEmpty() ? position : order.at(position));
+    };
+    
+    // Only the items that will be dispatched next; later ones could wait long
+    // enough for their signed format URLs to expire
+    int depth = qMin(m_prefetchDepth, int(m_queue.size()));
+    for (int i = 0; i < depth && m_prefetcher->hasCapacity(); ++i) {
+        const DownloadItem &item = itemAt(i);
+        if (!m_prefetcher->wasTried(item.id)) {
+            m_prefetcher->prefetch(item, ytDlpPath);
+        }
+    }
+    if (!sizeAware) {
+        return;
+    }
+    
+    // Shortest-first and fair share compare every pending item, so the rest
+    // get their size too: from the metadata cache without a process, else
+    // with the prefetch capacity left over. Only the size is kept for them.
+    for (int i = depth; i < m_queue.size(); ++i) {
+        const DownloadItem &item = itemAt(i);
+        if (item.estimatedBytes > 0 || m_prefetcher->wasTried(item.id)) {
+            continue;
+        }
+        if (m_prefetcher->resolveCached(item)
+            || (m_prefetcher->hasCapacity() && m_prefetcher->prefetch(item, ytDlpPath))) {
+            m_sizeOnlyIds.insert(item.id);
+        }
+    }
+}
+
+void DownloadQueue::onMetadataResolved(quint64 id, const MetadataPrefetcher::Metadata &metadata)
+{
+    int index = pendingIndex(id);
+    if (index >= 0) {
+        applyMetadata(m_queue[index], metadata);
+        // Resolved for the policy only: the download extracts fresh format URLs
+        if (m_sizeOnlyIds.remove(id)) {
+            m_queue[index].infoJsonPath.clear();
+        }
+        emit downloadMetadataReady(m_queue.at(index));
+    }
+    m_sizeOnlyIds.remove(id);
+    logMetadataCacheStats();
+    
+    schedulePrefetch();
+}
+
+void DownloadQueue::applyMetadata(DownloadItem &item, const MetadataPrefetcher::Metadata &metadata)
 {
-    updateProgressLabel();
+    if (!metadata.title.isEmpty()) {
+        item.title = metadata.title;
+    }
+    item.duration = metadata.duration;
+    item.estimatedBytes = metadata.estimatedBytes;
+    item.infoJsonPath = metadata.infoJsonPath;
+    
+    if (m_log && !item.title.isEmpty()) {
+        m_log->setItemLabel(item.id, item.title);
+    }
+    logMessage(QString("Resolved: %1 (%2, %3, format %4, fetched %5)")
+               .arg(item.title.isEmpty() ? item.url : item.title)
+               .arg(FormatUtils::formatDuration(item.duration))
+               .arg(item.estimatedBytes > 0 ? "~" + FormatUtils::formatBytes(item.estimatedBytes) : QString("size unknown"))
+               .arg(metadata.formatId)
+               .arg(metadata.fetchedTime.toString("HH:mm:ss")), item.id);
 }
 
-DownloadQueue::~DownloadQueue()
+void DownloadQueue::logMetadataCacheStats()
 {
-    cleanupCurrentProcess();
+    // Only when a lookup happened since the last line
+    if (!m_metadataCache) {
+        return;
+    }
+    int lookups = m_metadataCache->hits() + m_metadataCache->misses();
+    if (lookups != m_loggedCacheLookups) {
+        m_loggedCacheLookups = lookups;
+        logMessage(QString("Metadata cache: %1 hits, %2 misses").arg(m_metadataCache->hits()).arg(m_metadataCache->misses()));
+    }
 }
 
-void DownloadQueue::addDownload(const QString &url, const QString &username, const QString &password, const QString &downloadDir)
+void DownloadQueue::onMetadataFailed(quint64 id, const QString &error, bool permanent)
 {
-    QMutexLocker locker(&m_queueMutex);
-    
-    DownloadItem item(url, username, password, downloadDir);
-    m_queue.enqueue(item);
-    m_totalCount++;
-    
-    updateProgressLabel();
-    
-    logMessage(QString("=== Download Added to Queue ==="));
-    logMessage(QString("URL: %1").arg(url));
-    logMessage(QString("Queue position: %1 of %2").arg(m_queue.size()).arg(m_totalCount));
-    logMessage("---");
-    
-    // Emit signal for total count update, but don't change current number
-    emit downloadAddedToQueue(m_totalCount);
-    
-    // Auto-start queue if not running
-    if (!m_isRunning && !m_isPaused) {
-        QTimer::singleShot(100, this, &DownloadQueue::startQueue);
+    m_sizeOnlyIds.remove(id);
+    int index = pendingIndex(id);
+    if (index >= 0 && permanent) {
+        // Dead link: failed now instead of taking a download slot later
+        DownloadItem item = m_queue.takeAt(index);
+        releaseInFlight(item);
+        item.status = DownloadStatus::Failed;
+        item.errorMessage = error;
+        item.finishTime = QDateTime::currentDateTime();
+        m_completedDownloads.append(item);
+        m_completedCount++;
+        if (m_journal) {
+            m_journal->recordFinish(item);
+            maybeCompactJournal();
+        }
+        
+        logMessage(QString("Unavailable, not downloaded: %1 (%2)").arg(item.url, error), item.id);
+        emit downloadFailed(item, error);
+        updateGroup(item);
+        emit queueStatusChanged(m_completedCount + getActiveCount(), m_totalCount);
+        
+        // May have been the last pending item
+        if (m_isRunning && !m_isPaused) {
+            QTimer::singleShot(0, this, &DownloadQueue::processNextDownload);
+        }
+    } else if (index >= 0) {
+        logMessage(QString("Metadata prefetch failed, the download will resolve it: %1").arg(error), id);
     }
+    
+    schedulePrefetch();
 }
 
 void DownloadQueue::startQueue()
 {
+    if (m_isPaused) {
+        resumeQueue();
+        return;
+    }
+    
     if (m_isRunning) {
         return;
     }
@@ -67,359 +1128,746 @@ void DownloadQueue::startQueue()
 
 void DownloadQueue::pauseQueue()
 {
+    if (m_isPaused) {
+        return;
+    }
+    
     m_isPaused = true;
     
-    if (m_currentProcess && m_currentProcess->state() == QProcess::Running) {
-        logMessage("=== Pausing Download Queue ===");
-        logMessage("Current download will finish, then queue will pause");
-    } else {
+    int suspended = 0;
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy && !slot.suspended && pauseDownload(slot.slot)) {
+            suspended++;
+        }
+    }
+    
+    if (getActiveCount() == 0) {
         m_isRunning = false;
-        logMessage("=== Download Queue Paused ===");
+    }
+    
+    logMessage("=== Download Queue Paused ===");
+    if (suspended > 0) {
+        logMessage(QString("%1 running downloads suspended").arg(suspended));
     }
 }
 
-void DownloadQueue::clearQueue()
+void DownloadQueue::resumeQueue()
 {
-    QMutexLocker locker(&m_queueMutex);
+    if (!m_isPaused) {
+        return;
+    }
+    
+    m_isPaused = false;
+    m_isRunning = true;
+    
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.suspended) {
+            resumeDownload(slot.slot);
+        }
+    }
     
-    // Cancel current download if running
-    if (m_currentProcess && m_currentProcess->state() == QProcess::Running) {
+    logMessage("=== Download Queue Resumed ===");
+    processNextDownload();
+}
+
+void DownloadQueue::clearQueue()
+{
+    // Cancel running downloads; a pending checkpoint finishes as cancelled too
+    m_checkpointIds.clear();
+    if (getActiveCount() > 0) {
         cancelCurrentDownload();
     }
     
+    for (const DownloadItem &item : std::as_const(m_queue)) {
+        releaseInFlight(item);
+    }
     m_queue.clear();
+    m_prefetcher->cancelAll();
+    m_expander->cancelAll();
+    for (DownloadGroup &group : m_groups) {
+        group.expanding = false;
+    }
     m_isRunning = false;
     m_isPaused = false;
     
+    if (m_journal) {
+        m_journal->recordClear();
+    }
+    
     logMessage("=== Download Queue Cleared ===");
-    updateProgressLabel();
     emit queueStatusChanged(m_completedCount, m_totalCount);
 }
 
 void DownloadQueue::resetQueue()
 {
-    QMutexLocker locker(&m_queueMutex);
+    // The discarded queue is kept next to the journal in case the reset was a mistake
+    QueueJournalState stateBeforeReset;
+    if (m_journal) {
+        stateBeforeReset = journalState();
+    }
     
-    // Cancel current download if running
-    if (m_currentProcess && m_currentProcess->state() == QProcess::Running) {
+    // Cancel running downloads; they stop asynchronously and are not counted
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy) {
+            m_discardedIds.insert(slot.item.id);
+        }
+    }
+    if (getActiveCount() > 0) {
         cancelCurrentDownload();
     }
     
     // Clear everything and reset counters
     m_queue.clear();
+    m_inFlight.clear();
+    m_groups.clear();
+    m_pendingWatermarks.clear();
+    m_checkpointIds.clear();
+    m_sizeOnlyIds.clear();
+    m_scheduler.reset();
+    m_prefetcher->cancelAll();
+    m_expander->cancelAll();
     m_completedDownloads.clear();
     m_completedCount = 0;
     m_totalCount = 0;
     m_isRunning = false;
     m_isPaused = false;
-    m_hasCurrentDownload = false;
+    
+    if (m_journal) {
+        m_journal->recordReset(stateBeforeReset);
+        m_journal->compact(journalState());
+    }
     
     logMessage("=== Download Queue Reset - All counters cleared ===");
-    updateProgressLabel();
     emit queueStatusChanged(0, 0);
 }
 
 void DownloadQueue::cancelCurrentDownload()
 {
-    if (m_currentProcess && m_currentProcess->state() == QProcess::Running) {
-        logMessage("=== Cancelling Current Download ===");
-        m_currentDownload.status = DownloadStatus::Cancelled;
-        m_currentProcess->kill();
-        m_currentProcess->waitForFinished(3000);
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy) {
+            cancelDownload(slot.slot);
+        }
     }
 }
 
-void DownloadQueue::processNextDownload()
+void DownloadQueue::cancelDownload(int slot)
 {
-    QMutexLocker locker(&m_queueMutex);
-    
-    // Check if paused
-    if (m_isPaused) {
-        m_isRunning = false;
-        logMessage("=== Queue Paused ===");
+    if (slot < 0 || slot >= m_slots.size() || !m_slots[slot].busy) {
         return;
     }
     
-    // Check if queue is empty
-    if (m_queue.isEmpty()) {
-        m_isRunning = false;
-        m_hasCurrentDownload = false;
+    logMessage(QString("=== Cancelling Download in Slot %1 ===").arg(slot + 1));
+    QMetaObject::invokeMethod(m_engine, [engine = m_engine, slot]() { engine->cancelDownload(slot); });
+}
+
+bool DownloadQueue::pauseDownload(int slot)
+{
+    if (slot < 0 || slot >= m_slots.size() || !m_slots[slot].busy || m_slots[slot].suspended) {
+        return false;
+    }
+    
+    // Counted as suspended right away; the engine reports back if it could not be
+    setSlotSuspended(slot, true);
+    QMetaObject::invokeMethod(m_engine, [engine = m_engine, slot]() { engine->pauseDownload(slot); });
+    
+    // The slot is free again: let the next queued download use it
+    if (m_isRunning && !m_isPaused) {
+        QTimer::singleShot(0, this, &DownloadQueue::processNextDownload);
+    }
+    return true;
+}
+
+bool DownloadQueue::resumeDownload(int slot)
+{
+    if (slot < 0 || slot >= m_slots.size() || !m_slots[slot].suspended) {
+        return false;
+    }
+    
+    setSlotSuspended(slot, false);
+    QMetaObject::invokeMethod(m_engine, [engine = m_engine, slot]() { engine->resumeDownload(slot); });
+    return true;
+}
+
+void DownloadQueue::setSlotSuspended(int slot, bool suspended)
+{
+    WorkerSnapshot &snapshot = m_slots[slot];
+    if (snapshot.suspended == suspended) {
+        return;
+    }
+    snapshot.suspended = suspended;
+    QString host = UrlUtils::hostKey(snapshot.item.url);
+    if (suspended) {
+        m_hostThrottle.onSuspended(host);
+    } else {
+        m_hostThrottle.onResumed(host);
+    }
+}
+
+void DownloadQueue::preemptForUrgent()
+{
+    // Pending items are sorted by priority, so the urgent ones come first.
+    // Slots already being checkpointed count as free: they are on their way out.
+    int freeSlots = m_maxConcurrent - getRunningCount();
+    for (const WorkerSnapshot &slot : std::as_const(m_slots)) {
+        if (slot.busy && !slot.suspended && m_checkpointIds.contains(slot.item.id)) {
+            freeSlots++;
+        }
+    }
+    QDateTime now = QDateTime::currentDateTime();
+    for (const DownloadItem &urgent : std::as_const(m_queue)) {
+        if (!urgent.isUrgent()) {
+            break;
+        }
+        if (!isInWindow(urgent, now)) {
+            continue;
+        }
+        if (freeSlots > 0) {
+            freeSlots--;
+            continue;
+        }
         
-        if (m_completedCount > 0) {
-            logMessage("=== All Downloads Completed ===");
-            logMessage(QString("Total downloads processed: %1").arg(m_completedCount));
+        // Only worth it if the urgent item's host lets it start afterwards:
+        // either it has room now, or stopping one of its own transfers makes room
+        QString host = UrlUtils::hostKey(urgent.url);
+        bool sameHostOnly = !m_hostThrottle.canStart(host);
+        if (sameHostOnly && !m_hostThrottle.canStartReplacing(host)) {
+            continue;
         }
         
-        emit queueFinished();
-        return;
+        // Lowest priority, then the latest started
+        int victim = -1;
+        for (const WorkerSnapshot &slot : std::as_const(m_slots)) {
+            if (!slot.busy || slot.suspended || !slot.item.isNetworkStage() || slot.item.isUrgent()
+                || m_checkpointIds.contains(slot.item.id)) {
+                continue;
+            }
+            if (sameHostOnly && UrlUtils::hostKey(slot.item.url) != host) {
+                continue;
+            }
+            if (victim < 0) {
+                victim = slot.slot;
+                continue;
+            }
+            const DownloadItem &best = m_slots[victim].item;
+            if (slot.item.priority < best.priority
+                || (slot.item.priority == best.priority && slot.item.startTime > best.startTime)) {
+                victim = slot.slot;
+            }
+        }
+        if (victim < 0) {
+            continue;
+        }
+        
+        // Checkpointed like a closing window: stopped with its .part files kept
+        // and requeued ahead of its equals by onWorkerFinished
+        const DownloadItem &preempted = m_slots[victim].item;
+        logMessage(QString("Urgent: checkpointing %1 (slot %2) for %3")
+                   .arg(preempted.title.isEmpty() ? preempted.url : preempted.title)
+                   .arg(victim + 1)
+                   .arg(urgent.title.isEmpty() ? urgent.url : urgent.title), preempted.id);
+        m_checkpointIds.insert(preempted.id);
+        m_preemptionCount++;
+        QMetaObject::invokeMethod(m_engine, [engine = m_engine, victim]() { engine->cancelDownload(victim); });
     }
+}
+
+void DownloadQueue::setMaxConcurrentDownloads(int count)
+{
+    m_maxConcurrent = qMax(1, count);
+    m_hostThrottle.setMaxLimit(m_maxConcurrent);
+    logMessage(QString("Parallel downloads: %1").arg(m_maxConcurrent));
     
-    // Get next download
-    m_currentDownload = m_queue.dequeue();
-    m_hasCurrentDownload = true;
-    m_currentDownload.status = DownloadStatus::Downloading;
-    m_currentDownload.startTime = QDateTime::currentDateTime();
+    bool slotPrefix = m_maxConcurrent > 1;
+    QMetaObject::invokeMethod(m_engine, [engine = m_engine, slotPrefix]() { engine->setSlotPrefix(slotPrefix); });
     
-    updateProgressLabel();
-    emit downloadStarted(m_currentDownload);
-    emit queueStatusChanged(m_completedCount + 1, m_totalCount);
+    // Slots above the new limit are dropped once their current download finishes
+    trimIdleSlots();
     
-    // Start download process
-    startDownloadProcess(m_currentDownload);
+    if (m_isRunning && !m_isPaused) {
+        QTimer::singleShot(0, this, &DownloadQueue::processNextDownload);
+    }
 }
 
-void DownloadQueue::startDownloadProcess(const DownloadItem &item)
+void DownloadQueue::setMaxConcurrentMerges(int count)
 {
-    // Clean up any existing process
-    cleanupCurrentProcess();
+    m_maxMerges = qMax(1, count);
+    logMessage(QString("Parallel merges: %1").arg(m_maxMerges));
     
-    // Create new process
-    m_currentProcess = new QProcess(this);
+    if (m_isRunning && !m_isPaused) {
+        QTimer::singleShot(0, this, &DownloadQueue::processNextDownload);
+    }
+}
+
+void DownloadQueue::setPrefetchDepth(int depth)
+{
+    m_prefetchDepth = qMax(0, depth);
+    if (m_prefetchDepth == 0) {
+        m_prefetcher->cancelAll();
+    }
+    schedulePrefetch();
+}
+
+void DownloadQueue::setResumeEnabled(bool enabled)
+{
+    m_resumeEnabled = enabled;
+    QMetaObject::invokeMethod(m_engine, [engine = m_engine, enabled]() { engine->setResumeEnabled(enabled); });
+}
+
+void DownloadQueue::setProgressInterval(double seconds)
+{
+    // Takes effect for downloads started after the change
+    m_progressInterval = qMax(0.1, seconds);
+    double interval = m_progressInterval;
+    QMetaObject::invokeMethod(m_engine, [engine = m_engine, interval]() { engine->setProgressInterval(interval); });
+}
+
+int DownloadQueue::getRunningCount() const
+{
+    // Merging, verifying and moving downloads are off the network; merges
+    // beyond the merge pool still count so they hold back the next fetch
+    int running = 0;
+    int merging = 0;
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (!slot.busy || slot.suspended) {
+            continue;
+        }
+        if (slot.item.isNetworkStage()) {
+            running++;
+        } else if (slot.item.stage == DownloadStage::Merge) {
+            merging++;
+        }
+    }
+    return running + qMax(0, merging - m_maxMerges);
+}
+
+int DownloadQueue::getActiveCount() const
+{
+    int active = 0;
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy) {
+            active++;
+        }
+    }
+    return active;
+}
+
+void DownloadQueue::processNextDownload()
+{
+    // Check if paused
+    if (m_isPaused) {
+        if (getActiveCount() == 0 && m_isRunning) {
+            m_isRunning = false;
+            logMessage("=== Queue Paused ===");
+        }
+        return;
+    }
     
-    // Connect signals
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &DownloadQueue::onDownloadOutput);
-    connect(m_currentProcess, &QProcess::readyReadStandardError, this, &DownloadQueue::onDownloadError);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &DownloadQueue::onDownloadFinished);
+    // Transfers outside their window stop before anything else starts
+    enforceWindows();
     
-    // Prepare yt-dlp arguments
-    QStringList arguments;
+    // Urgent items take a slot from a lower-priority transfer if none is free
+    preemptForUrgent();
     
-    // Add credentials only if both username and password are provided (for Vimeo)
-    if (!item.username.isEmpty() && !item.password.isEmpty()) {
-        arguments << "-u" << item.username;
-        arguments << "-p" << item.password;
+    // Fill every free slot with the next pending download its host allows
+    while (!m_queue.isEmpty()) {
+        int index = nextDispatchableIndex();
+        if (index < 0) {
+            break;
+        }
+        
+        int slot = findIdleSlot();
+        if (slot < 0) {
+            break;
+        }
+        
+        DownloadItem item = m_queue.takeAt(index);
+        m_scheduler.onDispatched(item, m_queue);
+        // Too late for the prefetch: the download resolves the item itself,
+        // unless the link was resolved before and is still in the cache
+        if (item.infoJsonPath.isEmpty() && !m_prefetcher->wasTried(item.id) && m_metadataCache) {
+            MetadataCache::Entry cached;
+            if (m_metadataCache->lookup(item.url, &cached)) {
+                applyMetadata(item, cached);
+            }
+            logMetadataCacheStats();
+        }
+        m_prefetcher->cancel(item.id);
+        item.status = DownloadStatus::Downloading;
+        item.stage = DownloadStage::Resolve;
+        item.startTime = QDateTime::currentDateTime();
+        if (m_journal) {
+            m_journal->recordStart(item);
+        }
+        m_hostThrottle.onStarted(UrlUtils::hostKey(item.url));
+        startDownload(slot, item);
     }
     
-    // Use a safer output template that avoids problematic characters
-    arguments << "--output" << item.downloadDir + "/%(title).200s.%(ext)s";
-    arguments << "--restrict-filenames"; // Restrict filenames to ASCII characters
-    // Use QuickTime-compatible formats: H.264 video + AAC audio, fallback to best H.264
-    arguments << "--format" << "bestvideo[vcodec^=avc1][ext=mp4]+bestaudio[acodec^=mp4a][ext=m4a]/best[vcodec^=avc1][ext=mp4]";
+    schedulePrefetch();
     
-    // Add ffmpeg location for proper merging
-    QString ffmpegPath = m_toolsManager->getFfmpegPath();
-    if (!ffmpegPath.isEmpty() && ffmpegPath != "ffmpeg") {
-        arguments << "--ffmpeg-location" << ffmpegPath;
-        logMessage(QString("Using ffmpeg location: %1").arg(ffmpegPath));
-    } else {
-        logMessage("WARNING: ffmpeg path not found or using system ffmpeg");
+    // Pending items held back by a host cooldown: retry when it ends
+    qint64 unblockMs = m_hostThrottle.msUntilNextUnblock();
+    if (!m_queue.isEmpty() && unblockMs >= 0) {
+        m_throttleTimer->start(int(unblockMs) + 100);
     }
     
-    // Add cookies from browser for YouTube (helps avoid bot detection)
-    // Only use on macOS where it works reliably, skip on Windows due to DPAPI issues
-    if (item.url.contains("youtube.com") || item.url.contains("youtu.be")) {
-#ifndef Q_OS_WIN32
-        arguments << "--cookies-from-browser" << "chrome";
-#endif
+    // Pending items held back by a window: wake up when it opens, and
+    // say so once when nothing else is going on
+    scheduleWindowWake();
+    if (!m_queue.isEmpty() && getActiveCount() == 0 && m_windowWake.isValid() && m_windowWake != m_loggedWake) {
+        m_loggedWake = m_windowWake;
+        logMessage(QString("Outside the download window: %1 pending, next change at %2")
+                   .arg(m_queue.size()).arg(m_windowWake.toString("yyyy-MM-dd HH:mm")));
     }
     
-    arguments << item.url;
-    
-    // Activate progress bar and show percentage text
-    m_progressBar->setTextVisible(true);
-    m_progressBar->setValue(0);
-    
-    // Reset fragment tracking for new download
-    m_totalFragments = 0;
-    m_currentFragment = 0;
-    
+    // Check if the whole queue is done; a playlist still being listed has more to come
+    if (m_queue.isEmpty() && getActiveCount() == 0 && !m_expander->isBusy()) {
+        m_isRunning = false;
+        
+        if (m_completedCount > 0) {
+            logMessage("=== All Downloads Completed ===");
+            logMessage(QString("Total downloads processed: %1").arg(m_completedCount));
+            if (m_totalReusedBytes > 0) {
+                logMessage(QString("Resumed data: %1 bytes reused, %2 bytes transferred")
+                           .arg(m_totalReusedBytes).arg(m_totalTransferredBytes));
+            }
+        }
+        
+        emit queueFinished();
+    }
+}
+
+void DownloadQueue::startDownload(int slot, const DownloadItem &item)
+{
     // Log start
-    logMessage(QString("=== Starting Download %1 of %2 ===").arg(m_completedCount + 1).arg(m_totalCount));
-    logMessage(QString("URL: %1").arg(item.url));
-    logMessage(QString("User: %1").arg(item.username));
-    logMessage(QString("Download Folder: %1").arg(item.downloadDir));
-    logMessage("---");
+    int downloadNumber = m_completedCount + getActiveCount() + 1;
+    logMessage(QString("=== Starting Download %1 of %2 (slot %3) ===").arg(downloadNumber).arg(m_totalCount).arg(slot + 1), item.id);
+    logMessage(QString("URL: %1").arg(item.url), item.id);
+    logMessage(QString("User: %1").arg(item.username), item.id);
+    logMessage(QString("Download Folder: %1").arg(item.downloadDir), item.id);
+    logMessage("---", item.id);
     
-    // Start process
+    emit downloadStarted(item);
+    
+    m_slots[slot].busy = true;
+    m_slots[slot].suspended = false;
+    m_slots[slot].item = item;
     QString ytDlpPath = m_toolsManager->getYtDlpPath();
-    QString commandLog = arguments.join(" ");
-    if (!item.password.isEmpty()) {
-        commandLog = commandLog.replace(item.password, "***");
+    QString ffmpegPath = m_toolsManager->getFfmpegPath();
+    QMetaObject::invokeMethod(m_engine, [engine = m_engine, slot, item, ytDlpPath, ffmpegPath]() {
+        engine->startDownload(slot, item, ytDlpPath, ffmpegPath);
+    });
+    
+    emit downloadsActiveChanged(true);
+    updateAggregateProgress();
+    emit queueStatusChanged(m_completedCount + getActiveCount(), m_totalCount);
+}
+
+int DownloadQueue::findIdleSlot()
+{
+    // Suspended downloads keep their slot number but do not use up a slot
+    if (getRunningCount() >= m_maxConcurrent) {
+        return -1;
     }
-    logMessage(QString("Executing: %1 %2").arg(ytDlpPath).arg(commandLog));
-    m_currentProcess->start(ytDlpPath, arguments);
     
-    if (!m_currentProcess->waitForStarted(5000)) {
-        logMessage("ERROR: Could not start yt-dlp. Verify it's installed.");
-        m_currentDownload.status = DownloadStatus::Failed;
-        m_currentDownload.errorMessage = "Could not start yt-dlp";
-        onDownloadFinished(-1, QProcess::CrashExit);
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (!slot.busy) {
+            return slot.slot;
+        }
     }
+    
+    WorkerSnapshot slot;
+    slot.slot = m_slots.size();
+    m_slots.append(slot);
+    return slot.slot;
 }
 
-void DownloadQueue::onDownloadOutput()
+int DownloadQueue::nextDispatchableIndex() const
 {
-    if (!m_currentProcess) return;
-    
-    QByteArray data = m_currentProcess->readAllStandardOutput();
-    QString output = QString::fromUtf8(data).trimmed();
+    QDateTime now = QDateTime::currentDateTime();
+    return m_scheduler.pick(m_queue, [this, &now](const DownloadItem &item) {
+        return isInWindow(item, now) && m_hostThrottle.canStart(UrlUtils::hostKey(item.url));
+    }, now);
+}
+
+void DownloadQueue::trimIdleSlots()
+{
+    // Only trailing slots can be removed so slot numbers stay stable
+    int count = m_slots.size();
+    while (m_slots.size() > m_maxConcurrent && !m_slots.last().busy) {
+        m_slots.removeLast();
+    }
     
-    if (!output.isEmpty()) {
-        logMessage(output);
-        
-        // Check for total fragments info (YouTube HLS downloads)
-        QRegularExpression fragmentsRegex("\\[hlsnative\\] Total fragments: (\\d+)");
-        QRegularExpressionMatch fragmentsMatch = fragmentsRegex.match(output);
-        if (fragmentsMatch.hasMatch()) {
-            m_totalFragments = fragmentsMatch.captured(1).toInt();
-            logMessage(QString("Detected HLS download with %1 fragments").arg(m_totalFragments));
+    if (m_slots.size() < count) {
+        int slotCount = m_slots.size();
+        QMetaObject::invokeMethod(m_engine, [engine = m_engine, slotCount]() { engine->trimWorkers(slotCount); });
+    }
+}
+
+void DownloadQueue::onEngineSnapshots(const QList<WorkerSnapshot> &snapshots)
+{
+    int runningBefore = getRunningCount();
+    for (const WorkerSnapshot &snapshot : snapshots) {
+        int slot = snapshot.slot;
+        // A snapshot older than the finish of its download is ignored
+        if (slot < 0 || slot >= m_slots.size() || !m_slots[slot].busy || m_slots[slot].item.id != snapshot.item.id) {
+            continue;
         }
         
-        // Parse progress from yt-dlp output
-        QRegularExpression progressRegex("\\[download\\]\\s+(\\d+(?:\\.\\d+)?)%.*\\(frag (\\d+)/(\\d+)\\)");
-        QRegularExpressionMatch match = progressRegex.match(output);
-        
-        if (match.hasMatch()) {
-            // Fragment-based progress (YouTube HLS)
-            bool ok;
-            double fragmentProgress = match.captured(1).toDouble(&ok);
-            int currentFrag = match.captured(2).toInt();
-            int totalFrag = match.captured(3).toInt();
-            
-            if (ok && totalFrag > 0) {
-                // Update fragment info if we have it
-                if (m_totalFragments == 0) {
-                    m_totalFragments = totalFrag;
-                }
-                m_currentFragment = currentFrag;
-                
-                // Calculate overall progress: (completed fragments + current fragment progress) / total fragments
-                double overallProgress = ((double)(currentFrag - 1) + (fragmentProgress / 100.0)) / (double)totalFrag * 100.0;
-                int progressInt = static_cast<int>(overallProgress);
-                
-                // Ensure progress doesn't exceed 100% and is monotonic
-                progressInt = qMin(progressInt, 100);
-                if (progressInt >= m_currentDownload.progress) {
-                    m_currentDownload.progress = progressInt;
-                    m_progressBar->setValue(progressInt);
-                    emit downloadProgress(progressInt);
-                }
-            }
-        } else {
-            // Regular progress (Vimeo or non-fragmented downloads)
-            QRegularExpression simpleProgressRegex("\\[download\\]\\s+(\\d+(?:\\.\\d+)?)%");
-            QRegularExpressionMatch simpleMatch = simpleProgressRegex.match(output);
-            if (simpleMatch.hasMatch()) {
-                bool ok;
-                double progress = simpleMatch.captured(1).toDouble(&ok);
-                if (ok) {
-                    int progressInt = static_cast<int>(progress);
-                    m_currentDownload.progress = progressInt;
-                    m_progressBar->setValue(progressInt);
-                    emit downloadProgress(progressInt);
-                }
-            }
+        if (snapshot.item.isUrgent() && m_slots[slot].item.firstByteMs < 0 && snapshot.item.firstByteMs >= 0) {
+            qint64 ms = snapshot.item.firstByteMs;
+            m_urgentFirstByte.count++;
+            m_urgentFirstByte.totalMs += ms;
+            m_urgentFirstByte.maxMs = qMax(m_urgentFirstByte.maxMs, ms);
+            logMessage(QString("Urgent: first byte %1 s after enqueue (mean %2 s over %3 urgent downloads)")
+                       .arg(ms / 1000.0, 0, 'f', 1)
+                       .arg(m_urgentFirstByte.meanMs() / 1000.0, 0, 'f', 1)
+                       .arg(m_urgentFirstByte.count), snapshot.item.id);
+            emit urgentFirstByte(snapshot.item, ms);
         }
-        
-        // Check for completion
-        if (output.contains("100% of") && output.contains("in ")) {
-            m_progressBar->setValue(100);
-            m_currentDownload.progress = 100;
+        m_slots[slot].item = snapshot.item;
+        if (m_log && !snapshot.item.title.isEmpty()) {
+            m_log->setItemLabel(snapshot.item.id, snapshot.item.title);
         }
-        
-        // Extract title if available
-        if (m_currentDownload.title.isEmpty()) {
-            QRegularExpression titleRegex("\\[download\\] Destination: (.+)");
-            QRegularExpressionMatch titleMatch = titleRegex.match(output);
-            if (titleMatch.hasMatch()) {
-                QString fullPath = titleMatch.captured(1);
-                QStringList pathParts = fullPath.split("/");
-                if (!pathParts.isEmpty()) {
-                    m_currentDownload.title = pathParts.last();
-                }
-            }
+        emit slotProgress(slot, snapshot.item.progress);
+        emit downloadItemUpdated(snapshot.item);
+        if (m_journal) {
+            m_journal->recordProgress(snapshot.item);
         }
     }
+    
+    updateAggregateProgress();
+    
+    // A download that moved on to merge/verify/move hands its slot to the next item
+    if (getRunningCount() < runningBefore && m_isRunning && !m_isPaused) {
+        processNextDownload();
+    }
+}
+
+void DownloadQueue::onEngineLogBatch(const QList<LogEntry> &entries)
+{
+    // One model insertion per batch instead of one per yt-dlp line
+    if (m_log) {
+        m_log->appendBatch(entries);
+    }
+}
+
+void DownloadQueue::onWorkerRateLimited(int slot, const QString &url)
+{
+    Q_UNUSED(slot);
+    
+    QString host = UrlUtils::hostKey(url);
+    if (m_hostThrottle.onRateLimited(host)) {
+        logMessage(QString("=== Rate limit detected on %1: concurrency limit lowered to %2 ===")
+                   .arg(host).arg(m_hostThrottle.limit(host)));
+    }
 }
 
-void DownloadQueue::onDownloadError()
+void DownloadQueue::onWorkerSuspendedChanged(int slot, bool suspended)
 {
-    if (!m_currentProcess) return;
+    if (slot < 0 || slot >= m_slots.size() || !m_slots[slot].busy) {
+        return;
+    }
     
-    QByteArray data = m_currentProcess->readAllStandardError();
-    QString output = QString::fromUtf8(data).trimmed();
+    bool wasSuspended = m_slots[slot].suspended;
+    setSlotSuspended(slot, suspended);
+    emit slotSuspendedChanged(slot, suspended);
     
-    if (!output.isEmpty()) {
-        logMessage("ERROR: " + output);
-        m_currentDownload.errorMessage += output + "\n";
+    // A pause that did not happen gives the slot back to its download
+    if (wasSuspended && !suspended && m_isRunning && !m_isPaused) {
+        QTimer::singleShot(0, this, &DownloadQueue::processNextDownload);
     }
 }
 
-void DownloadQueue::onDownloadFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void DownloadQueue::onWorkerFinished(int slot, const DownloadItem &item, qint64 attemptReusedBytes, qint64 attemptTransferredBytes)
 {
-    if (!m_hasCurrentDownload) return;
+    if (slot >= 0 && slot < m_slots.size()) {
+        // Cancelled while suspended: counted on its host again before it finishes there
+        setSlotSuspended(slot, false);
+        m_slots[slot].busy = false;
+        m_slots[slot].item = DownloadItem();
+    }
+    
+    QString host = UrlUtils::hostKey(item.url);
+    int previousLimit = m_hostThrottle.limit(host);
+    m_hostThrottle.onFinished(host, item.status == DownloadStatus::Completed);
+    if (m_hostThrottle.limit(host) > previousLimit) {
+        logMessage(QString("Host %1: concurrency limit raised to %2").arg(host).arg(m_hostThrottle.limit(host)));
+    }
+    
+    // Downloads cancelled by resetQueue() no longer belong to the queue
+    if (m_discardedIds.remove(item.id)) {
+        if (getActiveCount() == 0) {
+            emit downloadsActiveChanged(false);
+        }
+        emit queueStatusChanged(m_completedCount + getActiveCount(), m_totalCount);
+        trimIdleSlots();
+        return;
+    }
     
-    // Deactivate progress bar and hide percentage text
-    m_progressBar->setTextVisible(false);
-    m_progressBar->setValue(0);
-    m_currentDownload.finishTime = QDateTime::currentDateTime();
+    // Bytes this attempt reused from disk vs. downloaded, for the session totals
+    m_totalReusedBytes += attemptReusedBytes;
+    m_totalTransferredBytes += attemptTransferredBytes;
+    
+    bool retryRateLimited = item.status == DownloadStatus::Failed && item.rateLimited
+                            && item.retryCount < MAX_RATE_LIMIT_RETRIES;
+    bool retryResume = item.status == DownloadStatus::Failed && m_resumeEnabled
+                       && !item.partialFiles.isEmpty() && item.retryCount < MAX_RESUME_RETRIES;
+    // Prefetched or cached info holds signed format URLs that may have expired
+    bool retryStaleInfo = item.status == DownloadStatus::Failed && !item.infoJsonPath.isEmpty()
+                          && item.retryCount < MAX_RESUME_RETRIES;
+    if (retryStaleInfo && m_metadataCache) {
+        m_metadataCache->remove(item.url);
+    }
     
-    if (exitStatus == QProcess::CrashExit) {
-        m_currentDownload.status = DownloadStatus::Failed;
-        if (m_currentDownload.errorMessage.isEmpty()) {
-            m_currentDownload.errorMessage = "Process crashed unexpectedly";
+    // Stopped at window close or for an urgent item: back ahead of its equals,
+    // resumed from its .part files when it runs again; not counted as a retry
+    bool checkpointed = m_checkpointIds.remove(item.id) && item.status != DownloadStatus::Completed;
+    if (checkpointed) {
+        DownloadItem checkpoint = item;
+        checkpoint.status = DownloadStatus::Pending;
+        checkpoint.progress = 0;
+        checkpoint.rateLimited = false;
+        checkpoint.errorMessage.clear();
+        checkpoint.infoJsonPath.clear();
+        insertPending(checkpoint, true);
+        
+        if (m_journal) {
+            m_journal->recordEnqueue(checkpoint);
+        }
+        logMessage(QString("Checkpointed with %1 bytes on disk, requeued: %2")
+                   .arg(item.downloadedBytes).arg(item.url), item.id);
+    } else if (retryRateLimited || retryResume || retryStaleInfo) {
+        // Rate-limited, resumable and stale-info downloads go back to the front of the queue instead of failing
+        DownloadItem retry = item;
+        retry.status = DownloadStatus::Pending;
+        retry.progress = 0;
+        retry.rateLimited = false;
+        retry.errorMessage.clear();
+        retry.retryCount++;
+        // The retry always extracts again
+        retry.infoJsonPath.clear();
+        insertPending(retry, true);
+        
+        if (m_journal) {
+            m_journal->recordEnqueue(retry);
+        }
+        
+        if (retryRateLimited) {
+            logMessage(QString("Rate limited - retry %1 of %2 queued: %3").arg(retry.retryCount).arg(MAX_RATE_LIMIT_RETRIES).arg(item.url), retry.id);
+        } else if (retryStaleInfo && !retryResume) {
+            logMessage(QString("Failed with prefetched metadata - retrying with a fresh extraction: %1").arg(item.url), retry.id);
+        } else {
+            logMessage(QString("Download interrupted - resume %1 of %2 queued: %3").arg(retry.retryCount).arg(MAX_RESUME_RETRIES).arg(item.url), retry.id);
         }
-        logMessage("ERROR: yt-dlp process crashed unexpectedly");
-        emit downloadFailed(m_currentDownload, m_currentDownload.errorMessage);
-    } else if (exitCode == 0) {
-        m_currentDownload.status = DownloadStatus::Completed;
-        m_currentDownload.progress = 100;
-        logMessage("=== Download completed successfully ===");
-        emit downloadCompleted(m_currentDownload);
     } else {
-        m_currentDownload.status = DownloadStatus::Failed;
-        if (m_currentDownload.errorMessage.isEmpty()) {
-            m_currentDownload.errorMessage = QString("Process finished with error code: %1").arg(exitCode);
+        if (item.status == DownloadStatus::Completed) {
+            emit downloadCompleted(item);
+        } else if (item.status == DownloadStatus::Cancelled) {
+            emit downloadFailed(item, "Cancelled by user");
+        } else {
+            emit downloadFailed(item, item.errorMessage);
+        }
+        
+        if (item.startTime.isValid()) {
+            logMessage(QString("Stages: %1").arg(item.stageSummary()), item.id);
+        }
+        if (item.reusedBytes > 0) {
+            logMessage(QString("Resume: %1 bytes reused, %2 bytes transferred: %3")
+                       .arg(item.reusedBytes).arg(item.transferredBytes).arg(item.url), item.id);
+        }
+        
+        m_prefetcher->forget(item.id);
+        releaseInFlight(item);
+        if (m_archive && item.status == DownloadStatus::Completed) {
+            m_archive->add(item.url);
         }
-        logMessage(QString("ERROR: yt-dlp finished with error code: %1").arg(exitCode));
-        emit downloadFailed(m_currentDownload, m_currentDownload.errorMessage);
+        
+        // Add to completed downloads
+        m_completedDownloads.append(item);
+        m_completedCount++;
+        
+        if (m_journal) {
+            m_journal->recordFinish(item);
+            maybeCompactJournal();
+        }
+        updateGroup(item);
     }
     
-    // Add to completed downloads
-    m_completedDownloads.append(m_currentDownload);
-    m_completedCount++;
-    m_hasCurrentDownload = false;
+    if (getActiveCount() == 0) {
+        emit downloadsActiveChanged(false);
+    } else {
+        updateAggregateProgress();
+    }
     
-    updateProgressLabel();
-    emit queueStatusChanged(m_completedCount, m_totalCount);
+    emit queueStatusChanged(m_completedCount + getActiveCount(), m_totalCount);
     
-    // Clean up process
-    cleanupCurrentProcess();
+    trimIdleSlots();
     
-    // Process next download after a short delay
-    QTimer::singleShot(1000, this, &DownloadQueue::processNextDownload);
+    // The freed slot goes to the next item right away
+    processNextDownload();
 }
 
-DownloadItem DownloadQueue::getCurrentDownload() const
+void DownloadQueue::updateAggregateProgress()
 {
-    return m_hasCurrentDownload ? m_currentDownload : DownloadItem();
+    int active = 0;
+    int total = 0;
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy) {
+            active++;
+            total += slot.item.progress;
+        }
+    }
+    
+    if (active == 0) {
+        return;
+    }
+    
+    int percentage = total / active;
+    emit downloadProgress(percentage);
+    
+    // Per-download rate from the fetches in progress, kept across idle moments
+    double speed = 0.0;
+    int fetching = 0;
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy && !slot.suspended && slot.item.stage == DownloadStage::Fetch && slot.item.speed > 0) {
+            speed += slot.item.speed;
+            fetching++;
+        }
+    }
+    if (fetching > 0) {
+        m_slotRate = speed / fetching;
+    }
+    QDateTime now = QDateTime::currentDateTime();
+    if (!m_lastEstimateTime.isValid() || m_lastEstimateTime.msecsTo(now) >= 1000) {
+        m_lastEstimateTime = now;
+        emit scheduleEstimateChanged(expectedMeanCompletion());
+    }
 }
 
-void DownloadQueue::updateProgressLabel()
+DownloadItem DownloadQueue::getCurrentDownload() const
 {
-    if (m_progressGroup) {
-        int currentNumber = m_hasCurrentDownload ? m_completedCount + 1 : m_completedCount;
-        QString text = QString("Progress (%1/%2)").arg(currentNumber).arg(m_totalCount);
-        m_progressGroup->setTitle(text);
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy) {
+            return slot.item;
+        }
     }
+    return DownloadItem();
 }
 
-void DownloadQueue::logMessage(const QString &message)
+QList<DownloadItem> DownloadQueue::getActiveDownloads() const
 {
-    if (m_logOutput) {
-        m_logOutput->append(message);
+    QList<DownloadItem> active;
+    for (const WorkerSnapshot &slot : m_slots) {
+        if (slot.busy) {
+            active.append(slot.item);
+        }
     }
+    return active;
 }
 
-void DownloadQueue::cleanupCurrentProcess()
+void DownloadQueue::logMessage(const QString &message, quint64 itemId)
 {
-    if (m_currentProcess) {
-        if (m_currentProcess->state() == QProcess::Running) {
-            m_currentProcess->kill();
-            m_currentProcess->waitForFinished(3000);
-        }
-        m_currentProcess->deleteLater();
-        m_currentProcess = nullptr;
+    if (m_log) {
+        m_log->append("queue", message, itemId);
     }
 }
@@ -0,0 +1,738 @@
+#include "vimeodownloader/downloadworker.h"
+#include "vimeodownloader/formatutils.h"
+#include "vimeodownloader/hostthrottle.h"
+#include "vimeodownloader/metadatacache.h"
+#include "vimeodownloader/outputparser.h"
+#include "vimeodownloader/urlutils.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QThreadPool>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Time yt-dlp gets to exit after each cancellation step before escalating
+constexpr int CANCEL_ESCALATION_MS = 3000;
+
+// Inside the download folder, so the final move is a rename on the same disk
+const char STAGING_FOLDER[] = ".incomplete";
+
+// Info JSON written next to the output when the metadata cache is enabled
+const char STAGED_INFO_NAME[] = "metadata";
+const char STAGED_INFO_SUFFIX[] = ".info.json";
+
+#ifdef Q_OS_WIN
+typedef LONG (NTAPI *NtProcessControl)(HANDLE);
+
+bool setProcessSuspended(qint64 pid, bool suspend)
+{
+    // NtSuspendProcess / NtResumeProcess are the only whole-process suspend calls on Windows
+    static const HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+    static const auto ntSuspend = reinterpret_cast<NtProcessControl>(GetProcAddress(ntdll, "NtSuspendProcess"));
+    static const auto ntResume = reinterpret_cast<NtProcessControl>(GetProcAddress(ntdll, "NtResumeProcess"));
+    NtProcessControl control = suspend ? ntSuspend : ntResume;
+    if (!control) {
+        return false;
+    }
+    
+    HANDLE handle = OpenProcess(PROCESS_SUSPEND_RESUME, FALSE, DWORD(pid));
+    if (!handle) {
+        return false;
+    }
+    LONG status = control(handle);
+    CloseHandle(handle);
+    return status >= 0;
+}
+
+// yt-dlp runs in its own process group, so Ctrl+Break reaches it and the
+// ffmpeg it spawns but nothing else. The event travels through a console:
+// ours when the child shares it (CLI), else the hidden one Qt gave the child.
+bool breakProcessGroup(qint64 pid)
+{
+    if (pid <= 0) {
+        return false;
+    }
+    DWORD group = DWORD(pid);
+    if (GenerateConsoleCtrlEvent(CTRL_BREAK_EVENT, group)) {
+        return true;
+    }
+    if (!AttachConsole(group)) {
+        return false;
+    }
+    BOOL ok = GenerateConsoleCtrlEvent(CTRL_BREAK_EVENT, group);
+    FreeConsole();
+    return ok;
+}
+#else
+// yt-dlp runs in its own process group so ffmpeg children get the same signals
+bool signalProcessGroup(qint64 pid, int signal)
+{
+    return pid > 0 && ::kill(-pid_t(pid), signal) == 0;
+}
+#endif
+}
+
+// Use QuickTime-compatible formats: H.264 video + AAC audio, fallback to best H.264
+const char DownloadWorker::FORMAT_SELECTOR[] = "bestvideo[vcodec^=avc1][ext=mp4]+bestaudio[acodec^=mp4a][ext=m4a]/best[vcodec^=avc1][ext=mp4]";
+
+DownloadWorker::DownloadWorker(int slot, QObject *parent)
+    : QObject(parent)
+    , m_slot(slot)
+    , m_busy(false)
+    , m_cancelRequested(false)
+    , m_resumeEnabled(true)
+    , m_suspended(false)
+    , m_throttled(false)
+    , m_progressInterval(0.5)
+    , m_process(nullptr)
+    , m_cancelTimer(nullptr)
+    , m_cancelStage(0)
+    , m_completedFormatBytes(0)
+    , m_currentResumeOffset(0)
+    , m_startReusedBytes(0)
+    , m_startTransferredBytes(0)
+    , m_diskPool(nullptr)
+{
+    m_cancelTimer = new QTimer(this);
+    m_cancelTimer->setSingleShot(true);
+    connect(m_cancelTimer, &QTimer::timeout, this, &DownloadWorker::onCancelTimeout);
+}
+
+DownloadWorker::~DownloadWorker()
+{
+    cleanupProcess();
+}
+
+void DownloadWorker::start(const DownloadItem &item, const QString &ytDlpPath, const QString &ffmpegPath)
+{
+    // Clean up any existing process
+    cleanupProcess();
+
+    m_item = item;
+    m_busy = true;
+    m_cancelRequested = false;
+    m_suspended = false;
+    m_throttled = false;
+    m_cancelStage = 0;
+
+    // Reset fragment tracking for new download
+    m_parser.reset();
+    m_completedFormatBytes = 0;
+    m_item.downloadedBytes = 0;
+    m_item.totalBytes = 0;
+    m_item.speed = 0.0;
+    m_item.eta = -1;
+    m_stdoutLines.clear();
+    m_stderrLines.clear();
+    m_currentDestination.clear();
+    m_currentResumeOffset = 0;
+    m_startReusedBytes = item.reusedBytes;
+    m_startTransferredBytes = item.transferredBytes;
+    
+    // Stage times add up over attempts; the clock starts again with this one
+    m_stageTimer.invalidate();
+    enterStage(DownloadStage::Resolve);
+    
+    if (m_resumeEnabled && !m_item.partialFiles.isEmpty()) {
+        qint64 partialBytes = 0;
+        for (const QString &path : m_item.partialFiles) {
+            partialBytes += bytesOnDisk(path);
+        }
+        emit logMessage(m_slot, QString("Resuming from partial files (%1 on disk)").arg(FormatUtils::formatBytes(partialBytes)));
+    }
+
+    // Create new process
+    m_process = new QProcess(this);
+    // New process group: pause/cancel reach yt-dlp and the ffmpeg it spawns
+#ifdef Q_OS_WIN
+    m_process->setCreateProcessArgumentsModifier([](QProcess::CreateProcessArguments *args) {
+        args->flags |= CREATE_NEW_PROCESS_GROUP;
+    });
+#else
+    m_process->setChildProcessModifier([]() { ::setpgid(0, 0); });
+#endif
+
+    // Connect signals
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &DownloadWorker::onProcessOutput);
+    connect(m_process, &QProcess::readyReadStandardError, this, &DownloadWorker::onProcessError);
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &DownloadWorker::onProcessFinished);
+    connect(m_process, &QProcess::errorOccurred, this, &DownloadWorker::onProcessErrorOccurred);
+
+    QStringList arguments = buildArguments(item, ffmpegPath);
+
+    QString commandLog = arguments.join(" ");
+    if (!item.password.isEmpty()) {
+        commandLog = commandLog.replace(item.password, "***");
+    }
+    emit logMessage(m_slot, QString("Executing: %1 %2").arg(ytDlpPath).arg(commandLog));
+    // Start failures arrive asynchronously through errorOccurred()
+    m_process->start(ytDlpPath, arguments);
+}
+
+void DownloadWorker::cancel()
+{
+    if (!m_process || m_process->state() == QProcess::NotRunning || m_cancelRequested) {
+        return;
+    }
+    
+    m_cancelRequested = true;
+    m_cancelStage = 0;
+    
+#ifdef Q_OS_WIN
+    // Console programs ignore terminate(); Ctrl+Break stops yt-dlp with its
+    // .part file on disk and lets ffmpeg finish cleanly. Killed if it fails.
+    if (m_suspended || m_throttled) {
+        setProcessSuspended(m_process->processId(), false);
+    }
+    if (!breakProcessGroup(m_process->processId())) {
+        m_process->kill();
+    }
+#else
+    // SIGINT makes yt-dlp stop cleanly and flush its .part file
+    signalProcessGroup(m_process->processId(), SIGINT);
+    if (m_suspended || m_throttled) {
+        signalProcessGroup(m_process->processId(), SIGCONT);
+    }
+#endif
+    m_throttled = false;
+    if (m_suspended) {
+        m_suspended = false;
+        emit suspendedChanged(m_slot, false);
+    }
+    
+    m_cancelTimer->start(CANCEL_ESCALATION_MS);
+}
+
+void DownloadWorker::onCancelTimeout()
+{
+    if (!m_process || m_process->state() == QProcess::NotRunning) {
+        return;
+    }
+    
+    m_cancelStage++;
+    if (m_cancelStage == 1) {
+        emit logMessage(m_slot, "yt-dlp did not stop after interrupt, terminating");
+#ifdef Q_OS_WIN
+        m_process->kill();
+#else
+        signalProcessGroup(m_process->processId(), SIGTERM);
+        m_cancelTimer->start(CANCEL_ESCALATION_MS);
+#endif
+    } else {
+        emit logMessage(m_slot, "yt-dlp did not terminate, killing");
+#ifndef Q_OS_WIN
+        signalProcessGroup(m_process->processId(), SIGKILL);
+#endif
+        m_process->kill();
+    }
+}
+
+bool DownloadWorker::pause()
+{
+    if (!m_process || m_process->state() != QProcess::Running || m_suspended || m_cancelRequested) {
+        return false;
+    }
+    
+#ifdef Q_OS_WIN
+    bool ok = setProcessSuspended(m_process->processId(), true);
+#else
+    bool ok = signalProcessGroup(m_process->processId(), SIGSTOP);
+#endif
+    if (ok) {
+        m_suspended = true;
+        emit logMessage(m_slot, "=== Download paused ===");
+        emit suspendedChanged(m_slot, true);
+    }
+    return ok;
+}
+
+bool DownloadWorker::resume()
+{
+    if (!m_process || !m_suspended) {
+        return false;
+    }
+    
+#ifdef Q_OS_WIN
+    bool ok = setProcessSuspended(m_process->processId(), false);
+#else
+    bool ok = signalProcessGroup(m_process->processId(), SIGCONT);
+#endif
+    if (ok) {
+        m_suspended = false;
+        m_throttled = false; // Running again; the next bandwidth tick decides
+        emit logMessage(m_slot, "=== Download resumed ===");
+        emit suspendedChanged(m_slot, false);
+    }
+    return ok;
+}
+
+bool DownloadWorker::setThrottled(bool throttled)
+{
+    if (throttled == m_throttled || !m_process || m_process->state() != QProcess::Running || m_cancelRequested) {
+        return false;
+    }
+    
+    // A paused process is stopped already and stays so
+    bool ok = true;
+    if (!m_suspended) {
+#ifdef Q_OS_WIN
+        ok = setProcessSuspended(m_process->processId(), throttled);
+#else
+        ok = signalProcessGroup(m_process->processId(), throttled ? SIGSTOP : SIGCONT);
+#endif
+    }
+    if (ok) {
+        m_throttled = throttled;
+    }
+    return ok;
+}
+
+QStringList DownloadWorker::buildArguments(const DownloadItem &item, const QString &ffmpegPath)
+{
+    QStringList arguments = accessArguments(item);
+
+    // Use a safer output template that avoids problematic characters;
+    // a literal % in the folder would read as a template field
+    arguments << "--output" << stagingDir(item).replace("%", "%%") + "/%(title).200s.%(ext)s";
+    arguments << "--restrict-filenames"; // Restrict filenames to ASCII characters
+    // Resume mode: continue partial .part files from earlier attempts, otherwise start over
+    arguments << (m_resumeEnabled ? "--continue" : "--no-continue");
+    // Structured progress on its own line, sampled every m_progressInterval seconds
+    arguments << "--newline";
+    arguments << "--progress-delta" << QString::number(m_progressInterval);
+    arguments << "--progress-template" << OutputParser::PROGRESS_TEMPLATE;
+    arguments << "--format" << FORMAT_SELECTOR;
+
+    // Add ffmpeg location for proper merging
+    if (!ffmpegPath.isEmpty() && ffmpegPath != "ffmpeg") {
+        arguments << "--ffmpeg-location" << ffmpegPath;
+        emit logMessage(m_slot, QString("Using ffmpeg location: %1").arg(ffmpegPath));
+    } else {
+        emit logMessage(m_slot, "WARNING: ffmpeg path not found or using system ffmpeg");
+    }
+
+    // Metadata resolved ahead of time: yt-dlp goes straight to the transfer
+    if (!item.infoJsonPath.isEmpty() && QFileInfo::exists(item.infoJsonPath)) {
+        arguments << "--load-info-json" << item.infoJsonPath;
+        emit logMessage(m_slot, "Using prefetched metadata");
+    } else {
+        // Keep what this extraction found for the next time the link is queued
+        if (!m_metadataCacheDir.isEmpty()) {
+            QString staged = stagingDir(item).replace("%", "%%") + "/" + STAGED_INFO_NAME;
+            arguments << "--write-info-json" << "--output" << "infojson:" + staged;
+        }
+        arguments << item.url;
+    }
+    return arguments;
+}
+
+QStringList DownloadWorker::accessArguments(const DownloadItem &item)
+{
+    QStringList arguments;
+
+    // Credentials are Vimeo's: yt-dlp rejects password login for YouTube and
+    // other hosts, whatever front end queued the item
+    if (UrlUtils::isVimeoUrl(item.url) && !item.username.isEmpty() && !item.password.isEmpty()) {
+        arguments << "-u" << item.username;
+        arguments << "-p" << item.password;
+    }
+
+    // Add cookies from browser for YouTube (helps avoid bot detection)
+    // Only use on macOS where it works reliably, skip on Windows due to DPAPI issues
+    if (item.url.contains("youtube.com") || item.url.contains("youtu.be")) {
+#ifndef Q_OS_WIN32
+        arguments << "--cookies-from-browser" << "chrome";
+#endif
+    }
+    return arguments;
+}
+
+void DownloadWorker::onProcessOutput()
+{
+    if (!m_process) return;
+
+    // Chunks can end mid-line, only complete lines are interpreted
+    m_stdoutLines.append(m_process->readAllStandardOutput(), [this](QByteArrayView line) {
+        handleOutputLine(line);
+    });
+}
+
+void DownloadWorker::onProcessError()
+{
+    if (!m_process) return;
+
+    m_stderrLines.append(m_process->readAllStandardError(), [this](QByteArrayView line) {
+        handleErrorLine(line);
+    });
+}
+
+void DownloadWorker::handleOutputLine(QByteArrayView line)
+{
+    OutputParser::LineType type = m_parser.parseLine(line);
+    // The first file or progress line ends the extraction
+    if ((type == OutputParser::Progress || type == OutputParser::Destination) && m_item.stage == DownloadStage::Resolve) {
+        enterStage(DownloadStage::Fetch);
+    }
+    if (type == OutputParser::Progress) {
+        handleProgress(m_parser.progress());
+        return;
+    }
+
+    QString output = QString::fromUtf8(line).trimmed();
+    if (output.isEmpty()) {
+        return;
+    }
+    emit logMessage(m_slot, output);
+
+    switch (type) {
+    case OutputParser::TotalFragments:
+        emit logMessage(m_slot, QString("Detected HLS download with %1 fragments").arg(m_parser.totalFragments()));
+        break;
+    case OutputParser::Destination:
+        // Track the file being written and extract title if available
+        beginDestination(QString::fromUtf8(m_parser.destination()));
+        if (m_item.title.isEmpty()) {
+            m_item.title = QString::fromUtf8(m_parser.destinationFileName());
+        }
+        break;
+    case OutputParser::ResumeOffset:
+        // yt-dlp reports how much of a .part file it is reusing
+        m_currentResumeOffset = m_parser.resumeOffset();
+        m_item.reusedBytes += m_currentResumeOffset;
+        break;
+    case OutputParser::Merge:
+        // Intermediate files are deleted after merging, account for them first
+        finishDestination();
+        enterStage(DownloadStage::Merge);
+        break;
+    case OutputParser::PostProcess:
+        if (m_item.stage != DownloadStage::Merge) {
+            finishDestination();
+            enterStage(DownloadStage::Merge);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void DownloadWorker::handleErrorLine(QByteArrayView line)
+{
+    QString output = QString::fromUtf8(line).trimmed();
+    if (output.isEmpty()) {
+        return;
+    }
+
+    emit logMessage(m_slot, "ERROR: " + output);
+    m_item.errorMessage += output + "\n";
+
+    if (HostThrottle::isRateLimitMessage(output)) {
+        m_item.rateLimited = true;
+        emit rateLimited(m_slot);
+    }
+}
+
+void DownloadWorker::handleProgress(const OutputParser::ProgressSample &sample)
+{
+    if (sample.structured) {
+        qint64 downloaded = qMax<qint64>(0, sample.downloadedBytes);
+        m_item.downloadedBytes = m_completedFormatBytes + downloaded;
+        m_item.totalBytes = sample.totalBytes > 0 ? m_completedFormatBytes + sample.totalBytes : 0;
+        m_item.speed = qMax(0.0, sample.speed);
+        m_item.eta = sample.eta;
+        if (m_item.firstByteMs < 0 && m_item.downloadedBytes > 0 && m_item.addedTime.isValid()) {
+            m_item.firstByteMs = m_item.addedTime.msecsTo(QDateTime::currentDateTime());
+        }
+
+        if (sample.finished) {
+            // The next format (e.g. audio after video) starts again from zero
+            m_completedFormatBytes += qMax(downloaded, sample.totalBytes);
+            m_item.speed = 0.0;
+            m_item.eta = 0;
+        }
+
+        QString message = QString("[download] %1% of %2 at %3 ETA %4")
+                              .arg(qRound(qMax(0.0, sample.percent)), 3)
+                              .arg(sample.totalBytes > 0 ? FormatUtils::formatBytes(sample.totalBytes) : QString("~"))
+                              .arg(FormatUtils::formatSpeed(m_item.speed))
+                              .arg(FormatUtils::formatDuration(m_item.eta));
+        if (sample.fragmentCount > 0) {
+            message += QString(" (frag %1/%2)").arg(sample.fragmentIndex).arg(sample.fragmentCount);
+        }
+        emit logMessage(m_slot, message);
+    }
+
+    if (sample.percent < 0) {
+        return;
+    }
+
+    // Percentage of the current file; estimated totals may shrink, so never go backwards
+    int progressInt = sample.finished ? 100 : static_cast<int>(sample.percent);
+    if (progressInt >= m_item.progress) {
+        m_item.progress = progressInt;
+        emit progressChanged(m_slot, progressInt);
+    }
+}
+
+void DownloadWorker::onProcessErrorOccurred(QProcess::ProcessError error)
+{
+    // Crashes and non-zero exits are reported through finished()
+    if (error != QProcess::FailedToStart) return;
+
+    emit logMessage(m_slot, "ERROR: Could not start yt-dlp. Verify it's installed.");
+    m_item.errorMessage = "Could not start yt-dlp";
+    onProcessFinished(-1, QProcess::CrashExit);
+}
+
+void DownloadWorker::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (!m_busy) return;
+
+    m_cancelTimer->stop();
+    m_suspended = false;
+    m_throttled = false;
+    
+    // Lines still unterminated when the process exited
+    if (m_process) {
+        onProcessOutput();
+        onProcessError();
+        handleOutputLine(m_stdoutLines.takeRemainder());
+        handleErrorLine(m_stderrLines.takeRemainder());
+    }
+    finishDestination();
+
+    bool succeeded = false;
+    if (m_cancelRequested) {
+        m_item.status = DownloadStatus::Cancelled;
+        emit logMessage(m_slot, "=== Download cancelled ===");
+    } else if (exitStatus == QProcess::CrashExit) {
+        m_item.status = DownloadStatus::Failed;
+        if (m_item.errorMessage.isEmpty()) {
+            m_item.errorMessage = "Process crashed unexpectedly";
+        }
+        emit logMessage(m_slot, "ERROR: yt-dlp process crashed unexpectedly");
+    } else if (exitCode == 0) {
+        // Not finished yet: the output is verified and moved first
+        succeeded = true;
+    } else {
+        m_item.status = DownloadStatus::Failed;
+        if (m_item.errorMessage.isEmpty()) {
+            m_item.errorMessage = QString("Process finished with error code: %1").arg(exitCode);
+        }
+        emit logMessage(m_slot, QString("ERROR: yt-dlp finished with error code: %1").arg(exitCode));
+    }
+
+    // The process is released later so the signal handler that got us here can return
+    if (m_process) {
+        m_process->disconnect(this);
+        m_process->deleteLater();
+        m_process = nullptr;
+    }
+
+    if (succeeded) {
+        finalizeOutput();
+    } else {
+        finish();
+    }
+}
+
+void DownloadWorker::finalizeOutput()
+{
+    enterStage(DownloadStage::Verify);
+    
+    // Runs on the disk pool; results come back to this worker's thread
+    QString staging = stagingDir(m_item);
+    QString targetDir = m_item.downloadDir;
+    QString url = m_item.url;
+    QString cacheDir = m_metadataCacheDir;
+    auto job = [this, staging, targetDir, url, cacheDir]() {
+        QString error;
+        QStringList files = verifyStaging(staging, &error);
+        if (error.isEmpty()) {
+            QMetaObject::invokeMethod(this, [this]() { enterStage(DownloadStage::Move); });
+            files = moveOutput(files, targetDir, &error);
+            
+            QFile info(QDir(staging).filePath(QString(STAGED_INFO_NAME) + STAGED_INFO_SUFFIX));
+            if (info.exists()) {
+                if (!cacheDir.isEmpty() && info.open(QIODevice::ReadOnly)) {
+                    MetadataCache::Entry entry;
+                    MetadataCache::store(cacheDir, url, info.readAll(), &entry);
+                    info.close();
+                }
+                info.remove();
+            }
+            // Only succeeds once the folders are empty
+            QDir().rmdir(staging);
+            QDir().rmdir(QFileInfo(staging).path());
+        }
+        QMetaObject::invokeMethod(this, [this, files, error]() { onOutputFinalized(files, error); });
+    };
+    
+    if (m_diskPool) {
+        m_diskPool->start(job);
+    } else {
+        job();
+    }
+}
+
+void DownloadWorker::onOutputFinalized(const QStringList &files, const QString &error)
+{
+    if (error.isEmpty()) {
+        m_item.status = DownloadStatus::Completed;
+        m_item.progress = 100;
+        m_item.partialFiles.clear();
+        m_item.outputFiles = files;
+        for (const QString &file : files) {
+            emit logMessage(m_slot, QString("Saved: %1").arg(file));
+        }
+        emit logMessage(m_slot, "=== Download completed successfully ===");
+    } else {
+        m_item.status = DownloadStatus::Failed;
+        m_item.errorMessage = error;
+        // yt-dlp considers these files done, resuming them would not change anything
+        m_item.partialFiles.clear();
+        emit logMessage(m_slot, "ERROR: " + error);
+    }
+    finish();
+}
+
+void DownloadWorker::finish()
+{
+    closeStage();
+    m_item.finishTime = QDateTime::currentDateTime();
+    m_busy = false;
+    emit finished(m_slot, m_item);
+}
+
+void DownloadWorker::enterStage(DownloadStage stage)
+{
+    closeStage();
+    m_item.stage = stage;
+    m_item.stageMs[int(stage)] = qMax<qint64>(0, m_item.stageMs[int(stage)]);
+    m_stageTimer.start();
+    emit stageChanged(m_slot, stage);
+}
+
+void DownloadWorker::closeStage()
+{
+    if (m_stageTimer.isValid()) {
+        m_item.stageMs[int(m_item.stage)] += m_stageTimer.elapsed();
+        m_stageTimer.invalidate();
+    }
+}
+
+QString DownloadWorker::stagingDir(const DownloadItem &item)
+{
+    // Keyed by URL, so a retried or re-added URL continues its own .part files
+    QByteArray key = QCryptographicHash::hash(item.url.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+    return QString("%1/%2/%3").arg(item.downloadDir, STAGING_FOLDER, QString::fromLatin1(key));
+}
+
+QStringList DownloadWorker::verifyStaging(const QString &staging, QString *error)
+{
+    QStringList files;
+    const QFileInfoList entries = QDir(staging).entryInfoList(QDir::Files, QDir::Name);
+    for (const QFileInfo &entry : entries) {
+        // Leftovers of interrupted transfers are not output: partial and
+        // temporary files ("Title.mp4.part", "Title.temp.mp4") and unmerged
+        // formats ("Title.f137.mp4") from this or an earlier killed attempt
+        static const QRegularExpression leftover("\\.(part|ytdl|temp)(\\.|-Frag|$)|\\.f\\d+\\.");
+        QString name = entry.fileName();
+        if (leftover.match(name).hasMatch() || name.endsWith(STAGED_INFO_SUFFIX)) {
+            continue;
+        }
+        if (entry.size() <= 0) {
+            *error = QString("Verification failed: %1 is empty").arg(name);
+            return QStringList();
+        }
+        files << entry.absoluteFilePath();
+    }
+    
+    if (files.isEmpty()) {
+        *error = QString("Verification failed: no output file in %1").arg(staging);
+    }
+    return files;
+}
+
+QStringList DownloadWorker::moveOutput(const QStringList &files, const QString &targetDir, QString *error)
+{
+    QStringList moved;
+    QDir target(targetDir);
+    for (const QString &path : files) {
+        // Never overwrite: another copy becomes "name (2).ext"
+        QFileInfo source(path);
+        QString destination = target.filePath(source.fileName());
+        for (int n = 2; QFileInfo::exists(destination); ++n) {
+            QString suffix = source.suffix().isEmpty() ? QString() : "." + source.suffix();
+            destination = target.filePath(QString("%1 (%2)%3").arg(source.completeBaseName()).arg(n).arg(suffix));
+        }
+        
+        if (!QFile::rename(path, destination)) {
+            *error = QString("Could not move %1 to %2").arg(path, destination);
+            break;
+        }
+        moved << destination;
+    }
+    return moved;
+}
+
+void DownloadWorker::beginDestination(const QString &path)
+{
+    finishDestination();
+    
+    m_currentDestination = path;
+    m_currentResumeOffset = 0;
+    // Progress is reported per file, the bar starts over for each one
+    m_item.progress = 0;
+    if (!m_item.partialFiles.contains(path)) {
+        m_item.partialFiles.append(path);
+    }
+}
+
+void DownloadWorker::finishDestination()
+{
+    if (m_currentDestination.isEmpty()) {
+        return;
+    }
+    
+    // Whatever grew beyond the resume offset was transferred in this attempt
+    qint64 size = bytesOnDisk(m_currentDestination);
+    m_item.transferredBytes += qMax<qint64>(0, size - m_currentResumeOffset);
+    m_currentDestination.clear();
+    m_currentResumeOffset = 0;
+}
+
+qint64 DownloadWorker::bytesOnDisk(const QString &path)
+{
+    QFileInfo partInfo(path + ".part");
+    if (partInfo.exists()) {
+        return partInfo.size();
+    }
+    QFileInfo fileInfo(path);
+    return fileInfo.exists() ? fileInfo.size() : 0;
+}
+
+void DownloadWorker::cleanupProcess()
+{
+    if (m_process) {
+        m_process->disconnect(this);
+        if (m_process->state() != QProcess::NotRunning) {
+#ifndef Q_OS_WIN
+            // SIGKILL also works on stopped processes and reaches the ffmpeg children
+            signalProcessGroup(m_process->processId(), SIGKILL);
+#endif
+            m_process->kill();
+        }
+        m_process->deleteLater();
+        m_process = nullptr;
+    }
+}
@@ -0,0 +1,149 @@
+#include "vimeodownloader/hostthrottle.h"
+
+#include <QRegularExpression>
+
+namespace {
+// Multiplicative decrease factor applied on rate limiting
+constexpr double DECREASE_FACTOR = 0.5;
+// Errors within this window belong to the same burst and only cut the limit once
+constexpr qint64 DECREASE_WINDOW_MS = 10000;
+// Cooldown doubles with each consecutive rate limit, up to the maximum
+constexpr qint64 BASE_COOLDOWN_MS = 15000;
+constexpr qint64 MAX_COOLDOWN_MS = 300000;
+}
+
+HostThrottle::HostThrottle()
+    : m_initialLimit(2)
+    , m_maxLimit(1)
+{
+}
+
+void HostThrottle::setMaxLimit(int maxLimit)
+{
+    m_maxLimit = qMax(1, maxLimit);
+    for (HostState &host : m_hosts) {
+        host.limit = qMin(host.limit, double(m_maxLimit));
+    }
+}
+
+HostThrottle::HostState &HostThrottle::state(const QString &host)
+{
+    auto it = m_hosts.find(host);
+    if (it == m_hosts.end()) {
+        HostState initial;
+        initial.limit = qMin(m_initialLimit, m_maxLimit);
+        it = m_hosts.insert(host, initial);
+    }
+    return it.value();
+}
+
+bool HostThrottle::canStart(const QString &host) const
+{
+    auto it = m_hosts.constFind(host);
+    if (it == m_hosts.constEnd()) {
+        return true;
+    }
+    
+    const HostState &hostState = it.value();
+    if (hostState.blockedUntil.isValid() && QDateTime::currentDateTime() < hostState.blockedUntil) {
+        return false;
+    }
+    return hostState.active < int(hostState.limit);
+}
+
+bool HostThrottle::canStartReplacing(const QString &host) const
+{
+    auto it = m_hosts.constFind(host);
+    if (it == m_hosts.constEnd()) {
+        return false;
+    }
+    
+    const HostState &hostState = it.value();
+    if (hostState.blockedUntil.isValid() && QDateTime::currentDateTime() < hostState.blockedUntil) {
+        return false;
+    }
+    return hostState.active > 0 && hostState.active - 1 < int(hostState.limit);
+}
+
+void HostThrottle::onStarted(const QString &host)
+{
+    state(host).active++;
+}
+
+void HostThrottle::onFinished(const QString &host, bool success)
+{
+    HostState &hostState = state(host);
+    hostState.active = qMax(0, hostState.active - 1);
+    
+    if (success) {
+        // Additive increase: +1 slot after `limit` consecutive successes
+        hostState.limit = qMin(hostState.limit + 1.0 / hostState.limit, double(m_maxLimit));
+        hostState.backoffLevel = 0;
+    }
+}
+
+void HostThrottle::onSuspended(const QString &host)
+{
+    HostState &hostState = state(host);
+    hostState.active = qMax(0, hostState.active - 1);
+}
+
+void HostThrottle::onResumed(const QString &host)
+{
+    state(host).active++;
+}
+
+bool HostThrottle::onRateLimited(const QString &host)
+{
+    HostState &hostState = state(host);
+    QDateTime now = QDateTime::currentDateTime();
+    
+    if (hostState.lastDecrease.isValid() && hostState.lastDecrease.msecsTo(now) < DECREASE_WINDOW_MS) {
+        return false;
+    }
+    
+    hostState.limit = qMax(1.0, hostState.limit * DECREASE_FACTOR);
+    hostState.lastDecrease = now;
+    
+    qint64 cooldown = qMin(BASE_COOLDOWN_MS << qMin(hostState.backoffLevel, 8), MAX_COOLDOWN_MS);
+    hostState.blockedUntil = now.addMSecs(cooldown);
+    hostState.backoffLevel++;
+    return true;
+}
+
+int HostThrottle::limit(const QString &host) const
+{
+    auto it = m_hosts.constFind(host);
+    return it == m_hosts.constEnd() ? qMin(m_initialLimit, m_maxLimit) : int(it->limit);
+}
+
+int HostThrottle::activeCount(const QString &host) const
+{
+    auto it = m_hosts.constFind(host);
+    return it == m_hosts.constEnd() ? 0 : it->active;
+}
+
+qint64 HostThrottle::msUntilNextUnblock() const
+{
+    QDateTime now = QDateTime::currentDateTime();
+    qint64 earliest = -1;
+    for (const HostState &hostState : m_hosts) {
+        if (hostState.blockedUntil.isValid() && now < hostState.blockedUntil) {
+            qint64 remaining = now.msecsTo(hostState.blockedUntil);
+            if (earliest < 0 || remaining < earliest) {
+                earliest = remaining;
+            }
+        }
+    }
+    return earliest;
+}
+
+bool HostThrottle::isRateLimitMessage(const QString &text)
+{
+    // Signatures printed by yt-dlp when Vimeo/YouTube throttle us
+    static const QRegularExpression rateLimitRegex(
+        "HTTP Error 429|Too Many Requests|rate[- ]limit|rate-limited|"
+        "temporarily blocked|Sign in to confirm you.re not a bot",
+        QRegularExpression::CaseInsensitiveOption);
+    return rateLimitRegex.match(text).hasMatch();
+}
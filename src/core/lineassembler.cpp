@@ -0,0 +1,8 @@
+#include "vimeodownloader/lineassembler.h"
+
+QByteArray LineAssembler::takeRemainder()
+{
+    QByteArray remainder = m_pending;
+    m_pending.resize(0);
+    return remainder;
+}
@@ -0,0 +1,62 @@
+#include "vimeodownloader/logbuffer.h"
+
+LogLevel LogEntry::levelForMessage(const QString &message)
+{
+    if (message.startsWith("ERROR") || message.contains("] ERROR")) {
+        return LogLevel::Error;
+    }
+    if (message.startsWith("WARNING") || message.contains("] WARNING") || message.startsWith(QString::fromUtf8("✗"))) {
+        return LogLevel::Warning;
+    }
+    if (message.contains("[download] ") && message.contains('%')) {
+        return LogLevel::Debug;
+    }
+    return LogLevel::Info;
+}
+
+QString LogEntry::levelName(LogLevel level)
+{
+    switch (level) {
+        case LogLevel::Debug: return "Debug";
+        case LogLevel::Info: return "Info";
+        case LogLevel::Warning: return "Warning";
+        case LogLevel::Error: return "Error";
+        default: return "Unknown";
+    }
+}
+
+LogBuffer::LogBuffer(int capacity)
+    : m_entries(qMax(1, capacity))
+    , m_head(0)
+    , m_size(0)
+{
+}
+
+void LogBuffer::append(const LogEntry &entry)
+{
+    int capacity = m_entries.size();
+    if (m_size == capacity) {
+        m_entries[m_head] = entry;
+        m_head = (m_head + 1) % capacity;
+        return;
+    }
+    m_entries[(m_head + m_size) % capacity] = entry;
+    m_size++;
+}
+
+void LogBuffer::removeFirst(int count)
+{
+    count = qBound(0, count, m_size);
+    for (int i = 0; i < count; ++i) {
+        // Release the strings now rather than when the slot is reused
+        m_entries[(m_head + i) % m_entries.size()] = LogEntry();
+    }
+    m_head = (m_head + count) % m_entries.size();
+    m_size -= count;
+}
+
+void LogBuffer::clear()
+{
+    removeFirst(m_size);
+    m_head = 0;
+}
@@ -0,0 +1,156 @@
+#include "vimeodownloader/logmodel.h"
+#include "vimeodownloader/logsink.h"
+
+LogModel::LogModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_buffer(capacity)
+    , m_sink(nullptr)
+{
+}
+
+void LogModel::append(LogLevel level, const QString &source, const QString &message, quint64 itemId)
+{
+    append(LogEntry(level, source, message, itemId));
+}
+
+void LogModel::append(const QString &source, const QString &message, quint64 itemId)
+{
+    append(LogEntry(LogEntry::levelForMessage(message), source, message, itemId));
+}
+
+void LogModel::append(const LogEntry &entry)
+{
+    appendBatch({ entry });
+}
+
+void LogModel::appendBatch(const QList<LogEntry> &entries)
+{
+    if (entries.isEmpty()) {
+        return;
+    }
+
+    // The file keeps everything, the on-screen buffer only the newest entries
+    if (m_sink) {
+        m_sink->write(entries);
+    }
+
+    // A batch larger than the whole buffer only keeps its tail
+    int capacity = m_buffer.capacity();
+    int first = qMax(0, int(entries.size()) - capacity);
+    int count = int(entries.size()) - first;
+
+    // Make room first so rows are removed from the top and added at the bottom
+    int evicted = qMax(0, m_buffer.size() + count - capacity);
+    if (evicted > 0) {
+        beginRemoveRows(QModelIndex(), 0, evicted - 1);
+        m_buffer.removeFirst(evicted);
+        endRemoveRows();
+    }
+
+    int row = m_buffer.size();
+    beginInsertRows(QModelIndex(), row, row + count - 1);
+    for (int i = first; i < entries.size(); ++i) {
+        m_buffer.append(entries.at(i));
+    }
+    endInsertRows();
+}
+
+void LogModel::clear()
+{
+    beginResetModel();
+    m_buffer.clear();
+    endResetModel();
+}
+
+void LogModel::setItemLabel(quint64 itemId, const QString &label)
+{
+    if (itemId == 0 || m_itemLabels.value(itemId) == label) {
+        return;
+    }
+    m_itemLabels.insert(itemId, label);
+    emit itemLabelsChanged();
+}
+
+void LogModel::setItemLabels(const QMap<quint64, QString> &labels)
+{
+    if (labels.isEmpty()) {
+        return;
+    }
+    for (auto it = labels.cbegin(); it != labels.cend(); ++it) {
+        if (it.key() != 0) {
+            m_itemLabels.insert(it.key(), it.value());
+        }
+    }
+    emit itemLabelsChanged();
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_buffer.size();
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_buffer.size()) {
+        return QVariant();
+    }
+
+    const LogEntry &entry = m_buffer.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return entry.timestamp.toString("hh:mm:ss") + "  " + entry.message;
+    case Qt::ToolTipRole:
+        return QString("%1 | %2 | %3%4")
+            .arg(entry.timestamp.toString(Qt::ISODate))
+            .arg(LogEntry::levelName(entry.level))
+            .arg(entry.source)
+            .arg(entry.itemId ? QString(" | #%1").arg(entry.itemId) : QString());
+    case TimestampRole:
+        return entry.timestamp;
+    case LevelRole:
+        return int(entry.level);
+    case SourceRole:
+        return entry.source;
+    case ItemIdRole:
+        return entry.itemId;
+    case MessageRole:
+        return entry.message;
+    default:
+        return QVariant();
+    }
+}
+
+LogFilterModel::LogFilterModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , m_minimumLevel(LogLevel::Debug)
+    , m_itemId(0)
+{
+}
+
+void LogFilterModel::setMinimumLevel(LogLevel level)
+{
+    if (m_minimumLevel != level) {
+        m_minimumLevel = level;
+        invalidateFilter();
+    }
+}
+
+void LogFilterModel::setItemId(quint64 itemId)
+{
+    if (m_itemId != itemId) {
+        m_itemId = itemId;
+        invalidateFilter();
+    }
+}
+
+bool LogFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    Q_UNUSED(sourceParent);
+
+    const LogModel *model = static_cast<const LogModel *>(sourceModel());
+    const LogEntry &entry = model->entry(sourceRow);
+    if (entry.level < m_minimumLevel) {
+        return false;
+    }
+    return m_itemId == 0 || entry.itemId == m_itemId;
+}
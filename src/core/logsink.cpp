@@ -0,0 +1,236 @@
+#include "vimeodownloader/logsink.h"
+
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+
+namespace {
+const char *LOG_BASE_NAME = "vimeodownloader";
+
+quint32 crc32(const QByteArray &data)
+{
+    static quint32 table[256];
+    static bool initialized = false;
+    if (!initialized) {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        initialized = true;
+    }
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (char byte : data) {
+        crc = table[(crc ^ quint8(byte)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void appendLittleEndian(QByteArray &out, quint32 value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out.append(char((value >> (8 * i)) & 0xFF));
+    }
+}
+}
+
+LogSink::LogSink(const QString &directory, const Options &options)
+    : m_directory(directory)
+    , m_options(options)
+    , m_thread(nullptr)
+    , m_dropped(0)
+    , m_stopping(false)
+{
+    QDir dir(m_directory);
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("LogSink");
+    m_thread->start(QThread::LowPriority);
+}
+
+LogSink::~LogSink()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wakeUp.wakeOne();
+    }
+    m_thread->wait();
+    delete m_thread;
+}
+
+QString LogSink::currentFilePath() const
+{
+    return m_directory + "/" + LOG_BASE_NAME + ".jsonl";
+}
+
+QString LogSink::rotatedFilePath(int index, bool compressed) const
+{
+    return QString("%1/%2.%3.jsonl%4").arg(m_directory).arg(LOG_BASE_NAME).arg(index).arg(compressed ? ".gz" : "");
+}
+
+void LogSink::write(const LogEntry &entry)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_pending.size() >= m_options.maxPending) {
+        m_dropped++;
+        return;
+    }
+    m_pending.append(entry);
+}
+
+void LogSink::write(const QList<LogEntry> &entries)
+{
+    QMutexLocker locker(&m_mutex);
+    int room = qMax(0, m_options.maxPending - int(m_pending.size()));
+    if (entries.size() <= room) {
+        m_pending.append(entries);
+    } else {
+        m_pending.append(entries.mid(0, room));
+        m_dropped += int(entries.size()) - room;
+    }
+}
+
+void LogSink::run()
+{
+    forever {
+        QList<LogEntry> batch;
+        int dropped = 0;
+        bool stopping = false;
+        {
+            // Producers are only woken up for shutdown: the writer polls so a
+            // burst of lines turns into a single batch instead of many wakeups
+            QMutexLocker locker(&m_mutex);
+            if (!m_stopping) {
+                m_wakeUp.wait(&m_mutex, m_options.flushIntervalMs);
+            }
+            batch.swap(m_pending);
+            dropped = m_dropped;
+            m_dropped = 0;
+            stopping = m_stopping;
+        }
+
+        if (!batch.isEmpty() || dropped > 0) {
+            writeBatch(batch, dropped);
+        }
+        if (stopping) {
+            break;
+        }
+    }
+
+    m_file.close();
+}
+
+void LogSink::writeBatch(const QList<LogEntry> &entries, int dropped)
+{
+    if (!m_file.isOpen() && !openCurrentFile()) {
+        return;
+    }
+
+    QByteArray data;
+    data.reserve(int(entries.size()) * 160);
+    for (const LogEntry &entry : entries) {
+        data.append(toJsonLine(entry));
+    }
+    if (dropped > 0) {
+        LogEntry notice(LogLevel::Warning, "log", QString("%1 log entries dropped, writer fell behind").arg(dropped));
+        data.append(toJsonLine(notice));
+    }
+
+    m_file.write(data);
+    m_file.flush();
+
+    if (m_file.size() >= m_options.maxFileSize) {
+        rotate();
+    }
+}
+
+bool LogSink::openCurrentFile()
+{
+    m_file.setFileName(currentFilePath());
+    return m_file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+void LogSink::rotate()
+{
+    m_file.close();
+
+    // Drop the oldest file, then shift the others up by one
+    QFile::remove(rotatedFilePath(m_options.maxFiles, true));
+    QFile::remove(rotatedFilePath(m_options.maxFiles, false));
+    for (int i = m_options.maxFiles - 1; i >= 1; --i) {
+        for (bool compressed : { true, false }) {
+            if (QFile::exists(rotatedFilePath(i, compressed))) {
+                QFile::rename(rotatedFilePath(i, compressed), rotatedFilePath(i + 1, compressed));
+            }
+        }
+    }
+
+    if (m_options.maxFiles <= 0) {
+        QFile::remove(currentFilePath());
+    } else if (!m_options.compress || !gzipFile(currentFilePath(), rotatedFilePath(1, true))) {
+        QFile::rename(currentFilePath(), rotatedFilePath(1, false));
+    } else {
+        QFile::remove(currentFilePath());
+    }
+
+    openCurrentFile();
+}
+
+QByteArray LogSink::toJsonLine(const LogEntry &entry)
+{
+    QJsonObject object;
+    object.insert("ts", entry.timestamp.toString(Qt::ISODateWithMs));
+    object.insert("level", LogEntry::levelName(entry.level).toLower());
+    object.insert("source", entry.source);
+    if (entry.itemId != 0) {
+        object.insert("item", qint64(entry.itemId));
+    }
+    object.insert("msg", entry.message);
+
+    QByteArray line = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    return line;
+}
+
+bool LogSink::gzipFile(const QString &sourcePath, const QString &targetPath)
+{
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray data = source.readAll();
+    source.close();
+
+    // qCompress emits a 4-byte length, a 2-byte zlib header, the raw deflate
+    // stream and an Adler-32; gzip wants the deflate stream with its own framing
+    QByteArray zlib = qCompress(data, 6);
+    if (zlib.size() < 10) {
+        return false;
+    }
+    QByteArray deflate = zlib.mid(6, zlib.size() - 10);
+
+    QByteArray gzip;
+    gzip.reserve(deflate.size() + 18);
+    const char header[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+    gzip.append(header, sizeof(header));
+    gzip.append(deflate);
+    appendLittleEndian(gzip, crc32(data));
+    appendLittleEndian(gzip, quint32(data.size()));
+
+    QSaveFile target(targetPath);
+    if (!target.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    target.write(gzip);
+    return target.commit();
+}
@@ -0,0 +1,155 @@
+#include "vimeodownloader/metadatacache.h"
+#include "vimeodownloader/urlutils.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+namespace {
+const char INFO_SUFFIX[] = ".info.json";
+const char SUMMARY_SUFFIX[] = ".meta.json";
+
+qint64 formatSize(const QJsonObject &format)
+{
+    double size = format.value("filesize").toDouble();
+    if (size <= 0) {
+        size = format.value("filesize_approx").toDouble();
+    }
+    return qint64(qMax(0.0, size));
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    // Readers never see half a file
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
+}
+
+MetadataCache::MetadataCache(const QString &directory, qint64 ttlSeconds)
+    : m_directory(directory)
+    , m_ttl(ttlSeconds)
+    , m_hits(0)
+    , m_misses(0)
+{
+    QDir().mkpath(m_directory);
+}
+
+bool MetadataCache::lookup(const QString &url, Entry *entry)
+{
+    QFile summaryFile(entryPath(m_directory, url, SUMMARY_SUFFIX));
+    QString infoPath = entryPath(m_directory, url, INFO_SUFFIX);
+    if (!summaryFile.open(QIODevice::ReadOnly) || !QFile::exists(infoPath)) {
+        m_misses++;
+        return false;
+    }
+
+    QJsonObject summary = QJsonDocument::fromJson(summaryFile.readAll()).object();
+    QDateTime fetched = QDateTime::fromMSecsSinceEpoch(qint64(summary.value("fetched").toDouble()));
+    // Another video can share the file name only through a hash collision
+    if (summary.value("key").toString() != UrlUtils::canonicalVideoKey(url)
+        || fetched.secsTo(QDateTime::currentDateTime()) >= m_ttl) {
+        summaryFile.close();
+        remove(url);
+        m_misses++;
+        return false;
+    }
+
+    entry->title = summary.value("title").toString();
+    entry->duration = summary.value("duration").toInt(-1);
+    entry->estimatedBytes = qint64(summary.value("estimatedBytes").toDouble());
+    entry->formatId = summary.value("formatId").toString();
+    entry->infoJsonPath = infoPath;
+    entry->fetchedTime = fetched;
+    m_hits++;
+    return true;
+}
+
+bool MetadataCache::store(const QString &directory, const QString &url, const QByteArray &infoJson, Entry *entry)
+{
+    if (!parseInfo(infoJson, entry)) {
+        return false;
+    }
+    entry->fetchedTime = QDateTime::currentDateTime();
+
+    QJsonObject summary;
+    summary.insert("key", UrlUtils::canonicalVideoKey(url));
+    summary.insert("fetched", double(entry->fetchedTime.toMSecsSinceEpoch()));
+    summary.insert("title", entry->title);
+    summary.insert("duration", entry->duration);
+    summary.insert("estimatedBytes", double(entry->estimatedBytes));
+    summary.insert("formatId", entry->formatId);
+
+    // The summary goes last: an entry without it is never used
+    QString infoPath = entryPath(directory, url, INFO_SUFFIX);
+    if (!writeFile(infoPath, infoJson)
+        || !writeFile(entryPath(directory, url, SUMMARY_SUFFIX), QJsonDocument(summary).toJson(QJsonDocument::Compact))) {
+        return false;
+    }
+    entry->infoJsonPath = infoPath;
+    return true;
+}
+
+void MetadataCache::remove(const QString &url)
+{
+    QFile::remove(entryPath(m_directory, url, SUMMARY_SUFFIX));
+    QFile::remove(entryPath(m_directory, url, INFO_SUFFIX));
+}
+
+int MetadataCache::prune()
+{
+    // File times are enough here; lookup() checks the summary's own timestamp
+    QDateTime oldest = QDateTime::currentDateTime().addSecs(-m_ttl);
+    int removed = 0;
+    QDir dir(m_directory);
+    const QFileInfoList files = dir.entryInfoList({ QString("*") + SUMMARY_SUFFIX }, QDir::Files);
+    for (const QFileInfo &file : files) {
+        if (file.lastModified() < oldest) {
+            QString base = file.fileName().chopped(int(qstrlen(SUMMARY_SUFFIX)));
+            QFile::remove(file.absoluteFilePath());
+            QFile::remove(dir.filePath(base + INFO_SUFFIX));
+            removed++;
+        }
+    }
+    return removed;
+}
+
+bool MetadataCache::parseInfo(const QByteArray &json, Entry *entry)
+{
+    QJsonDocument document = QJsonDocument::fromJson(json);
+    if (!document.isObject()) {
+        return false;
+    }
+    QJsonObject info = document.object();
+    // Playlists are expanded elsewhere; only single videos are cached
+    if (info.value("_type").toString() == "playlist") {
+        return false;
+    }
+
+    entry->title = info.value("title").toString();
+    entry->duration = info.value("duration").isDouble() ? qRound(info.value("duration").toDouble()) : -1;
+    entry->formatId = info.value("format_id").toString();
+
+    // Merged downloads list their video and audio parts separately
+    entry->estimatedBytes = 0;
+    const QJsonArray parts = info.value("requested_formats").toArray();
+    if (parts.isEmpty()) {
+        entry->estimatedBytes = formatSize(info);
+    } else {
+        for (const QJsonValue &part : parts) {
+            entry->estimatedBytes += formatSize(part.toObject());
+        }
+    }
+    return true;
+}
+
+QString MetadataCache::entryPath(const QString &directory, const QString &url, const char *suffix)
+{
+    QByteArray key = UrlUtils::canonicalVideoKey(url).toUtf8();
+    QByteArray name = QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex().left(20);
+    return QDir(directory).filePath(QString::fromLatin1(name) + suffix);
+}
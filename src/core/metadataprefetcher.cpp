@@ -0,0 +1,186 @@
+#include "vimeodownloader/metadataprefetcher.h"
+#include "vimeodownloader/downloadworker.h"
+#include "vimeodownloader/hostthrottle.h"
+
+#include <QFile>
+#include <QTimer>
+
+namespace {
+// yt-dlp messages that mean the video cannot be downloaded at all
+const char *const PERMANENT_ERRORS[] = {
+    "http error 404",
+    "http error 410",
+    "unsupported url",
+    "video unavailable",
+    "does not exist",
+    "private video",
+    "this video is private",
+    "has been removed",
+    "is not a valid url",
+};
+}
+
+MetadataPrefetcher::MetadataPrefetcher(QObject *parent)
+    : QObject(parent)
+    , m_cache(nullptr)
+{
+}
+
+MetadataPrefetcher::~MetadataPrefetcher()
+{
+    cancelAll();
+}
+
+bool MetadataPrefetcher::prefetch(const DownloadItem &item, const QString &ytDlpPath)
+{
+    if (m_tried.contains(item.id)) {
+        return false;
+    }
+    
+    // Re-queued links: answered from the cache, delivered like any other result
+    Metadata cached;
+    if (m_cache && m_cache->lookup(item.url, &cached)) {
+        m_tried.insert(item.id);
+        quint64 id = item.id;
+        QMetaObject::invokeMethod(this, [this, id, cached]() { emit resolved(id, cached); }, Qt::QueuedConnection);
+        return true;
+    }
+    
+    if (!hasCapacity() || !m_infoDir.isValid()) {
+        return false;
+    }
+    m_tried.insert(item.id);
+
+    QProcess *process = new QProcess(this);
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this, process](int exitCode, QProcess::ExitStatus exitStatus) {
+                onProcessFinished(process, exitCode, exitStatus);
+            });
+    connect(process, &QProcess::errorOccurred, this, [this, process](QProcess::ProcessError error) {
+        // Other errors are followed by finished()
+        if (error == QProcess::FailedToStart && m_processes.contains(process)) {
+            quint64 id = m_processes.value(process);
+            release(process);
+            emit failed(id, "Could not start yt-dlp", false);
+        }
+    });
+    // A stuck extraction must not hold a prefetch process forever
+    QTimer::singleShot(TIMEOUT_MS, process, [process]() { process->kill(); });
+
+    // Same format selection as the download, so the sizes match what is fetched
+    QStringList arguments = DownloadWorker::accessArguments(item);
+    arguments << "--dump-single-json" << "--no-playlist" << "--no-warnings";
+    arguments << "--format" << DownloadWorker::FORMAT_SELECTOR;
+    arguments << item.url;
+
+    m_processes.insert(process, item.id);
+    process->start(ytDlpPath, arguments);
+    return true;
+}
+
+void MetadataPrefetcher::cancel(quint64 id)
+{
+    for (auto it = m_processes.cbegin(); it != m_processes.cend(); ++it) {
+        if (it.value() == id) {
+            release(it.key());
+            return;
+        }
+    }
+}
+
+bool MetadataPrefetcher::resolveCached(const DownloadItem &item)
+{
+    if (!m_cache || m_tried.contains(item.id) || m_cacheMisses.contains(item.id)) {
+        return false;
+    }
+    Metadata cached;
+    if (!m_cache->lookup(item.url, &cached)) {
+        m_cacheMisses.insert(item.id);
+        return false;
+    }
+    m_tried.insert(item.id);
+    quint64 id = item.id;
+    QMetaObject::invokeMethod(this, [this, id, cached]() { emit resolved(id, cached); }, Qt::QueuedConnection);
+    return true;
+}
+
+void MetadataPrefetcher::cancelAll()
+{
+    const QList<QProcess *> processes = m_processes.keys();
+    for (QProcess *process : processes) {
+        release(process);
+    }
+}
+
+void MetadataPrefetcher::forget(quint64 id)
+{
+    cancel(id);
+    m_tried.remove(id);
+    m_cacheMisses.remove(id);
+    QFile::remove(m_infoDir.filePath(QString("%1.info.json").arg(id)));
+}
+
+bool MetadataPrefetcher::isPermanentError(const QString &message)
+{
+    // A rate limit says nothing about the video itself
+    if (HostThrottle::isRateLimitMessage(message)) {
+        return false;
+    }
+    for (const char *pattern : PERMANENT_ERRORS) {
+        if (message.contains(QLatin1String(pattern), Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MetadataPrefetcher::onProcessFinished(QProcess *process, int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (!m_processes.contains(process)) {
+        return;
+    }
+    quint64 id = m_processes.value(process);
+    QString url = process->arguments().value(process->arguments().size() - 1);
+    QByteArray json = process->readAllStandardOutput();
+    QString errors = QString::fromUtf8(process->readAllStandardError()).trimmed();
+    release(process);
+
+    Metadata metadata;
+    if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        if (m_cache && m_cache->store(url, json, &metadata)) {
+            emit resolved(id, metadata);
+            return;
+        }
+        if (MetadataCache::parseInfo(json, &metadata)) {
+            // Without the file the download simply extracts again
+            QFile file(m_infoDir.filePath(QString("%1.info.json").arg(id)));
+            if (file.open(QIODevice::WriteOnly) && file.write(json) == json.size()) {
+                metadata.infoJsonPath = file.fileName();
+            }
+            metadata.fetchedTime = QDateTime::currentDateTime();
+            emit resolved(id, metadata);
+            return;
+        }
+    }
+
+    // The last line carries yt-dlp's reason
+    QString error = errors.section('\n', -1).trimmed();
+    if (exitStatus != QProcess::NormalExit) {
+        error = "yt-dlp did not finish";
+    } else if (exitCode == 0) {
+        error = "Not a single video";
+    } else if (error.isEmpty()) {
+        error = QString("yt-dlp finished with error code: %1").arg(exitCode);
+    }
+    emit failed(id, error, exitStatus == QProcess::NormalExit && isPermanentError(error));
+}
+
+void MetadataPrefetcher::release(QProcess *process)
+{
+    m_processes.remove(process);
+    process->disconnect(this);
+    if (process->state() != QProcess::NotRunning) {
+        process->kill();
+    }
+    process->deleteLater();
+}
@@ -0,0 +1,288 @@
+#include "vimeodownloader/outputparser.h"
+
+#include <string_view>
+
+namespace {
+using Text = std::string_view;
+
+constexpr Text PROGRESS_TAG("[vdprogress]");
+constexpr Text DOWNLOAD_TAG("[download]");
+constexpr Text DESTINATION_TAG("[download] Destination:");
+constexpr Text RESUME_TAG("[download] Resuming download at byte ");
+constexpr Text FRAGMENTS_TAG("[hlsnative] Total fragments:");
+constexpr Text MERGER_TAG("[Merger]");
+constexpr Text MERGE_INTO("Merging formats into ");
+constexpr Text FIXUP_TAG("[Fixup");
+constexpr Text FRAG_OPEN("(frag ");
+constexpr Text FINISHED_STATUS("finished");
+
+Text toText(QByteArrayView view)
+{
+    return Text(view.data(), size_t(view.size()));
+}
+
+QByteArrayView toView(Text text)
+{
+    return QByteArrayView(text.data(), qsizetype(text.size()));
+}
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+Text trimmed(Text text)
+{
+    while (!text.empty() && isSpace(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && isSpace(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool startsWith(Text text, Text prefix)
+{
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Splits off the next space separated token
+Text nextToken(Text &text)
+{
+    while (!text.empty() && text.front() == ' ') {
+        text.remove_prefix(1);
+    }
+    size_t end = text.find(' ');
+    Text token = text.substr(0, end);
+    text.remove_prefix(end == Text::npos ? text.size() : end);
+    return token;
+}
+
+// Leading decimal digits, "NA" and other non-numbers fail
+bool parseInteger(Text text, qint64 &value, size_t *consumed = nullptr)
+{
+    size_t i = 0;
+    qint64 result = 0;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+        result = result * 10 + (text[i] - '0');
+        i++;
+    }
+    if (i == 0) {
+        return false;
+    }
+    value = result;
+    if (consumed) {
+        *consumed = i;
+    }
+    return true;
+}
+
+// Plain decimal notation as printed by Python for speeds, estimates and percentages
+bool parseDecimal(Text text, double &value, size_t *consumed = nullptr)
+{
+    size_t i = 0;
+    double result = 0.0;
+    bool digits = false;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+        result = result * 10.0 + (text[i] - '0');
+        digits = true;
+        i++;
+    }
+    if (i < text.size() && text[i] == '.') {
+        i++;
+        double scale = 0.1;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+            result += (text[i] - '0') * scale;
+            scale *= 0.1;
+            digits = true;
+            i++;
+        }
+    }
+    if (!digits) {
+        return false;
+    }
+    value = result;
+    if (consumed) {
+        *consumed = i;
+    }
+    return true;
+}
+}
+
+const char OutputParser::PROGRESS_TEMPLATE[] =
+    "download:[vdprogress] %(progress.status)s %(progress.downloaded_bytes)s "
+    "%(progress.total_bytes)s %(progress.total_bytes_estimate)s %(progress.speed)s "
+    "%(progress.eta)s %(progress.fragment_index)s %(progress.fragment_count)s";
+
+OutputParser::OutputParser()
+    : m_totalFragments(0)
+    , m_resumeOffset(0)
+{
+}
+
+void OutputParser::reset()
+{
+    m_progress = ProgressSample();
+    m_totalFragments = 0;
+    m_resumeOffset = 0;
+    m_destination = QByteArrayView();
+}
+
+OutputParser::LineType OutputParser::parseLine(QByteArrayView line)
+{
+    Text text = trimmed(toText(line));
+    if (text.empty() || text.front() != '[') {
+        return Other;
+    }
+
+    if (startsWith(text, PROGRESS_TAG)) {
+        return parseStructuredProgress(toView(text.substr(PROGRESS_TAG.size()))) ? Progress : Other;
+    }
+
+    if (startsWith(text, DESTINATION_TAG)) {
+        m_destination = toView(trimmed(text.substr(DESTINATION_TAG.size())));
+        m_resumeOffset = 0;
+        return m_destination.isEmpty() ? Other : Destination;
+    }
+
+    if (startsWith(text, RESUME_TAG)) {
+        qint64 offset = 0;
+        if (!parseInteger(text.substr(RESUME_TAG.size()), offset)) {
+            return Other;
+        }
+        m_resumeOffset = offset;
+        return ResumeOffset;
+    }
+
+    if (startsWith(text, DOWNLOAD_TAG)) {
+        return parseHumanProgress(toView(text.substr(DOWNLOAD_TAG.size()))) ? Progress : Other;
+    }
+
+    if (startsWith(text, FRAGMENTS_TAG)) {
+        qint64 count = 0;
+        if (!parseInteger(trimmed(text.substr(FRAGMENTS_TAG.size())), count)) {
+            return Other;
+        }
+        m_totalFragments = int(count);
+        return TotalFragments;
+    }
+
+    if (startsWith(text, MERGER_TAG)) {
+        // The merged output replaces the intermediate destinations
+        Text rest = trimmed(text.substr(MERGER_TAG.size()));
+        if (startsWith(rest, MERGE_INTO)) {
+            rest = rest.substr(MERGE_INTO.size());
+            if (rest.size() >= 2 && rest.front() == '"' && rest.back() == '"') {
+                rest = rest.substr(1, rest.size() - 2);
+            }
+            m_destination = toView(rest);
+        }
+        return Merge;
+    }
+
+    if (startsWith(text, FIXUP_TAG)) {
+        return PostProcess;
+    }
+
+    return Other;
+}
+
+QByteArrayView OutputParser::destinationFileName() const
+{
+    Text path = toText(m_destination);
+    size_t slash = path.find_last_of("/\\");
+    return slash == Text::npos ? m_destination : toView(path.substr(slash + 1));
+}
+
+bool OutputParser::parseStructuredProgress(QByteArrayView fields)
+{
+    // Field order matches PROGRESS_TEMPLATE; yt-dlp prints "NA" for missing ones
+    Text rest = toText(fields);
+    Text status = nextToken(rest);
+    Text downloaded = nextToken(rest);
+    Text total = nextToken(rest);
+    Text estimate = nextToken(rest);
+    Text speed = nextToken(rest);
+    Text eta = nextToken(rest);
+    Text fragmentIndex = nextToken(rest);
+    Text fragmentCount = nextToken(rest);
+    if (status.empty() || fragmentCount.empty()) {
+        return false;
+    }
+
+    ProgressSample sample;
+    sample.structured = true;
+    sample.finished = status == FINISHED_STATUS;
+
+    qint64 integer = 0;
+    double decimal = 0.0;
+    if (parseInteger(downloaded, integer)) {
+        sample.downloadedBytes = integer;
+    }
+    if (parseInteger(total, integer) && integer > 0) {
+        sample.totalBytes = integer;
+    } else if (parseDecimal(estimate, decimal) && decimal > 0) {
+        sample.totalBytes = qint64(decimal);
+    }
+    if (parseDecimal(speed, decimal)) {
+        sample.speed = decimal;
+    }
+    if (parseDecimal(eta, decimal)) {
+        sample.eta = int(decimal);
+    }
+    if (parseInteger(fragmentIndex, integer)) {
+        sample.fragmentIndex = int(integer);
+    }
+    if (parseInteger(fragmentCount, integer) && integer > 0) {
+        sample.fragmentCount = int(integer);
+        m_totalFragments = sample.fragmentCount;
+    }
+
+    if (sample.finished) {
+        sample.percent = 100.0;
+    } else if (sample.totalBytes > 0 && sample.downloadedBytes >= 0) {
+        sample.percent = qMin(100.0, double(sample.downloadedBytes) * 100.0 / double(sample.totalBytes));
+    } else if (sample.fragmentCount > 0 && sample.fragmentIndex >= 0) {
+        sample.percent = qMin(100.0, double(sample.fragmentIndex) * 100.0 / double(sample.fragmentCount));
+    }
+
+    m_progress = sample;
+    return true;
+}
+
+bool OutputParser::parseHumanProgress(QByteArrayView view)
+{
+    // "  45.2% of ~ 123.45MiB at 1.23MiB/s ETA 00:30 (frag 3/10)"
+    Text text = trimmed(toText(view));
+    double percent = 0.0;
+    size_t consumed = 0;
+    if (!parseDecimal(text, percent, &consumed) || consumed >= text.size() || text[consumed] != '%') {
+        return false;
+    }
+
+    ProgressSample sample;
+    sample.percent = qMin(percent, 100.0);
+
+    size_t frag = text.find(FRAG_OPEN);
+    if (frag != Text::npos) {
+        Text counts = text.substr(frag + FRAG_OPEN.size());
+        qint64 index = 0;
+        qint64 count = 0;
+        size_t digits = 0;
+        if (parseInteger(counts, index, &digits) && digits < counts.size() && counts[digits] == '/'
+            && parseInteger(counts.substr(digits + 1), count) && count > 0) {
+            sample.fragmentIndex = int(index);
+            sample.fragmentCount = int(count);
+            m_totalFragments = sample.fragmentCount;
+            // Overall progress: completed fragments plus the current one
+            sample.percent = qMin(100.0, (double(index - 1) + percent / 100.0) / double(count) * 100.0);
+        }
+    }
+
+    // "100% of 10.00MiB in 00:00:03" closes the file
+    sample.finished = percent >= 100.0 && text.find(" in ") != Text::npos;
+
+    m_progress = sample;
+    return true;
+}
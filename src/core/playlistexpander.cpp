@@ -0,0 +1,362 @@
+#include "vimeodownloader/playlistexpander.h"
+#include "vimeodownloader/downloadworker.h"
+#include "vimeodownloader/urlutils.h"
+
+#include <QDate>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+namespace {
+// Pages listed ahead of the last delivered one while the entry count is unknown
+constexpr int SPECULATIVE_PAGES = PlaylistExpander::MAX_PROCESSES;
+
+// Entry URL as yt-dlp's flat listing gives it; YouTube entries may only carry the id
+QString entryUrl(const QJsonObject &entry)
+{
+    QString url = entry.value("url").toString();
+    if (!url.startsWith("http")) {
+        url = entry.value("webpage_url").toString();
+    }
+    if (!url.startsWith("http") && entry.value("ie_key").toString() == "Youtube" && entry.contains("id")) {
+        url = "https://www.youtube.com/watch?v=" + entry.value("id").toString();
+    }
+    return url.startsWith("http") ? url : QString();
+}
+
+// Upload time in seconds since epoch, 0 when the flat listing does not say
+qint64 entryTimestamp(const QJsonObject &entry)
+{
+    if (entry.value("timestamp").isDouble()) {
+        return qint64(entry.value("timestamp").toDouble());
+    }
+    QDate date = QDate::fromString(entry.value("upload_date").toString(), "yyyyMMdd");
+    return date.isValid() ? date.startOfDay(Qt::UTC).toSecsSinceEpoch() : 0;
+}
+}
+
+PlaylistExpander::PlaylistExpander(QObject *parent)
+    : QObject(parent)
+    , m_nextJobId(1)
+{
+}
+
+PlaylistExpander::~PlaylistExpander()
+{
+    cancelAll();
+}
+
+void PlaylistExpander::expand(quint64 groupId, const DownloadItem &source, const QString &ytDlpPath,
+                              const SyncWatermark *previous)
+{
+    if (previous) {
+        SyncProgress progress;
+        progress.previous = *previous;
+        m_syncs.insert(groupId, progress);
+    }
+    addJob(groupId, source, ytDlpPath, false);
+    launchPages();
+}
+
+void PlaylistExpander::cancel(quint64 groupId)
+{
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+        if (it.value().groupId == groupId) {
+            const QList<QProcess *> processes = it.value().running.keys();
+            for (QProcess *process : processes) {
+                release(process);
+            }
+            it = m_jobs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_errors.remove(groupId);
+    m_syncs.remove(groupId);
+    launchPages();
+}
+
+void PlaylistExpander::cancelAll()
+{
+    const QList<QProcess *> processes = m_processes.keys();
+    for (QProcess *process : processes) {
+        release(process);
+    }
+    m_jobs.clear();
+    m_errors.clear();
+    m_syncs.clear();
+}
+
+void PlaylistExpander::addJob(quint64 groupId, const DownloadItem &source, const QString &ytDlpPath, bool nested)
+{
+    Job job;
+    job.groupId = groupId;
+    job.source = source;
+    job.ytDlpPath = ytDlpPath;
+    job.nested = nested;
+    // A first sync has nothing to stop at: listed in full, in parallel
+    job.sync = m_syncs.contains(groupId) && !m_syncs.value(groupId).previous.isEmpty();
+    m_jobs.insert(m_nextJobId++, job);
+}
+
+void PlaylistExpander::launchPages()
+{
+    for (auto it = m_jobs.begin(); it != m_jobs.end() && m_processes.size() < MAX_PROCESSES; ++it) {
+        while (m_processes.size() < MAX_PROCESSES && wantsPage(it.value())) {
+            startPage(it.key(), it.value());
+        }
+    }
+}
+
+bool PlaylistExpander::wantsPage(const Job &job) const
+{
+    if (!job.error.isEmpty()) {
+        return false;
+    }
+    // Incremental: the next page only if the previous one had no known entry
+    if (job.sync) {
+        return job.running.isEmpty() && job.nextPage == job.deliveredPages
+               && (job.lastPage < 0 || job.nextPage <= job.lastPage);
+    }
+    if (job.nextPage == 0) {
+        return true;
+    }
+    // The first page tells whether the count is known; wait for it
+    if (job.deliveredPages == 0) {
+        return false;
+    }
+    if (job.lastPage >= 0) {
+        return job.nextPage <= job.lastPage;
+    }
+    return job.nextPage < job.deliveredPages + SPECULATIVE_PAGES;
+}
+
+void PlaylistExpander::startPage(int jobId, Job &job)
+{
+    int page = job.nextPage++;
+
+    QProcess *process = new QProcess(this);
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this, process](int exitCode, QProcess::ExitStatus exitStatus) {
+                onPageFinished(process, exitCode, exitStatus);
+            });
+    connect(process, &QProcess::errorOccurred, this, [this, process](QProcess::ProcessError error) {
+        // Other errors are followed by finished()
+        if (error == QProcess::FailedToStart) {
+            onPageFinished(process, -1, QProcess::CrashExit);
+        }
+    });
+    QTimer::singleShot(TIMEOUT_MS, process, [process]() { process->kill(); });
+
+    QStringList arguments = DownloadWorker::accessArguments(job.source);
+    arguments << "--flat-playlist" << "--dump-single-json" << "--no-warnings";
+    arguments << "--playlist-items" << QString("%1:%2").arg(page * PAGE_SIZE + 1).arg((page + 1) * PAGE_SIZE);
+    arguments << job.source.url;
+
+    m_processes.insert(process, jobId);
+    job.running.insert(process, page);
+    process->start(job.ytDlpPath, arguments);
+}
+
+void PlaylistExpander::onPageFinished(QProcess *process, int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (!m_processes.contains(process)) {
+        return;
+    }
+    int jobId = m_processes.value(process);
+    Job &job = m_jobs[jobId];
+    int page = job.running.value(process);
+    bool failedToStart = process->error() == QProcess::FailedToStart;
+    QByteArray json = process->readAllStandardOutput();
+    QString errors = QString::fromUtf8(process->readAllStandardError()).trimmed();
+    release(process);
+
+    QJsonDocument document = QJsonDocument::fromJson(json);
+    QList<DownloadItem> nestedSources;
+    if (!failedToStart && exitStatus == QProcess::NormalExit && exitCode == 0 && document.isObject()) {
+        QJsonObject info = document.object();
+        QList<DownloadItem> items;
+
+        if (info.value("_type").toString() != "playlist") {
+            // Not a collection after all: the URL itself is the only entry
+            DownloadItem item = job.source;
+            item.groupId = job.groupId;
+            item.title = info.value("title").toString();
+            items.append(item);
+            job.lastPage = 0;
+        } else {
+            const QJsonArray entries = info.value("entries").toArray();
+            if (page == 0) {
+                int count = info.contains("playlist_count") ? info.value("playlist_count").toInt() : -1;
+                job.count = count;
+                if (count >= 0) {
+                    job.lastPage = qMax(0, (count - 1) / PAGE_SIZE);
+                }
+                if (!job.nested) {
+                    emit titleResolved(job.groupId, info.value("title").toString(), count);
+                }
+            }
+            // A short page is the end, whatever the count said
+            if (entries.size() < PAGE_SIZE) {
+                job.lastPage = job.lastPage < 0 ? page : qMin(job.lastPage, page);
+            }
+
+            auto syncProgress = m_syncs.find(job.groupId);
+            QList<DownloadItem> knownItems; // From the first entry the watermark knows
+            for (const QJsonValue &value : entries) {
+                QJsonObject entry = value.toObject();
+                QString url = entryUrl(entry);
+                if (url.isEmpty()) {
+                    continue;
+                }
+                // Channel tabs and sub-playlists; one level deep
+                if (entry.value("_type").toString() == "playlist" || UrlUtils::isCollectionUrl(url)) {
+                    if (!job.nested) {
+                        DownloadItem nested = job.source;
+                        nested.url = url;
+                        nestedSources.append(nested);
+                    }
+                    continue;
+                }
+                DownloadItem item(url, job.source.username, job.source.password, job.source.downloadDir);
+                item.priority = job.source.priority;
+                item.groupId = job.groupId;
+                item.title = entry.value("title").toString();
+                item.duration = entry.value("duration").isDouble() ? qRound(entry.value("duration").toDouble()) : -1;
+                
+                if (syncProgress != m_syncs.end()) {
+                    SyncProgress &progress = syncProgress.value();
+                    QString key = UrlUtils::canonicalVideoKey(url);
+                    qint64 timestamp = entryTimestamp(entry);
+                    if (page == 0 && progress.next.keys.size() < SyncStore::WATERMARK_KEYS) {
+                        progress.next.keys.append(key);
+                    }
+                    progress.next.newestTimestamp = qMax(progress.next.newestTimestamp, timestamp);
+                    if (job.sync && (!knownItems.isEmpty() || progress.previous.keys.contains(key)
+                                     || (timestamp > 0 && timestamp < progress.previous.newestTimestamp))) {
+                        knownItems.append(item);
+                        continue;
+                    }
+                }
+                items.append(item);
+            }
+            
+            if (syncProgress != m_syncs.end()) {
+                SyncProgress &progress = syncProgress.value();
+                progress.newEntries += int(items.size());
+                if (page == 0 && !job.nested) {
+                    progress.next.count = job.count;
+                }
+                if (!knownItems.isEmpty()) {
+                    // The count grew by more than what was above the watermark:
+                    // the collection is not newest first, so list all of it
+                    int expectedNew = job.count >= 0 && progress.previous.count >= 0 && !job.nested
+                                      ? job.count - progress.previous.count : 0;
+                    if (progress.newEntries < expectedNew) {
+                        job.sync = false;
+                        progress.newEntries += int(knownItems.size());
+                        items += knownItems;
+                    } else {
+                        progress.reachedKnown = true;
+                        job.lastPage = page;
+                    }
+                }
+            }
+        }
+        job.done.insert(page, items);
+    } else {
+        // Entries before the failed page are still delivered
+        QString error = errors.section('\n', -1).trimmed();
+        if (failedToStart) {
+            error = "Could not start yt-dlp";
+        } else if (exitStatus != QProcess::NormalExit) {
+            error = "yt-dlp did not finish";
+        } else if (exitCode == 0) {
+            error = "Unexpected yt-dlp output";
+        } else if (error.isEmpty()) {
+            error = QString("yt-dlp finished with error code: %1").arg(exitCode);
+        }
+        job.error = error;
+        job.lastPage = job.lastPage < 0 ? page - 1 : qMin(job.lastPage, page - 1);
+        if (!m_errors.contains(job.groupId)) {
+            m_errors.insert(job.groupId, error);
+        }
+    }
+
+    // Speculative pages past the end are not needed
+    if (job.lastPage >= 0 || !job.error.isEmpty()) {
+        const QList<QProcess *> processes = job.running.keys();
+        for (QProcess *running : processes) {
+            if (job.running.value(running) > job.lastPage) {
+                release(running);
+            }
+        }
+    }
+
+    quint64 groupId = job.groupId;
+    deliverPages(job);
+    for (const DownloadItem &nested : std::as_const(nestedSources)) {
+        addJob(groupId, nested, job.ytDlpPath, true);
+    }
+    finishJobIfDone(jobId);
+    launchPages();
+}
+
+void PlaylistExpander::deliverPages(Job &job)
+{
+    while (job.done.contains(job.deliveredPages)) {
+        QList<DownloadItem> items = job.done.take(job.deliveredPages);
+        job.deliveredPages++;
+        if (!items.isEmpty()) {
+            emit entriesReady(job.groupId, items);
+        }
+    }
+}
+
+void PlaylistExpander::finishJobIfDone(int jobId)
+{
+    auto it = m_jobs.find(jobId);
+    if (it == m_jobs.end()) {
+        return;
+    }
+    const Job &job = it.value();
+    bool listed = job.lastPage >= 0 && job.deliveredPages > job.lastPage;
+    if (!job.running.isEmpty() || (!listed && job.error.isEmpty())) {
+        return;
+    }
+
+    quint64 groupId = job.groupId;
+    m_jobs.erase(it);
+    for (const Job &other : std::as_const(m_jobs)) {
+        if (other.groupId == groupId) {
+            return;
+        }
+    }
+    auto sync = m_syncs.find(groupId);
+    if (sync != m_syncs.end()) {
+        SyncProgress progress = sync.value();
+        m_syncs.erase(sync);
+        if (progress.next.keys.isEmpty()) {
+            progress.next.keys = progress.previous.keys;
+        }
+        progress.next.newestTimestamp = qMax(progress.next.newestTimestamp, progress.previous.newestTimestamp);
+        progress.next.syncedTime = QDateTime::currentDateTime();
+        emit syncListed(groupId, progress.next, progress.newEntries, progress.reachedKnown);
+    }
+    emit finished(groupId, m_errors.take(groupId));
+}
+
+void PlaylistExpander::release(QProcess *process)
+{
+    int jobId = m_processes.take(process);
+    auto it = m_jobs.find(jobId);
+    if (it != m_jobs.end()) {
+        it.value().running.remove(process);
+    }
+    process->disconnect(this);
+    if (process->state() != QProcess::NotRunning) {
+        process->kill();
+    }
+    process->deleteLater();
+}
@@ -0,0 +1,460 @@
+#include "vimeodownloader/queuejournal.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace {
+constexpr quint32 SNAPSHOT_MAGIC = 0x56445153; // "VDQS"
+constexpr quint32 JOURNAL_MAGIC = 0x5644514A;  // "VDQJ"
+// Version 2 added the resume fields, version 3 the priority, version 4 the group,
+// version 5 the time window; older files are still readable
+constexpr quint16 FORMAT_VERSION = 5;
+constexpr int JOURNAL_HEADER_SIZE = 6;         // magic + version
+constexpr int RECORD_HEADER_SIZE = 7;          // size + checksum + type
+// Minimum interval between two progress checkpoints of the same item
+constexpr qint64 PROGRESS_CHECKPOINT_MS = 5000;
+
+void writeItem(QDataStream &out, const DownloadItem &item)
+{
+    out << item.id << item.url << item.username << item.password << item.downloadDir << item.title
+        << qint32(item.status) << item.addedTime << item.startTime << item.finishTime
+        << qint32(item.progress) << item.errorMessage << item.rateLimited << qint32(item.retryCount)
+        << item.partialFiles << item.reusedBytes << item.transferredBytes
+        << qint32(item.priority) << item.groupId << item.notBefore << item.notAfter;
+}
+
+DownloadItem readItem(QDataStream &in, quint16 version)
+{
+    DownloadItem item;
+    qint32 status = 0;
+    qint32 progress = 0;
+    qint32 retryCount = 0;
+    in >> item.id >> item.url >> item.username >> item.password >> item.downloadDir >> item.title
+       >> status >> item.addedTime >> item.startTime >> item.finishTime
+       >> progress >> item.errorMessage >> item.rateLimited >> retryCount;
+    item.status = static_cast<DownloadStatus>(status);
+    item.progress = progress;
+    item.retryCount = retryCount;
+    if (version >= 2) {
+        in >> item.partialFiles >> item.reusedBytes >> item.transferredBytes;
+    }
+    if (version >= 3) {
+        qint32 priority = 0;
+        in >> priority;
+        item.priority = priority;
+    }
+    if (version >= 4) {
+        in >> item.groupId;
+    }
+    if (version >= 5) {
+        in >> item.notBefore >> item.notAfter;
+    }
+    return item;
+}
+}
+
+QueueJournal::QueueJournal(const QString &directory)
+    : m_directory(directory)
+    , m_recordCount(0)
+{
+    QDir dir(m_directory);
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+}
+
+QueueJournal::~QueueJournal()
+{
+    if (m_journal.isOpen()) {
+        m_journal.close();
+    }
+}
+
+QString QueueJournal::journalPath() const
+{
+    return m_directory + "/queue.journal";
+}
+
+QString QueueJournal::snapshotPath() const
+{
+    return m_directory + "/queue.snapshot";
+}
+
+QString QueueJournal::resetBackupPath() const
+{
+    return m_directory + "/queue.before-reset.snapshot";
+}
+
+QueueJournalState QueueJournal::restore()
+{
+    QHash<quint64, DownloadItem> pending;
+    QList<DownloadItem> finished;
+    quint64 maxId = 0;
+
+    QueueJournalState snapshot;
+    if (readSnapshot(snapshotPath(), snapshot)) {
+        pending.reserve(snapshot.pending.size());
+        for (const DownloadItem &item : snapshot.pending) {
+            pending.insert(item.id, item);
+        }
+        finished = snapshot.finished;
+        maxId = snapshot.nextId - 1;
+    }
+
+    replayJournal(pending, finished, maxId);
+
+    QList<DownloadItem> ordered = pending.values();
+    std::sort(ordered.begin(), ordered.end(), [](const DownloadItem &a, const DownloadItem &b) {
+        return a.id < b.id;
+    });
+
+    // Downloads that were running when the app stopped go first so they resume right away
+    QueueJournalState state;
+    QList<DownloadItem> waiting;
+    for (DownloadItem &item : ordered) {
+        if (item.status == DownloadStatus::Downloading) {
+            item.status = DownloadStatus::Pending;
+            state.pending.append(item);
+        } else {
+            waiting.append(item);
+        }
+    }
+    state.interruptedCount = state.pending.size();
+    state.pending.append(waiting);
+    state.finished = finished;
+    state.nextId = maxId + 1;
+
+    openJournal(false);
+    return state;
+}
+
+void QueueJournal::replayJournal(QHash<quint64, DownloadItem> &pending, QList<DownloadItem> &finished, quint64 &maxId)
+{
+    QFile file(journalPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    if (data.size() < JOURNAL_HEADER_SIZE) {
+        return;
+    }
+
+    QDataStream header(data);
+    header.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    header >> magic >> version;
+    if (magic != JOURNAL_MAGIC || version == 0 || version > FORMAT_VERSION) {
+        return;
+    }
+
+    // Position of each finished id: a journal replayed over a snapshot that
+    // already holds its records must not count an item twice
+    QHash<quint64, int> finishedIndex;
+    for (int i = 0; i < finished.size(); ++i) {
+        finishedIndex.insert(finished.at(i).id, i);
+    }
+
+    qint64 offset = JOURNAL_HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= data.size()) {
+        QDataStream frame(QByteArray::fromRawData(data.constData() + offset, RECORD_HEADER_SIZE));
+        frame.setVersion(QDataStream::Qt_6_0);
+        quint32 size = 0;
+        quint16 checksum = 0;
+        quint8 type = 0;
+        frame >> size >> checksum >> type;
+
+        qint64 payloadOffset = offset + RECORD_HEADER_SIZE;
+        if (payloadOffset + size > data.size()) {
+            break; // Torn write at the end of the journal
+        }
+        QByteArray payload = QByteArray::fromRawData(data.constData() + payloadOffset, size);
+        if (qChecksum(payload) != checksum) {
+            break;
+        }
+
+        QDataStream in(payload);
+        in.setVersion(QDataStream::Qt_6_0);
+        switch (type) {
+        case RecordEnqueue: {
+            DownloadItem item = readItem(in, version);
+            pending.insert(item.id, item);
+            maxId = qMax(maxId, item.id);
+            break;
+        }
+        case RecordStart: {
+            quint64 id = 0;
+            QDateTime startTime;
+            in >> id >> startTime;
+            auto it = pending.find(id);
+            if (it != pending.end()) {
+                it->status = DownloadStatus::Downloading;
+                it->startTime = startTime;
+            }
+            break;
+        }
+        case RecordProgress: {
+            quint64 id = 0;
+            qint32 progress = 0;
+            in >> id >> progress;
+            auto it = pending.find(id);
+            if (it != pending.end()) {
+                it->progress = progress;
+            }
+            break;
+        }
+        case RecordPriority: {
+            quint64 id = 0;
+            qint32 priority = 0;
+            in >> id >> priority;
+            auto it = pending.find(id);
+            if (it != pending.end()) {
+                it->priority = priority;
+            }
+            break;
+        }
+        case RecordFinish: {
+            DownloadItem item = readItem(in, version);
+            pending.remove(item.id);
+            auto known = finishedIndex.constFind(item.id);
+            if (known != finishedIndex.constEnd()) {
+                finished[*known] = item;
+            } else {
+                finishedIndex.insert(item.id, finished.size());
+                finished.append(item);
+            }
+            maxId = qMax(maxId, item.id);
+            break;
+        }
+        case RecordClear:
+            pending.clear();
+            break;
+        case RecordReset:
+            pending.clear();
+            finished.clear();
+            finishedIndex.clear();
+            break;
+        default:
+            break;
+        }
+
+        offset = payloadOffset + size;
+    }
+
+    // Drop a partially written tail so new records are appended after valid data
+    if (offset < data.size()) {
+        QFile::resize(journalPath(), offset);
+    }
+}
+
+bool QueueJournal::openJournal(bool truncate)
+{
+    if (m_journal.isOpen()) {
+        m_journal.close();
+    }
+
+    m_journal.setFileName(journalPath());
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | (truncate ? QIODevice::Truncate : QIODevice::Append);
+    if (!m_journal.open(mode)) {
+        return false;
+    }
+
+    if (m_journal.size() == 0) {
+        QByteArray header;
+        QDataStream out(&header, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << JOURNAL_MAGIC << FORMAT_VERSION;
+        m_journal.write(header);
+        m_journal.flush();
+    }
+    return true;
+}
+
+void QueueJournal::appendFrame(QByteArray &out, RecordType type, const QByteArray &payload)
+{
+    QDataStream header(&out, QIODevice::WriteOnly | QIODevice::Append);
+    header.setVersion(QDataStream::Qt_6_0);
+    header << quint32(payload.size()) << quint16(qChecksum(payload)) << quint8(type);
+    out.append(payload);
+}
+
+void QueueJournal::appendRecord(RecordType type, const QByteArray &payload)
+{
+    if (!m_journal.isOpen()) {
+        return;
+    }
+
+    QByteArray frame;
+    frame.reserve(RECORD_HEADER_SIZE + payload.size());
+    appendFrame(frame, type, payload);
+
+    // Flushed per record so the OS has it even if the app crashes right after
+    m_journal.write(frame);
+    m_journal.flush();
+    m_recordCount++;
+}
+
+void QueueJournal::recordEnqueue(const DownloadItem &item)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    writeItem(out, item);
+    appendRecord(RecordEnqueue, payload);
+}
+
+void QueueJournal::recordEnqueue(const QList<DownloadItem> &items)
+{
+    if (!m_journal.isOpen() || items.isEmpty()) {
+        return;
+    }
+
+    // Same records as one by one, but a single write and flush for the batch
+    QByteArray frames;
+    QByteArray payload;
+    for (const DownloadItem &item : items) {
+        payload.resize(0);
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        writeItem(out, item);
+        appendFrame(frames, RecordEnqueue, payload);
+    }
+
+    m_journal.write(frames);
+    m_journal.flush();
+    m_recordCount += int(items.size());
+}
+
+void QueueJournal::recordStart(const DownloadItem &item)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << item.id << item.startTime;
+    appendRecord(RecordStart, payload);
+}
+
+void QueueJournal::recordProgress(const DownloadItem &item)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 &last = m_lastProgressCheckpoint[item.id];
+    if (now - last < PROGRESS_CHECKPOINT_MS) {
+        return;
+    }
+    last = now;
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << item.id << qint32(item.progress);
+    appendRecord(RecordProgress, payload);
+}
+
+void QueueJournal::recordPriority(const DownloadItem &item)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << item.id << qint32(item.priority);
+    appendRecord(RecordPriority, payload);
+}
+
+void QueueJournal::recordFinish(const DownloadItem &item)
+{
+    m_lastProgressCheckpoint.remove(item.id);
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    writeItem(out, item);
+    appendRecord(RecordFinish, payload);
+}
+
+void QueueJournal::recordClear()
+{
+    appendRecord(RecordClear, QByteArray());
+}
+
+void QueueJournal::recordReset(const QueueJournalState &stateBeforeReset)
+{
+    // Keep what was discarded so an accidental reset can be recovered by hand
+    writeSnapshot(resetBackupPath(), stateBeforeReset);
+    m_lastProgressCheckpoint.clear();
+    appendRecord(RecordReset, QByteArray());
+}
+
+bool QueueJournal::compact(const QueueJournalState &state)
+{
+    if (!writeSnapshot(snapshotPath(), state)) {
+        return false;
+    }
+
+    // A crash between these two steps replays the old journal over the new
+    // snapshot on the next start. Every record is already in the snapshot, so
+    // replaying it ends in the same state: pending items are keyed by id and
+    // finished items are deduplicated by id in replayJournal()
+    m_recordCount = 0;
+    return openJournal(true);
+}
+
+bool QueueJournal::readSnapshot(const QString &path, QueueJournalState &state) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (magic != SNAPSHOT_MAGIC || version == 0 || version > FORMAT_VERSION) {
+        return false;
+    }
+
+    qint32 pendingCount = 0;
+    qint32 finishedCount = 0;
+    in >> state.nextId >> pendingCount;
+    state.pending.reserve(pendingCount);
+    for (qint32 i = 0; i < pendingCount && in.status() == QDataStream::Ok; ++i) {
+        state.pending.append(readItem(in, version));
+    }
+    in >> finishedCount;
+    state.finished.reserve(finishedCount);
+    for (qint32 i = 0; i < finishedCount && in.status() == QDataStream::Ok; ++i) {
+        state.finished.append(readItem(in, version));
+    }
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool QueueJournal::writeSnapshot(const QString &path, const QueueJournalState &state) const
+{
+    // QSaveFile renames over the old snapshot only once everything is written
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << SNAPSHOT_MAGIC << FORMAT_VERSION << state.nextId << qint32(state.pending.size());
+    for (const DownloadItem &item : state.pending) {
+        writeItem(out, item);
+    }
+    out << qint32(state.finished.size());
+    for (const DownloadItem &item : state.finished) {
+        writeItem(out, item);
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
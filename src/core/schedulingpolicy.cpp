@@ -0,0 +1,264 @@
+#include "vimeodownloader/schedulingpolicy.h"
+
+#include <QDir>
+
+#include <algorithm>
+
+SchedulingPolicy::SchedulingPolicy()
+    : m_kind(Fifo)
+    , m_agingSeconds(1800)
+    , m_virtualTime(0.0)
+{
+}
+
+SchedulingPolicy::Kind SchedulingPolicy::kindFromName(const QString &name, bool *ok)
+{
+    QString lower = name.trimmed().toLower();
+    bool known = true;
+    Kind kind = Fifo;
+    if (lower == "shortest" || lower == "sjf") {
+        kind = ShortestFirst;
+    } else if (lower == "fair") {
+        kind = FairShare;
+    } else if (lower != "fifo") {
+        known = false;
+    }
+    if (ok) {
+        *ok = known;
+    }
+    return kind;
+}
+
+QString SchedulingPolicy::kindName(Kind kind)
+{
+    switch (kind) {
+        case ShortestFirst: return "shortest";
+        case FairShare: return "fair";
+        default: return "fifo";
+    }
+}
+
+void SchedulingPolicy::setFolderWeights(const QStringList &entries)
+{
+    m_weights.clear();
+    for (const QString &entry : entries) {
+        int separator = entry.lastIndexOf('=');
+        bool ok = false;
+        double value = separator > 0 ? entry.mid(separator + 1).trimmed().toDouble(&ok) : 0.0;
+        if (ok && value > 0) {
+            m_weights.insert(QDir::cleanPath(entry.left(separator).trimmed()), value);
+        }
+    }
+}
+
+int SchedulingPolicy::pick(const QList<DownloadItem> &pending, const std::function<bool(const DownloadItem &)> &canStart,
+                           const QDateTime &now) const
+{
+    // Startable items of the highest priority that has one
+    QList<int> candidates;
+    int bandPriority = 0;
+    for (int i = 0; i < pending.size(); ++i) {
+        const DownloadItem &item = pending.at(i);
+        if (!candidates.isEmpty() && item.priority < bandPriority) {
+            break;
+        }
+        if (!canStart(item)) {
+            continue;
+        }
+        if (candidates.isEmpty()) {
+            bandPriority = item.priority;
+        }
+        candidates.append(i);
+    }
+    if (candidates.isEmpty()) {
+        return -1;
+    }
+
+    for (int index : std::as_const(candidates)) {
+        if (isAged(pending.at(index), now)) {
+            return index;
+        }
+    }
+
+    switch (m_kind) {
+        case ShortestFirst: {
+            qint64 fallback = meanKnownBytes(pending);
+            int best = candidates.first();
+            for (int index : std::as_const(candidates)) {
+                if (expectedBytes(pending.at(index), fallback) < expectedBytes(pending.at(best), fallback)) {
+                    best = index;
+                }
+            }
+            return best;
+        }
+        case FairShare: {
+            int best = -1;
+            double bestStart = 0.0;
+            for (int index : std::as_const(candidates)) {
+                double start = qMax(m_served.value(folderKey(pending.at(index))), m_virtualTime);
+                if (best < 0 || start < bestStart) {
+                    best = index;
+                    bestStart = start;
+                }
+            }
+            return best;
+        }
+        default:
+            return candidates.first();
+    }
+}
+
+void SchedulingPolicy::onDispatched(const DownloadItem &item, const QList<DownloadItem> &pending)
+{
+    QString folder = folderKey(item);
+    double start = qMax(m_served.value(folder), m_virtualTime);
+    qint64 bytes = qMax<qint64>(1, expectedBytes(item, meanKnownBytes(pending)));
+    m_virtualTime = start;
+    m_served.insert(folder, start + double(bytes) / weight(folder));
+}
+
+void SchedulingPolicy::reset()
+{
+    m_served.clear();
+    m_virtualTime = 0.0;
+}
+
+QList<int> SchedulingPolicy::order(const QList<DownloadItem> &pending, const QDateTime &now) const
+{
+    QList<int> result;
+    result.reserve(pending.size());
+    qint64 fallback = meanKnownBytes(pending);
+    QHash<QString, double> served = m_served;
+    double virtualTime = m_virtualTime;
+
+    int bandStart = 0;
+    while (bandStart < pending.size()) {
+        int bandEnd = bandStart;
+        while (bandEnd < pending.size() && pending.at(bandEnd).priority == pending.at(bandStart).priority) {
+            bandEnd++;
+        }
+
+        QList<int> rest;
+        for (int i = bandStart; i < bandEnd; ++i) {
+            if (isAged(pending.at(i), now)) {
+                result.append(i);
+            } else {
+                rest.append(i);
+            }
+        }
+
+        if (m_kind == ShortestFirst) {
+            std::stable_sort(rest.begin(), rest.end(), [&pending, fallback](int a, int b) {
+                return expectedBytes(pending.at(a), fallback) < expectedBytes(pending.at(b), fallback);
+            });
+        } else if (m_kind == FairShare) {
+            // Replays onDispatched() over per-folder FIFO lists
+            QStringList folders;
+            QHash<QString, QList<int>> byFolder;
+            for (int index : std::as_const(rest)) {
+                QString folder = folderKey(pending.at(index));
+                if (!byFolder.contains(folder)) {
+                    folders.append(folder);
+                }
+                byFolder[folder].append(index);
+            }
+            int count = rest.size();
+            rest.clear();
+            QHash<QString, int> next;
+            while (rest.size() < count) {
+                QString chosen;
+                double chosenStart = 0.0;
+                for (const QString &folder : std::as_const(folders)) {
+                    if (next.value(folder) >= byFolder.value(folder).size()) {
+                        continue;
+                    }
+                    double start = qMax(served.value(folder), virtualTime);
+                    if (chosen.isNull() || start < chosenStart) {
+                        chosen = folder;
+                        chosenStart = start;
+                    }
+                }
+                int index = byFolder.value(chosen).at(next[chosen]++);
+                rest.append(index);
+                virtualTime = chosenStart;
+                served.insert(chosen, chosenStart + double(qMax<qint64>(1, expectedBytes(pending.at(index), fallback)))
+                                                      / weight(chosen));
+            }
+        }
+        result += rest;
+        bandStart = bandEnd;
+    }
+    return result;
+}
+
+double SchedulingPolicy::meanCompletionSeconds(const QList<DownloadItem> &running, const QList<DownloadItem> &pending,
+                                               int slots, double slotRate, const QDateTime &now) const
+{
+    if (running.isEmpty() && pending.isEmpty()) {
+        return 0.0;
+    }
+    if (slotRate <= 0 || slots <= 0) {
+        return -1.0;
+    }
+    qint64 fallback = meanKnownBytes(pending);
+    if (fallback <= 0) {
+        fallback = meanKnownBytes(running);
+    }
+    if (fallback <= 0) {
+        return -1.0;
+    }
+
+    // Seconds until each slot is free, greedily filled in start order
+    QList<double> freeAt;
+    double total = 0.0;
+    for (const DownloadItem &item : running) {
+        qint64 size = item.totalBytes > 0 ? item.totalBytes : expectedBytes(item, fallback);
+        double seconds = double(qMax<qint64>(0, size - item.downloadedBytes)) / slotRate;
+        freeAt.append(seconds);
+        total += seconds;
+    }
+    while (freeAt.size() < slots) {
+        freeAt.append(0.0);
+    }
+    const QList<int> starts = order(pending, now);
+    for (int index : starts) {
+        auto earliest = std::min_element(freeAt.begin(), freeAt.end());
+        *earliest += double(expectedBytes(pending.at(index), fallback)) / slotRate;
+        total += *earliest;
+    }
+    return total / double(running.size() + pending.size());
+}
+
+bool SchedulingPolicy::isAged(const DownloadItem &item, const QDateTime &now) const
+{
+    return m_agingSeconds > 0 && item.addedTime.isValid() && item.addedTime.secsTo(now) >= m_agingSeconds;
+}
+
+double SchedulingPolicy::weight(const QString &folder) const
+{
+    return m_weights.value(folder, 1.0);
+}
+
+qint64 SchedulingPolicy::meanKnownBytes(const QList<DownloadItem> &items)
+{
+    qint64 total = 0;
+    int count = 0;
+    for (const DownloadItem &item : items) {
+        qint64 size = item.estimatedBytes > 0 ? item.estimatedBytes : item.totalBytes;
+        if (size > 0) {
+            total += size;
+            count++;
+        }
+    }
+    return count > 0 ? total / count : 0;
+}
+
+qint64 SchedulingPolicy::expectedBytes(const DownloadItem &item, qint64 fallback)
+{
+    return item.estimatedBytes > 0 ? item.estimatedBytes : fallback;
+}
+
+QString SchedulingPolicy::folderKey(const DownloadItem &item)
+{
+    return QDir::cleanPath(item.downloadDir);
+}
@@ -0,0 +1,139 @@
+#include "vimeodownloader/singleinstance.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+
+namespace {
+const QByteArray MESSAGE_HEADER = "VDIPC1\n";
+const QByteArray MESSAGE_ACK = "OK\n";
+// A client that stops sending is dropped after this long
+constexpr int READ_TIMEOUT_MS = 2000;
+}
+
+SingleInstance::SingleInstance(const QString &key, QObject *parent)
+    : QObject(parent)
+    , m_key(key)
+    , m_server(nullptr)
+{
+}
+
+SingleInstance::~SingleInstance()
+{
+    if (m_server) {
+        m_server->close();
+    }
+}
+
+QString SingleInstance::defaultKey()
+{
+    // Local socket names are global on Windows: scope them by home folder
+    QByteArray user = QCryptographicHash::hash(QDir::homePath().toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+    return "LGA.VimeoDownloader." + QString::fromLatin1(user);
+}
+
+bool SingleInstance::sendToRunning(const QString &key, const QStringList &urls, int timeoutMs)
+{
+    QLocalSocket socket;
+    socket.connectToServer(key);
+    if (!socket.waitForConnected(timeoutMs)) {
+        return false;
+    }
+
+    QByteArray message = MESSAGE_HEADER;
+    for (const QString &url : urls) {
+        message += url.toUtf8() + '\n';
+    }
+    message += '\n';
+    socket.write(message);
+    if (!socket.waitForBytesWritten(timeoutMs)) {
+        return false;
+    }
+
+    // Without the acknowledgement the URLs may be lost, so this launch carries on
+    QByteArray reply;
+    while (!reply.contains('\n') && socket.waitForReadyRead(timeoutMs)) {
+        reply += socket.readAll();
+    }
+    socket.disconnectFromServer();
+    return reply == MESSAGE_ACK;
+}
+
+bool SingleInstance::listen()
+{
+    if (m_server) {
+        return true;
+    }
+
+    m_server = new QLocalServer(this);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &SingleInstance::onNewConnection);
+
+    if (m_server->listen(m_key)) {
+        return true;
+    }
+
+    // The name is taken: either a live instance or a stale socket file
+    QLocalSocket probe;
+    probe.connectToServer(m_key);
+    if (probe.waitForConnected(200)) {
+        probe.disconnectFromServer();
+        delete m_server;
+        m_server = nullptr;
+        return false;
+    }
+
+    QLocalServer::removeServer(m_key);
+    return m_server->listen(m_key);
+}
+
+void SingleInstance::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        m_buffers.insert(socket, QByteArray());
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            m_buffers.remove(socket);
+            socket->deleteLater();
+        });
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readMessage(socket); });
+        // Nothing useful arrives from a client that stalls
+        QTimer::singleShot(READ_TIMEOUT_MS, socket, [socket]() { socket->abort(); });
+    }
+}
+
+void SingleInstance::readMessage(QLocalSocket *socket)
+{
+    auto it = m_buffers.find(socket);
+    if (it == m_buffers.end()) {
+        socket->readAll();
+        return;
+    }
+
+    // Buffered until the terminating empty line
+    it->append(socket->readAll());
+    if (!it->endsWith("\n\n")) {
+        return;
+    }
+    QByteArray data = *it;
+    m_buffers.erase(it);
+
+    if (!data.startsWith(MESSAGE_HEADER)) {
+        socket->abort();
+        return;
+    }
+
+    QStringList urls;
+    const QList<QByteArray> lines = data.mid(MESSAGE_HEADER.size()).split('\n');
+    for (const QByteArray &line : lines) {
+        QByteArray url = line.trimmed();
+        if (!url.isEmpty()) {
+            urls << QString::fromUtf8(url);
+        }
+    }
+
+    socket->write(MESSAGE_ACK);
+    socket->flush();
+    emit urlsReceived(urls);
+}
@@ -0,0 +1,47 @@
+#include "vimeodownloader/syncstore.h"
+#include "vimeodownloader/urlutils.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+SyncStore::SyncStore(const QString &path)
+    : m_path(path)
+{
+    QFile file(m_path);
+    if (file.open(QIODevice::ReadOnly)) {
+        m_collections = QJsonDocument::fromJson(file.readAll()).object();
+    }
+}
+
+SyncWatermark SyncStore::watermark(const QString &url) const
+{
+    SyncWatermark watermark;
+    QJsonObject stored = m_collections.value(UrlUtils::canonicalVideoKey(url)).toObject();
+    const QJsonArray keys = stored.value("keys").toArray();
+    for (const QJsonValue &key : keys) {
+        watermark.keys.append(key.toString());
+    }
+    watermark.newestTimestamp = qint64(stored.value("newest").toDouble());
+    watermark.count = stored.value("count").toInt(-1);
+    if (stored.contains("synced")) {
+        watermark.syncedTime = QDateTime::fromMSecsSinceEpoch(qint64(stored.value("synced").toDouble()));
+    }
+    return watermark;
+}
+
+bool SyncStore::save(const QString &url, const SyncWatermark &watermark)
+{
+    QJsonObject stored;
+    stored.insert("url", url);
+    stored.insert("keys", QJsonArray::fromStringList(watermark.keys.mid(0, WATERMARK_KEYS)));
+    stored.insert("newest", double(watermark.newestTimestamp));
+    stored.insert("count", watermark.count);
+    stored.insert("synced", double(watermark.syncedTime.toMSecsSinceEpoch()));
+    m_collections.insert(UrlUtils::canonicalVideoKey(url), stored);
+
+    QByteArray data = QJsonDocument(m_collections).toJson(QJsonDocument::Indented);
+    QSaveFile file(m_path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
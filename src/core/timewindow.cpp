@@ -0,0 +1,123 @@
+#include "vimeodownloader/timewindow.h"
+
+#include <QStringList>
+#include <QTime>
+
+namespace {
+const char *const DAY_NAMES[] = { "mon", "tue", "wed", "thu", "fri", "sat", "sun" };
+
+int dayIndex(const QString &name)
+{
+    QString lower = name.trimmed().toLower().left(3);
+    for (int i = 0; i < 7; ++i) {
+        if (lower == DAY_NAMES[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+}
+
+TimeWindow::TimeWindow()
+    : m_always(true)
+    , m_days(0x7f)
+    , m_startMinute(0)
+    , m_endMinute(0)
+{
+}
+
+bool TimeWindow::parse(const QString &text, TimeWindow *window)
+{
+    QString trimmed = text.trimmed();
+    int space = trimmed.lastIndexOf(' ');
+    QStringList range = trimmed.mid(space + 1).split('-');
+    TimeWindow parsed;
+    bool ok = range.size() == 2
+              && (space < 0 || parseDays(trimmed.left(space), &parsed.m_days))
+              && parseMinute(range.at(0), &parsed.m_startMinute)
+              && parseMinute(range.at(1), &parsed.m_endMinute);
+    if (!ok) {
+        return false;
+    }
+    parsed.m_always = false;
+    parsed.m_text = trimmed;
+    *window = parsed;
+    return true;
+}
+
+bool TimeWindow::contains(const QDateTime &time) const
+{
+    if (m_always) {
+        return true;
+    }
+    int minute = time.time().hour() * 60 + time.time().minute();
+    int today = time.date().dayOfWeek() - 1;
+    int yesterday = (today + 6) % 7;
+    if (m_startMinute < m_endMinute) {
+        return (m_days & (1 << today)) && minute >= m_startMinute && minute < m_endMinute;
+    }
+    if (m_startMinute > m_endMinute) {
+        // After midnight the range still belongs to the day it started on
+        return ((m_days & (1 << today)) && minute >= m_startMinute)
+               || ((m_days & (1 << yesterday)) && minute < m_endMinute);
+    }
+    return m_days & (1 << today);
+}
+
+QDateTime TimeWindow::nextChange(const QDateTime &time) const
+{
+    if (m_always) {
+        return QDateTime();
+    }
+    // Changes only happen at the range ends, or at midnight when equal ends
+    // cover whole days; a week and a day covers them all
+    bool open = contains(time);
+    QDateTime best;
+    for (int day = 0; day <= 8; ++day) {
+        QDateTime midnight(time.date().addDays(day), QTime(0, 0));
+        for (int minute : { m_startMinute, m_endMinute, 0 }) {
+            QDateTime candidate = midnight.addSecs(qint64(minute) * 60);
+            if (candidate > time && contains(candidate) != open && (!best.isValid() || candidate < best)) {
+                best = candidate;
+            }
+        }
+    }
+    return best;
+}
+
+bool TimeWindow::parseDays(const QString &text, int *days)
+{
+    *days = 0;
+    const QStringList parts = text.split(',', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        QStringList ends = part.split('-');
+        int first = dayIndex(ends.first());
+        int last = ends.size() == 2 ? dayIndex(ends.last()) : first;
+        if (ends.size() > 2 || first < 0 || last < 0) {
+            return false;
+        }
+        // "Sat-Mon" wraps around the week
+        for (int day = first;; day = (day + 1) % 7) {
+            *days |= 1 << day;
+            if (day == last) {
+                break;
+            }
+        }
+    }
+    return *days != 0;
+}
+
+bool TimeWindow::parseMinute(const QString &text, int *minute)
+{
+    QTime time = QTime::fromString(text.trimmed(), "H:mm");
+    if (!time.isValid()) {
+        // "24:00" as the end of the day
+        if (text.trimmed() == "24:00") {
+            *minute = 24 * 60;
+            return true;
+        }
+        return false;
+    }
+    *minute = time.hour() * 60 + time.minute();
+    return true;
+}
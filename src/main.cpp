@@ -1,7 +1,9 @@
 #include "vimeodownloader/mainwindow.h"
 #include "vimeodownloader/colorutils.h"
+#include "vimeodownloader/singleinstance.h"
 
 #include <QApplication>
+#include <QCoreApplication>
 #include <QFile>
 #include <QTextStream>
 #include <QDebug>
@@ -9,10 +11,52 @@
 #include <QFontDatabase>
 #include <QDir>
 
+namespace {
+// Espera de la respuesta de otra instancia, que puede estar creando su ventana
+constexpr int INSTANCE_TIMEOUT_MS = 10000;
+}
+
 int main(int argc, char *argv[])
 {
+    // URLs pasados al lanzar (manejador del navegador, scripts)
+    QStringList urls;
+    for (int i = 1; i < argc; ++i) {
+        QString argument = QString::fromLocal8Bit(argv[i]);
+        if (argument.contains("://")) {
+            urls << argument;
+        }
+    }
+    
+    // Si ya hay una instancia abierta, se le pasan los URLs y se sale sin
+    // crear QApplication (sin plugin de plataforma, fuentes ni widgets)
+    // (la instancia dueña puede estar arrancando: se le da tiempo para contestar)
+    QString instanceKey = SingleInstance::defaultKey();
+    {
+        QCoreApplication probe(argc, argv);
+        if (SingleInstance::sendToRunning(instanceKey, urls, INSTANCE_TIMEOUT_MS)) {
+            return 0;
+        }
+    }
+    
     QApplication app(argc, argv);
     
+    // El nombre se reclama antes de crear cualquier widget; si otra ejecución
+    // lo tomó entretanto, se le pasan los URLs y se sale
+    SingleInstance instance(instanceKey);
+    if (!instance.listen()) {
+        if (SingleInstance::sendToRunning(instanceKey, urls, INSTANCE_TIMEOUT_MS)) {
+            return 0;
+        }
+        qWarning() << "Otra instancia está abierta pero no respondió";
+        return 1;
+    }
+    // Los URLs que lleguen mientras se arma la ventana se guardan para ella
+    QStringList receivedUrls = urls;
+    QMetaObject::Connection earlyUrls = QObject::connect(&instance, &SingleInstance::urlsReceived,
+                                                         [&receivedUrls](const QStringList &received) {
+        receivedUrls += received;
+    });
+    
     // Configurar información de la aplicación
     app.setApplicationName("VimeoDownloader");
     app.setApplicationVersion("1.0.0");
@@ -53,5 +97,12 @@ int main(int argc, char *argv[])
     MainWindow window;
     window.show();
     
+    // Las siguientes ejecuciones entregan sus URLs a esta ventana
+    QObject::disconnect(earlyUrls);
+    QObject::connect(&instance, &SingleInstance::urlsReceived, &window, &MainWindow::openExternalUrls);
+    if (!receivedUrls.isEmpty()) {
+        window.openExternalUrls(receivedUrls);
+    }
+    
     return app.exec();
 }
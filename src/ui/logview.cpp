@@ -0,0 +1,103 @@
+#include "vimeodownloader/logview.h"
+#include "vimeodownloader/logmodel.h"
+
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QListView>
+#include <QScrollBar>
+#include <QVBoxLayout>
+
+LogView::LogView(LogModel *model, QWidget *parent)
+    : QWidget(parent)
+    , m_model(model)
+    , m_filter(nullptr)
+    , m_listView(nullptr)
+    , m_levelCombo(nullptr)
+    , m_downloadCombo(nullptr)
+    , m_followTail(true)
+{
+    m_filter = new LogFilterModel(this);
+    m_filter->setSourceModel(m_model);
+    
+    // Filtros: nivel mínimo y descarga
+    m_levelCombo = new QComboBox(this);
+    m_levelCombo->addItem("All levels", int(LogLevel::Debug));
+    m_levelCombo->addItem("Info", int(LogLevel::Info));
+    m_levelCombo->addItem("Warnings", int(LogLevel::Warning));
+    m_levelCombo->addItem("Errors", int(LogLevel::Error));
+    
+    m_downloadCombo = new QComboBox(this);
+    m_downloadCombo->setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLengthWithIcon);
+    m_downloadCombo->setMinimumContentsLength(20);
+    
+    QHBoxLayout *filterLayout = new QHBoxLayout;
+    filterLayout->setContentsMargins(0, 0, 0, 0);
+    filterLayout->addWidget(m_levelCombo);
+    filterLayout->addWidget(m_downloadCombo, 1);
+    
+    // Vista virtualizada: filas de altura uniforme, sólo se dibujan las visibles
+    m_listView = new QListView(this);
+    m_listView->setObjectName("logView");
+    m_listView->setModel(m_filter);
+    m_listView->setUniformItemSizes(true);
+    m_listView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_listView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_listView->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    m_listView->setFont(QFont("Courier", 10));
+    
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(2);
+    layout->addLayout(filterLayout);
+    layout->addWidget(m_listView);
+    
+    connect(m_levelCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &LogView::onLevelChanged);
+    connect(m_downloadCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &LogView::onDownloadChanged);
+    connect(m_model, &LogModel::itemLabelsChanged, this, &LogView::refreshDownloadFilter);
+    connect(m_filter, &QAbstractItemModel::rowsAboutToBeInserted, this, &LogView::onRowsAboutToBeInserted);
+    connect(m_filter, &QAbstractItemModel::rowsInserted, this, &LogView::onRowsInserted);
+    
+    refreshDownloadFilter();
+}
+
+void LogView::onLevelChanged(int index)
+{
+    m_filter->setMinimumLevel(static_cast<LogLevel>(m_levelCombo->itemData(index).toInt()));
+    m_listView->scrollToBottom();
+}
+
+void LogView::onDownloadChanged(int index)
+{
+    m_filter->setItemId(m_downloadCombo->itemData(index).toULongLong());
+    m_listView->scrollToBottom();
+}
+
+void LogView::refreshDownloadFilter()
+{
+    quint64 selected = m_downloadCombo->currentData().toULongLong();
+    
+    m_downloadCombo->blockSignals(true);
+    m_downloadCombo->clear();
+    m_downloadCombo->addItem("All downloads", quint64(0));
+    const QMap<quint64, QString> labels = m_model->itemLabels();
+    for (auto it = labels.constBegin(); it != labels.constEnd(); ++it) {
+        m_downloadCombo->addItem(QString("#%1 %2").arg(it.key()).arg(it.value()), it.key());
+    }
+    int index = m_downloadCombo->findData(selected);
+    m_downloadCombo->setCurrentIndex(index >= 0 ? index : 0);
+    m_downloadCombo->blockSignals(false);
+}
+
+void LogView::onRowsAboutToBeInserted()
+{
+    // Only follow new lines if the user has not scrolled up to read older ones
+    QScrollBar *bar = m_listView->verticalScrollBar();
+    m_followTail = bar->value() >= bar->maximum();
+}
+
+void LogView::onRowsInserted()
+{
+    if (m_followTail) {
+        m_listView->scrollToBottom();
+    }
+}
@@ -1,8 +1,14 @@
 #include "vimeodownloader/mainwindow.h"
+#include "vimeodownloader/apppaths.h"
 #include "vimeodownloader/downloader.h"
 #include "vimeodownloader/colorutils.h"
 #include "vimeodownloader/toolsmanager.h"
 #include "vimeodownloader/downloadqueue.h"
+#include "vimeodownloader/urlutils.h"
+#include "vimeodownloader/formatutils.h"
+#include "vimeodownloader/logmodel.h"
+#include "vimeodownloader/logsink.h"
+#include "vimeodownloader/logview.h"
 #include <QApplication>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -10,7 +16,6 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QProgressBar>
-#include <QTextEdit>
 #include <QGroupBox>
 #include <QMessageBox>
 #include <QUrl>
@@ -26,6 +31,7 @@
 #include <QRegularExpression>
 #include <QCoreApplication>
 #include <QFile>
+#include <QFileInfo>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
@@ -55,7 +61,9 @@ MainWindow::MainWindow(QWidget *parent)
     , m_cancelButton(nullptr)
     , m_logGroup(nullptr)
     , m_logLayout(nullptr)
-    , m_logOutput(nullptr)
+    , m_logView(nullptr)
+    , m_logModel(nullptr)
+    , m_logSink(nullptr)
     , m_logExpanded(false)
     , m_settingsGroup(nullptr)
     , m_settingsLayout(nullptr)
@@ -84,7 +92,15 @@ MainWindow::MainWindow(QWidget *parent)
     detectOperatingSystem();
     
     // Initialize tools manager
-    m_toolsManager = new ToolsManager(m_logOutput, m_toolsButton, this);
+    m_toolsManager = new ToolsManager(m_logModel, this);
+    connect(m_toolsButton, &QPushButton::clicked, m_toolsManager, &ToolsManager::installOrUpdateTools);
+    connect(m_toolsManager, &ToolsManager::actionEnabledChanged, m_toolsButton, &QPushButton::setEnabled);
+    connect(m_toolsManager, &ToolsManager::actionTextChanged, m_toolsButton, &QPushButton::setText);
+    connect(m_toolsManager, &ToolsManager::actionStyleChanged, this, [this](const QString &styleClass) {
+        m_toolsButton->setProperty("class", styleClass);
+        style()->unpolish(m_toolsButton);
+        style()->polish(m_toolsButton);
+    });
     connect(m_toolsManager, &ToolsManager::toolsStatusChanged, this, &MainWindow::onToolsStatusChanged);
     connect(m_toolsManager, &ToolsManager::toolsStatusChanged, this, &MainWindow::onToolsStatusChangedForInitialState);
     m_toolsManager->checkToolsInstallation();
@@ -93,11 +109,70 @@ MainWindow::MainWindow(QWidget *parent)
     setInitialSettingsState();
     
     // Initialize download queue
-    m_downloadQueue = new DownloadQueue(m_logOutput, m_progressBar, m_progressGroup, m_toolsManager, this);
+    m_downloadQueue = new DownloadQueue(m_logModel, m_toolsManager, this);
+    connect(m_downloadQueue, &DownloadQueue::downloadProgress, m_progressBar, &QProgressBar::setValue);
+    connect(m_downloadQueue, &DownloadQueue::downloadsActiveChanged, this, &MainWindow::onDownloadsActiveChanged);
     connect(m_downloadQueue, &DownloadQueue::downloadStarted, this, &MainWindow::onDownloadStarted);
     connect(m_downloadQueue, &DownloadQueue::downloadCompleted, this, &MainWindow::onDownloadCompleted);
     connect(m_downloadQueue, &DownloadQueue::queueStatusChanged, this, &MainWindow::onQueueStatusChanged);
     connect(m_downloadQueue, &DownloadQueue::downloadAddedToQueue, this, &MainWindow::onDownloadAddedToQueue);
+    connect(m_downloadQueue, &DownloadQueue::scheduleEstimateChanged, this, &MainWindow::onScheduleEstimateChanged);
+    
+    // Number of yt-dlp processes running in parallel (config.ini: download/maxConcurrent)
+    m_downloadQueue->setMaxConcurrentDownloads(m_settings->value("download/maxConcurrent", 3).toInt());
+    // ffmpeg merges running beside the downloads (config.ini: download/maxMerges)
+    if (m_settings->contains("download/maxMerges")) {
+        m_downloadQueue->setMaxConcurrentMerges(m_settings->value("download/maxMerges").toInt());
+    }
+    m_downloadQueue->setResumeEnabled(m_settings->value("download/resume", true).toBool());
+    // Seconds between yt-dlp progress reports (config.ini: download/progressInterval)
+    m_downloadQueue->setProgressInterval(m_settings->value("download/progressInterval", 0.5).toDouble());
+    // Pending items whose metadata is resolved ahead of time (config.ini: download/prefetch)
+    m_downloadQueue->setPrefetchDepth(m_settings->value("download/prefetch", 3).toInt());
+    // Resolved links are reused for a while (config.ini: download/metadataCacheHours, 0 disables)
+    m_downloadQueue->enableMetadataCache(AppPaths::cacheDir() + "/metadata",
+                                         qint64(m_settings->value("download/metadataCacheHours", 6).toInt()) * 3600);
+    
+    // Restore the queue saved next to config.ini (survives crashes and restarts)
+    m_downloadQueue->enableJournal(QFileInfo(getConfigPath()).absolutePath());
+    
+    // Videos downloaded before are not queued again (config.ini: download/skipArchived)
+    m_downloadQueue->enableArchive(AppPaths::archivePath());
+    m_downloadQueue->setSkipArchived(m_settings->value("download/skipArchived", true).toBool());
+    
+    // Order of pending downloads: fifo, shortest or fair (config.ini: download/scheduling,
+    // download/agingMinutes, download/folderWeights)
+    m_downloadQueue->setSchedulingPolicy(SchedulingPolicy::kindFromName(m_settings->value("download/scheduling", "fifo").toString()));
+    m_downloadQueue->setSchedulingAging(qint64(m_settings->value("download/agingMinutes", 30).toInt()) * 60);
+    m_downloadQueue->setFolderWeights(m_settings->value("download/folderWeights").toStringList());
+    
+    // Bandwidth cap, e.g. 20M during office hours (config.ini: download/bandwidthLimit,
+    // download/bandwidthSchedule = "Mon-Fri 08:00-19:00=20M")
+    BandwidthSchedule bandwidth;
+    QString badRule;
+    bool validRate = false;
+    bandwidth.setDefaultLimit(BandwidthSchedule::parseRate(m_settings->value("download/bandwidthLimit", "0").toString(), &validRate));
+    if (!validRate) {
+        m_logModel->append("app", "WARNING: Invalid download/bandwidthLimit, downloads are not limited");
+    }
+    if (!bandwidth.parse(m_settings->value("download/bandwidthSchedule").toStringList(), &badRule)) {
+        m_logModel->append("app", QString("WARNING: Invalid download/bandwidthSchedule entry ignored: %1").arg(badRule));
+    }
+    m_downloadQueue->setBandwidthSchedule(bandwidth);
+    
+    // Off-peak downloading, e.g. "22:00-07:00" (config.ini: download/runWindow);
+    // urgent items still start at any time
+    QString runWindow = m_settings->value("download/runWindow").toString();
+    TimeWindow window;
+    if (!runWindow.trimmed().isEmpty() && !TimeWindow::parse(runWindow, &window)) {
+        m_logModel->append("app", QString("WARNING: Invalid download/runWindow ignored: %1").arg(runWindow));
+    }
+    m_downloadQueue->setRunWindow(window);
+    
+    // Playlists and channels pasted again only bring their new videos (config.ini: download/incrementalSync)
+    if (m_settings->value("download/incrementalSync", false).toBool()) {
+        m_downloadQueue->enableSync(AppPaths::syncStatePath());
+    }
     
     // Configurar ventana
     setWindowTitle("LGA_VimeoDownloader v0.83");
@@ -117,6 +192,11 @@ MainWindow::MainWindow(QWidget *parent)
 MainWindow::~MainWindow()
 {
     // Los widgets se limpian automáticamente por Qt
+    // El log en disco se cierra antes, escribiendo lo que quede pendiente
+    if (m_logSink) {
+        m_logModel->setSink(nullptr);
+        delete m_logSink;
+    }
 }
 
 void MainWindow::setupUI()
@@ -195,14 +275,25 @@ void MainWindow::setupUI()
     m_logLayout->setContentsMargins(0, 0, 0, 0); // Sin márgenes cuando colapsado
     m_logLayout->setSpacing(0); // No spacing between widgets
     
-    m_logOutput = new QTextEdit(this);
-    m_logOutput->setReadOnly(true);
-    m_logOutput->setMinimumHeight(200);
-    m_logOutput->setMaximumHeight(250);
-    m_logOutput->setFont(QFont("Courier", 10));
-    m_logOutput->hide(); // Start hidden
+    // Log con capacidad fija (config.ini: log/capacity), las entradas más viejas se descartan
+    m_logModel = new LogModel(m_settings->value("log/capacity", 10000).toInt(), this);
+    
+    // Log persistente en JSON lines junto a config.ini (config.ini: log/file*)
+    if (m_settings->value("log/fileEnabled", true).toBool()) {
+        LogSink::Options options;
+        options.maxFileSize = m_settings->value("log/fileMaxSizeMB", 10).toLongLong() * 1024 * 1024;
+        options.maxFiles = m_settings->value("log/fileMaxCount", 5).toInt();
+        options.compress = m_settings->value("log/fileCompress", true).toBool();
+        m_logSink = new LogSink(QFileInfo(getConfigPath()).absolutePath() + "/logs", options);
+        m_logModel->setSink(m_logSink);
+    }
+    
+    m_logView = new LogView(m_logModel, this);
+    m_logView->setMinimumHeight(200);
+    m_logView->setMaximumHeight(250);
+    m_logView->hide(); // Start hidden
     
-    m_logLayout->addWidget(m_logOutput);
+    m_logLayout->addWidget(m_logView);
     
     // Settings Group - clickable like log group (starts expanded)
     m_settingsGroup = new QGroupBox("Settings ⌄", this);
@@ -384,6 +475,65 @@ void MainWindow::onToolsStatusChanged(bool allInstalled)
 {
     // Tools status changed - update UI
     onUrlChanged();
+    
+    if (allInstalled && !m_pendingExternalUrls.isEmpty()) {
+        enqueueExternalUrls();
+    }
+}
+
+void MainWindow::openExternalUrls(const QStringList &urls)
+{
+    // Traer la ventana al frente
+    if (isMinimized()) {
+        showNormal();
+    }
+    raise();
+    activateWindow();
+    
+    if (urls.isEmpty()) {
+        return;
+    }
+    
+    m_pendingExternalUrls += urls;
+    if (!m_toolsManager->areToolsInstalled()) {
+        m_logModel->append("app", QString("%1 URLs received, waiting for yt-dlp and ffmpeg").arg(urls.size()));
+        return;
+    }
+    enqueueExternalUrls();
+}
+
+void MainWindow::enqueueExternalUrls()
+{
+    QStringList urls;
+    urls.swap(m_pendingExternalUrls);
+    
+    QString user = m_settings->value("vimeo/username", "").toString();
+    QString password = m_settings->value("vimeo/password", "").toString();
+    QString downloadDir = m_settings->value("download/folder", "").toString();
+    
+    // Same checks as the Download button, reported in the log instead of dialogs
+    if (downloadDir.isEmpty() || !isValidDownloadPath(downloadDir)) {
+        m_logModel->append("app", QString("ERROR: %1 URLs not queued, set a valid download folder first").arg(urls.size()));
+        m_urlInput->setText(urls.first());
+        return;
+    }
+    
+    QList<DownloadItem> items;
+    for (const QString &url : std::as_const(urls)) {
+        if (!isValidVideoUrl(url)) {
+            m_logModel->append("app", QString("WARNING: Skipped unsupported URL: %1").arg(url));
+        } else if (isVimeoUrl(url) && (user.isEmpty() || password.isEmpty())) {
+            m_logModel->append("app", QString("WARNING: Skipped Vimeo URL, save credentials first: %1").arg(url));
+        } else {
+            bool vimeo = isVimeoUrl(url);
+            items.append(DownloadItem(url, vimeo ? user : "", vimeo ? password : "", downloadDir));
+        }
+    }
+    
+    // Forwarded by other launches: through the submission queue, one batch per burst
+    if (!items.isEmpty()) {
+        m_downloadQueue->submit(items);
+    }
 }
 
 void MainWindow::onDownloadStarted()
@@ -404,6 +554,28 @@ void MainWindow::onQueueStatusChanged(int current, int total)
     m_progressGroup->setTitle(QString("Progress (%1/%2)").arg(current).arg(total));
 }
 
+void MainWindow::onDownloadsActiveChanged(bool active)
+{
+    // Percentage text only while something is downloading
+    m_progressBar->setTextVisible(active);
+    if (!active) {
+        m_progressBar->setValue(0);
+        m_progressBar->setFormat("%p%");
+    }
+}
+
+void MainWindow::onScheduleEstimateChanged(double meanCompletionSeconds)
+{
+    // Shown next to the percentage, which is only visible while downloading
+    if (meanCompletionSeconds < 0) {
+        m_progressBar->setFormat("%p%");
+        return;
+    }
+    m_progressBar->setFormat(QString("%p% - mean completion ~%1 (%2)")
+                             .arg(FormatUtils::formatDuration(qint64(meanCompletionSeconds)),
+                                  SchedulingPolicy::kindName(m_downloadQueue->schedulingPolicy())));
+}
+
 void MainWindow::onDownloadAddedToQueue(int totalCount)
 {
     // When a download is added, only update the total count, keep current number unchanged
@@ -445,7 +617,7 @@ void MainWindow::onSaveCredentialsClicked()
     m_settings->setValue("vimeo/password", password);
     m_settings->sync();
     
-    m_logOutput->append("Vimeo credentials saved successfully.");
+    m_logModel->append("app", "Vimeo credentials saved successfully.");
     onUrlChanged();
 }
 
@@ -463,7 +635,7 @@ void MainWindow::onBrowseFolderClicked()
         m_settings->setValue("download/folder", folder);
         m_settings->sync();
         
-        m_logOutput->append(QString("Download folder saved: %1").arg(folder));
+        m_logModel->append("app", QString("Download folder saved: %1").arg(folder));
         onUrlChanged();
     }
 }
@@ -593,31 +765,13 @@ void MainWindow::onToolsStatusChangedForInitialState(bool allInstalled)
 
 bool MainWindow::isValidVideoUrl(const QString &url) const
 {
-    if (url.isEmpty()) {
-        return false;
-    }
-    
-    // Check for Vimeo URLs
-    if (url.contains("vimeo.com", Qt::CaseInsensitive)) {
-        return true;
-    }
-    
-    // Check for YouTube URLs
-    if (url.contains("youtube.com", Qt::CaseInsensitive) || 
-        url.contains("youtu.be", Qt::CaseInsensitive)) {
-        return true;
-    }
-    
-    return false;
+    // Vimeo or YouTube URLs
+    return UrlUtils::isValidVideoUrl(url);
 }
 
 bool MainWindow::isVimeoUrl(const QString &url) const
 {
-    if (url.isEmpty()) {
-        return false;
-    }
-    
-    return url.contains("vimeo.com", Qt::CaseInsensitive);
+    return UrlUtils::isVimeoUrl(url);
 }
 
 bool MainWindow::isValidDownloadPath(const QString &path) const
@@ -632,55 +786,32 @@ bool MainWindow::isValidDownloadPath(const QString &path) const
 
 QString MainWindow::getConfigPath() const
 {
-    // Crear la carpeta de configuración siguiendo el patrón de PipeSync
-    QString appDataPath;
-    
-#ifdef Q_OS_WIN
-    // Windows: %APPDATA%\LGA\VimeoDownloader\config.ini
-    appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    appDataPath = appDataPath.replace("/VimeoDownloader", "").replace("\\VimeoDownloader", "");
-    appDataPath += "/VimeoDownloader";
-#elif defined(Q_OS_MAC)
-    // macOS: ~/Library/Application Support/LGA/VimeoDownloader/config.ini
-    appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    appDataPath = appDataPath.replace("/VimeoDownloader", "");
-    appDataPath += "/VimeoDownloader";
-#else
-    // Linux: ~/.config/LGA/VimeoDownloader/config.ini
-    appDataPath = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
-    appDataPath += "/LGA/VimeoDownloader";
-#endif
-    
-    QDir dir(appDataPath);
-    if (!dir.exists()) {
-        dir.mkpath(".");
-    }
-    
-    return appDataPath + "/config.ini";
+    // Compartido con la CLI: ambas usan el mismo config.ini
+    return AppPaths::configPath();
 }
 
 void MainWindow::detectOperatingSystem()
 {
 #ifdef Q_OS_MAC
-    m_logOutput->append("=== System Information ===");
-    m_logOutput->append("Operating System: macOS");
-    m_logOutput->append("Tools installation method: Download from GitHub");
-    m_logOutput->append("Tools location: Application bundle");
-    m_logOutput->append("Supported platforms: Vimeo, YouTube");
-    m_logOutput->append("===========================");
+    m_logModel->append("app", "=== System Information ===");
+    m_logModel->append("app", "Operating System: macOS");
+    m_logModel->append("app", "Tools installation method: Download from GitHub");
+    m_logModel->append("app", "Tools location: Application bundle");
+    m_logModel->append("app", "Supported platforms: Vimeo, YouTube");
+    m_logModel->append("app", "===========================");
 #elif defined(Q_OS_WIN)
-    m_logOutput->append("=== System Information ===");
-    m_logOutput->append("Operating System: Windows");
-    m_logOutput->append("Tools installation method: Download from GitHub");
-    m_logOutput->append("Tools location: Application directory");
-    m_logOutput->append("Supported platforms: Vimeo, YouTube");
-    m_logOutput->append("===========================");
+    m_logModel->append("app", "=== System Information ===");
+    m_logModel->append("app", "Operating System: Windows");
+    m_logModel->append("app", "Tools installation method: Download from GitHub");
+    m_logModel->append("app", "Tools location: Application directory");
+    m_logModel->append("app", "Supported platforms: Vimeo, YouTube");
+    m_logModel->append("app", "===========================");
 #else
-    m_logOutput->append("=== System Information ===");
-    m_logOutput->append("Operating System: Linux/Other");
-    m_logOutput->append("Tools installation: Manual installation required");
-    m_logOutput->append("Supported platforms: Vimeo, YouTube");
-    m_logOutput->append("===========================");
+    m_logModel->append("app", "=== System Information ===");
+    m_logModel->append("app", "Operating System: Linux/Other");
+    m_logModel->append("app", "Tools installation: Manual installation required");
+    m_logModel->append("app", "Supported platforms: Vimeo, YouTube");
+    m_logModel->append("app", "===========================");
 #endif
 }
 
@@ -718,14 +849,14 @@ void MainWindow::onLogToggleClicked()
         m_logGroup->setMaximumHeight(QWIDGETSIZE_MAX); // Sin límite máximo
         m_logLayout->setContentsMargins(3, 2, 3, 3); // Márgenes consistentes con CSS
         m_logLayout->setSpacing(2); // Espaciado pequeño entre widgets
-        m_logOutput->show();
+        m_logView->show();
     } else {
         m_logGroup->setTitle("Log >");
         m_logGroup->setProperty("collapsed", true); // Collapsed
         m_logGroup->setFixedHeight(35); // Altura aumentada en 10px más
         m_logLayout->setContentsMargins(0, 0, 0, 0); // Sin márgenes cuando colapsado
         m_logLayout->setSpacing(0); // No spacing between widgets
-        m_logOutput->hide();
+        m_logView->hide();
     }
 
     // Force style refresh to apply new property
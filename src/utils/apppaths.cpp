@@ -0,0 +1,56 @@
+#include "vimeodownloader/apppaths.h"
+
+#include <QDir>
+#include <QStandardPaths>
+
+QString AppPaths::configPath()
+{
+    return configDir() + "/config.ini";
+}
+
+QString AppPaths::archivePath()
+{
+    return configDir() + "/download.archive";
+}
+
+QString AppPaths::syncStatePath()
+{
+    return configDir() + "/sync.json";
+}
+
+QString AppPaths::cacheDir()
+{
+    // Linux: ~/.cache/LGA/VimeoDownloader, macOS: ~/Library/Caches/..., Windows: %LOCALAPPDATA%\...\cache
+    QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(path);
+    return path;
+}
+
+QString AppPaths::configDir()
+{
+    // Crear la carpeta de configuración siguiendo el patrón de PipeSync
+    QString appDataPath;
+    
+#ifdef Q_OS_WIN
+    // Windows: %APPDATA%\LGA\VimeoDownloader\config.ini
+    appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    appDataPath = appDataPath.replace("/VimeoDownloader", "").replace("\\VimeoDownloader", "");
+    appDataPath += "/VimeoDownloader";
+#elif defined(Q_OS_MAC)
+    // macOS: ~/Library/Application Support/LGA/VimeoDownloader/config.ini
+    appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    appDataPath = appDataPath.replace("/VimeoDownloader", "");
+    appDataPath += "/VimeoDownloader";
+#else
+    // Linux: ~/.config/LGA/VimeoDownloader/config.ini
+    appDataPath = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
+    appDataPath += "/LGA/VimeoDownloader";
+#endif
+    
+    QDir dir(appDataPath);
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+    
+    return appDataPath;
+}
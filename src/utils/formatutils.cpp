@@ -0,0 +1,43 @@
+#include "vimeodownloader/formatutils.h"
+
+QString FormatUtils::formatBytes(qint64 bytes)
+{
+    if (bytes < 0) {
+        return "?";
+    }
+    if (bytes < 1024) {
+        return QString("%1 B").arg(bytes);
+    }
+    
+    static const char *units[] = { "KiB", "MiB", "GiB", "TiB" };
+    double value = double(bytes) / 1024.0;
+    int unit = 0;
+    while (value >= 1024.0 && unit < 3) {
+        value /= 1024.0;
+        unit++;
+    }
+    return QString("%1 %2").arg(value, 0, 'f', 1).arg(units[unit]);
+}
+
+QString FormatUtils::formatSpeed(double bytesPerSecond)
+{
+    if (bytesPerSecond <= 0) {
+        return "-- B/s";
+    }
+    return formatBytes(qint64(bytesPerSecond)) + "/s";
+}
+
+QString FormatUtils::formatDuration(qint64 seconds)
+{
+    if (seconds < 0) {
+        return "--:--";
+    }
+    
+    qint64 hours = seconds / 3600;
+    qint64 minutes = (seconds % 3600) / 60;
+    qint64 secs = seconds % 60;
+    if (hours > 0) {
+        return QString("%1:%2:%3").arg(hours, 2, 10, QChar('0')).arg(minutes, 2, 10, QChar('0')).arg(secs, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(minutes, 2, 10, QChar('0')).arg(secs, 2, 10, QChar('0'));
+}
@@ -1,26 +1,22 @@
 #include "vimeodownloader/toolsmanager.h"
+#include "vimeodownloader/logmodel.h"
 
 #include <QCoreApplication>
 #include <QDir>
 #include <QFile>
 #include <QNetworkRequest>
 #include <QStandardPaths>
-#include <QStyle>
 #include <QTimer>
 
-ToolsManager::ToolsManager(QTextEdit *logOutput, QPushButton *toolsButton, QObject *parent)
+ToolsManager::ToolsManager(LogModel *log, QObject *parent)
     : QObject(parent)
-    , m_logOutput(logOutput)
-    , m_toolsButton(toolsButton)
+    , m_log(log)
     , m_ytDlpInstalled(false)
     , m_ffmpegInstalled(false)
     , m_checkingTools(false)
     , m_networkManager(nullptr)
     , m_pendingProcesses(0)
 {
-    // Connect button signal
-    connect(m_toolsButton, &QPushButton::clicked, this, &ToolsManager::onInstallUpdateClicked);
-    
     // Initialize network manager
     m_networkManager = new QNetworkAccessManager(this);
 }
@@ -788,32 +784,24 @@ void ToolsManager::downloadFfmpegWindows()
 // Helper Methods
 void ToolsManager::logMessage(const QString &message)
 {
-    if (m_logOutput) {
-        m_logOutput->append(message);
+    if (m_log) {
+        m_log->append("tools", message);
     }
 }
 
 void ToolsManager::setButtonEnabled(bool enabled)
 {
-    if (m_toolsButton) {
-        m_toolsButton->setEnabled(enabled);
-    }
+    emit actionEnabledChanged(enabled);
 }
 
 void ToolsManager::setButtonText(const QString &text)
 {
-    if (m_toolsButton) {
-        m_toolsButton->setText(text);
-    }
+    emit actionTextChanged(text);
 }
 
 void ToolsManager::setButtonStyle(const QString &styleClass)
 {
-    if (m_toolsButton) {
-        m_toolsButton->setProperty("class", styleClass);
-        m_toolsButton->style()->unpolish(m_toolsButton);
-        m_toolsButton->style()->polish(m_toolsButton);
-    }
+    emit actionStyleChanged(styleClass);
 }
 
 QString ToolsManager::getYtDlpPath() const
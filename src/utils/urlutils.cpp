@@ -0,0 +1,115 @@
+#include "vimeodownloader/urlutils.h"
+
+#include <QUrl>
+#include <QUrlQuery>
+
+const QString UrlUtils::HOST_VIMEO = "vimeo";
+const QString UrlUtils::HOST_YOUTUBE = "youtube";
+const QString UrlUtils::HOST_OTHER = "other";
+
+bool UrlUtils::isValidVideoUrl(const QString &url)
+{
+    if (url.isEmpty()) {
+        return false;
+    }
+    
+    return isVimeoUrl(url) || isYouTubeUrl(url);
+}
+
+bool UrlUtils::isVimeoUrl(const QString &url)
+{
+    if (url.isEmpty()) {
+        return false;
+    }
+    
+    return url.contains("vimeo.com", Qt::CaseInsensitive);
+}
+
+bool UrlUtils::isYouTubeUrl(const QString &url)
+{
+    if (url.isEmpty()) {
+        return false;
+    }
+    
+    return url.contains("youtube.com", Qt::CaseInsensitive) ||
+           url.contains("youtu.be", Qt::CaseInsensitive);
+}
+
+bool UrlUtils::isCollectionUrl(const QString &url)
+{
+    QUrl parsed(url.trimmed());
+    const QStringList segments = parsed.path().split('/', Qt::SkipEmptyParts);
+    QString first = segments.value(0).toLower();
+    
+    if (isVimeoUrl(url)) {
+        if (parsed.host().startsWith("player.", Qt::CaseInsensitive) || segments.isEmpty()) {
+            return false;
+        }
+        // showcase/ID and album/ID; showcase/ID/video/VIDEO is one video
+        if (first == "showcase" || first == "album") {
+            return segments.size() == 2;
+        }
+        // channels/NAME, groups/NAME[/videos]; channels/NAME/ID is one video
+        if (first == "channels" || first == "groups") {
+            return segments.size() == 2 || (segments.size() == 3 && segments[2] == "videos");
+        }
+        // User pages: vimeo.com/NAME, vimeo.com/NAME/videos
+        bool isNumber = false;
+        segments[0].toULongLong(&isNumber);
+        return !isNumber && (segments.size() == 1 || (segments.size() == 2 && segments[1] == "videos"));
+    }
+    if (isYouTubeUrl(url)) {
+        // watch?v=ID&list=... downloads the video alone (--no-playlist)
+        if (first == "playlist") {
+            return QUrlQuery(parsed).hasQueryItem("list");
+        }
+        return first.startsWith('@') || first == "channel" || first == "c" || first == "user";
+    }
+    return false;
+}
+
+QString UrlUtils::hostKey(const QString &url)
+{
+    if (isVimeoUrl(url)) {
+        return HOST_VIMEO;
+    }
+    if (isYouTubeUrl(url)) {
+        return HOST_YOUTUBE;
+    }
+    return HOST_OTHER;
+}
+
+QString UrlUtils::canonicalVideoKey(const QString &url)
+{
+    QUrl parsed(url.trimmed());
+    const QStringList segments = parsed.path().split('/', Qt::SkipEmptyParts);
+    
+    // A showcase or album id is not a video id
+    bool collection = isCollectionUrl(url);
+    if (!collection && isVimeoUrl(url)) {
+        // vimeo.com/ID, /ID/hash, player.vimeo.com/video/ID, /user/review/ID/hash, /channels/x/ID...
+        for (const QString &segment : segments) {
+            bool isNumber = false;
+            segment.toULongLong(&isNumber);
+            if (isNumber) {
+                return HOST_VIMEO + ":" + segment;
+            }
+        }
+    } else if (!collection && isYouTubeUrl(url)) {
+        // youtu.be/ID, watch?v=ID, /shorts/ID, /embed/ID, /live/ID
+        QString id;
+        if (parsed.host().contains("youtu.be", Qt::CaseInsensitive)) {
+            id = segments.value(0);
+        } else if (QUrlQuery(parsed).hasQueryItem("v")) {
+            id = QUrlQuery(parsed).queryItemValue("v");
+        } else if (segments.size() >= 2 && (segments[0] == "shorts" || segments[0] == "embed" || segments[0] == "live")) {
+            id = segments[1];
+        }
+        if (!id.isEmpty()) {
+            return HOST_YOUTUBE + ":" + id;
+        }
+    }
+    
+    parsed.setFragment(QString());
+    return "url:" + parsed.adjusted(QUrl::NormalizePathSegments).toString();
+}
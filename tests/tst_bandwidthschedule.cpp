@@ -0,0 +1,70 @@
+#include "vimeodownloader/bandwidthschedule.h"
+
+#include <QtTest>
+
+namespace {
+// 2024-01-01 was a Monday
+QDateTime at(int day, int hour, int minute = 0)
+{
+    return QDateTime(QDate(2024, 1, day), QTime(hour, minute));
+}
+
+constexpr qint64 MIB = 1024 * 1024;
+}
+
+class TestBandwidthSchedule : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parseRate();
+    void firstMatchingRuleWins();
+    void invalidEntryIsReported();
+};
+
+void TestBandwidthSchedule::parseRate()
+{
+    bool ok = false;
+    QCOMPARE(BandwidthSchedule::parseRate("20M", &ok), 20 * MIB);
+    QVERIFY(ok);
+    QCOMPARE(BandwidthSchedule::parseRate("512K", &ok), qint64(512) * 1024);
+    QVERIFY(ok);
+    QCOMPARE(BandwidthSchedule::parseRate("1.5MB/s", &ok), 3 * MIB / 2);
+    QVERIFY(ok);
+    QCOMPARE(BandwidthSchedule::parseRate("off", &ok), qint64(0));
+    QVERIFY(ok);
+    QCOMPARE(BandwidthSchedule::parseRate("fast", &ok), qint64(0));
+    QVERIFY(!ok);
+    BandwidthSchedule::parseRate("-1M", &ok);
+    QVERIFY(!ok);
+}
+
+void TestBandwidthSchedule::firstMatchingRuleWins()
+{
+    BandwidthSchedule schedule;
+    QVERIFY(schedule.isEmpty());
+    QVERIFY(schedule.parse({ "Mon-Fri 08:00-19:00=20M", "08:00-19:00=5M", "22:00-06:00=0" }));
+    schedule.setDefaultLimit(10 * MIB);
+    QVERIFY(!schedule.isEmpty());
+
+    QCOMPARE(schedule.limitAt(at(1, 12)), 20 * MIB); // Monday, first rule
+    QCOMPARE(schedule.limitAt(at(6, 12)), 5 * MIB);  // Saturday, second rule
+    QCOMPARE(schedule.limitAt(at(1, 23)), qint64(0)); // Night: no cap
+    QCOMPARE(schedule.limitAt(at(2, 5)), qint64(0));  // Still last night's rule
+    QCOMPARE(schedule.limitAt(at(1, 20)), 10 * MIB); // No rule: default
+}
+
+void TestBandwidthSchedule::invalidEntryIsReported()
+{
+    BandwidthSchedule schedule;
+    QString error;
+    QVERIFY(!schedule.parse({ "08:00-19:00=lots", "22:00-06:00=1M", "nonsense" }, &error));
+    QCOMPARE(error, QString("08:00-19:00=lots"));
+
+    // The valid entries are kept
+    QCOMPARE(schedule.limitAt(at(1, 23)), MIB);
+    QCOMPARE(schedule.limitAt(at(1, 12)), qint64(0));
+}
+
+QTEST_GUILESS_MAIN(TestBandwidthSchedule)
+#include "tst_bandwidthschedule.moc"
@@ -0,0 +1,108 @@
+#include "vimeodownloader/downloadarchive.h"
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+class TestDownloadArchive : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sameVideoInAnyForm();
+    void survivesReopen();
+    void growsPastHalfFull();
+    void secondInstanceWorksWithout();
+};
+
+void TestDownloadArchive::sameVideoInAnyForm()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    DownloadArchive archive(dir.filePath("archive.bin"));
+    QVERIFY2(archive.isOpen(), qPrintable(archive.errorString()));
+    QCOMPARE(archive.size(), 0);
+    QVERIFY(!archive.contains("https://vimeo.com/76979871"));
+
+    QVERIFY(archive.add("https://vimeo.com/76979871"));
+    QVERIFY(archive.contains("https://player.vimeo.com/video/76979871"));
+    QVERIFY(archive.contains("https://vimeo.com/76979871#t=30s"));
+    QVERIFY(!archive.add("https://player.vimeo.com/video/76979871"));
+    QCOMPARE(archive.size(), 1);
+
+    QVERIFY(archive.add("https://www.youtube.com/watch?v=dQw4w9WgXcQ"));
+    QVERIFY(archive.contains("https://youtu.be/dQw4w9WgXcQ"));
+    QVERIFY(!archive.contains("https://vimeo.com/1"));
+    QCOMPARE(archive.size(), 2);
+    QVERIFY(archive.filteredLookups() <= archive.lookups());
+}
+
+void TestDownloadArchive::survivesReopen()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = dir.filePath("archive.bin");
+
+    {
+        DownloadArchive archive(path);
+        QVERIFY2(archive.isOpen(), qPrintable(archive.errorString()));
+        QVERIFY(archive.add("https://vimeo.com/1"));
+        QVERIFY(archive.add("https://vimeo.com/2"));
+    }
+
+    DownloadArchive archive(path);
+    QVERIFY2(archive.isOpen(), qPrintable(archive.errorString()));
+    QCOMPARE(archive.size(), 2);
+    QVERIFY(archive.contains("https://vimeo.com/1"));
+    QVERIFY(archive.contains("https://vimeo.com/2"));
+    QVERIFY(!archive.contains("https://vimeo.com/3"));
+}
+
+void TestDownloadArchive::growsPastHalfFull()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = dir.filePath("archive.bin");
+    const int count = int(DownloadArchive::INITIAL_CAPACITY / 2) + 1;
+
+    {
+        DownloadArchive archive(path);
+        QVERIFY2(archive.isOpen(), qPrintable(archive.errorString()));
+        for (int i = 1; i <= count; ++i) {
+            QVERIFY(archive.add(QString("https://vimeo.com/%1").arg(i)));
+        }
+        QCOMPARE(archive.size(), count);
+        QVERIFY(archive.contains("https://vimeo.com/1"));
+        QVERIFY(archive.contains(QString("https://vimeo.com/%1").arg(count)));
+    }
+    QVERIFY(!QFile::exists(path + ".new"));
+
+    DownloadArchive archive(path);
+    QVERIFY2(archive.isOpen(), qPrintable(archive.errorString()));
+    QCOMPARE(archive.size(), count);
+    for (int i = 1; i <= count; ++i) {
+        QVERIFY(archive.contains(QString("https://vimeo.com/%1").arg(i)));
+    }
+    QVERIFY(!archive.contains(QString("https://vimeo.com/%1").arg(count + 1)));
+}
+
+void TestDownloadArchive::secondInstanceWorksWithout()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = dir.filePath("archive.bin");
+
+    DownloadArchive first(path);
+    QVERIFY2(first.isOpen(), qPrintable(first.errorString()));
+    QVERIFY(first.add("https://vimeo.com/1"));
+
+    DownloadArchive second(path);
+    QVERIFY(!second.isOpen());
+    QVERIFY(!second.errorString().isEmpty());
+    QVERIFY(!second.contains("https://vimeo.com/1"));
+    QVERIFY(!second.add("https://vimeo.com/2"));
+    QCOMPARE(second.size(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestDownloadArchive)
+#include "tst_downloadarchive.moc"
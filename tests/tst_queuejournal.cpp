@@ -0,0 +1,222 @@
+#include "vimeodownloader/queuejournal.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+class TestQueueJournal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyDirectoryRestoresNothing();
+    void replayRebuildsQueue();
+    void interruptedDownloadsGoFirst();
+    void replayOverCompactedSnapshotKeepsOneFinish();
+    void tornTailIsDropped();
+    void resetDiscardsEverything();
+
+private:
+    static DownloadItem makeItem(quint64 id, const QString &url);
+    static QByteArray readFile(const QString &path);
+    static void writeFile(const QString &path, const QByteArray &data);
+};
+
+DownloadItem TestQueueJournal::makeItem(quint64 id, const QString &url)
+{
+    DownloadItem item(url, QString(), QString(), "/tmp/downloads");
+    item.id = id;
+    return item;
+}
+
+QByteArray TestQueueJournal::readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void TestQueueJournal::writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(data);
+}
+
+void TestQueueJournal::emptyDirectoryRestoresNothing()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QueueJournal journal(dir.path());
+    QueueJournalState state = journal.restore();
+    QVERIFY(state.pending.isEmpty());
+    QVERIFY(state.finished.isEmpty());
+    QCOMPARE(state.nextId, quint64(1));
+    QCOMPARE(state.interruptedCount, 0);
+}
+
+void TestQueueJournal::replayRebuildsQueue()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    {
+        QueueJournal journal(dir.path());
+        journal.restore();
+        journal.recordEnqueue(QList<DownloadItem>{ makeItem(1, "https://vimeo.com/1"),
+                                                   makeItem(2, "https://vimeo.com/2"),
+                                                   makeItem(3, "https://vimeo.com/3") });
+
+        DownloadItem done = makeItem(1, "https://vimeo.com/1");
+        done.status = DownloadStatus::Completed;
+        journal.recordFinish(done);
+
+        DownloadItem raised = makeItem(3, "https://vimeo.com/3");
+        raised.priority = 5;
+        journal.recordPriority(raised);
+    }
+
+    QueueJournal journal(dir.path());
+    QueueJournalState state = journal.restore();
+    QCOMPARE(state.pending.size(), 2);
+    QCOMPARE(state.pending.at(0).id, quint64(2));
+    QCOMPARE(state.pending.at(1).id, quint64(3));
+    QCOMPARE(state.pending.at(1).priority, 5);
+    QCOMPARE(state.finished.size(), 1);
+    QCOMPARE(state.finished.at(0).id, quint64(1));
+    QCOMPARE(state.finished.at(0).status, DownloadStatus::Completed);
+    QCOMPARE(state.nextId, quint64(4));
+}
+
+void TestQueueJournal::interruptedDownloadsGoFirst()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    {
+        QueueJournal journal(dir.path());
+        journal.restore();
+        journal.recordEnqueue(makeItem(1, "https://vimeo.com/1"));
+        journal.recordEnqueue(makeItem(2, "https://vimeo.com/2"));
+
+        DownloadItem running = makeItem(2, "https://vimeo.com/2");
+        running.status = DownloadStatus::Downloading;
+        running.startTime = QDateTime::currentDateTime();
+        running.progress = 40;
+        journal.recordStart(running);
+        journal.recordProgress(running);
+    }
+
+    QueueJournal journal(dir.path());
+    QueueJournalState state = journal.restore();
+    QCOMPARE(state.interruptedCount, 1);
+    QCOMPARE(state.pending.size(), 2);
+    QCOMPARE(state.pending.at(0).id, quint64(2));
+    QCOMPARE(state.pending.at(0).status, DownloadStatus::Pending);
+    QCOMPARE(state.pending.at(0).progress, 40);
+    QCOMPARE(state.pending.at(1).id, quint64(1));
+}
+
+void TestQueueJournal::replayOverCompactedSnapshotKeepsOneFinish()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // A crash after the snapshot was written but before the journal was
+    // truncated replays records the snapshot already holds
+    QByteArray oldJournal;
+    QString journalPath;
+    {
+        QueueJournal journal(dir.path());
+        journal.restore();
+        journal.recordEnqueue(makeItem(1, "https://vimeo.com/1"));
+        journal.recordEnqueue(makeItem(2, "https://vimeo.com/2"));
+        DownloadItem done = makeItem(1, "https://vimeo.com/1");
+        done.status = DownloadStatus::Completed;
+        journal.recordFinish(done);
+
+        journalPath = journal.journalPath();
+        oldJournal = readFile(journalPath);
+
+        QueueJournalState state;
+        state.pending.append(makeItem(2, "https://vimeo.com/2"));
+        state.finished.append(done);
+        state.nextId = 3;
+        QVERIFY(journal.compact(state));
+        QCOMPARE(journal.recordsSinceCompaction(), 0);
+    }
+    writeFile(journalPath, oldJournal);
+
+    QueueJournal journal(dir.path());
+    QueueJournalState state = journal.restore();
+    QCOMPARE(state.finished.size(), 1);
+    QCOMPARE(state.finished.at(0).id, quint64(1));
+    QCOMPARE(state.pending.size(), 1);
+    QCOMPARE(state.pending.at(0).id, quint64(2));
+    QCOMPARE(state.nextId, quint64(3));
+}
+
+void TestQueueJournal::tornTailIsDropped()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString journalPath;
+    {
+        QueueJournal journal(dir.path());
+        journal.restore();
+        journal.recordEnqueue(makeItem(1, "https://vimeo.com/1"));
+        journalPath = journal.journalPath();
+    }
+    QByteArray data = readFile(journalPath);
+    writeFile(journalPath, data + QByteArray("\x00\x00\x01\x00\x12", 5));
+
+    {
+        QueueJournal journal(dir.path());
+        QueueJournalState state = journal.restore();
+        QCOMPARE(state.pending.size(), 1);
+        QCOMPARE(readFile(journalPath).size(), data.size());
+
+        // Records after the repaired tail are read back
+        journal.recordEnqueue(makeItem(2, "https://vimeo.com/2"));
+    }
+
+    QueueJournal journal(dir.path());
+    QueueJournalState state = journal.restore();
+    QCOMPARE(state.pending.size(), 2);
+    QCOMPARE(state.nextId, quint64(3));
+}
+
+void TestQueueJournal::resetDiscardsEverything()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString backupPath;
+    {
+        QueueJournal journal(dir.path());
+        journal.restore();
+        journal.recordEnqueue(makeItem(1, "https://vimeo.com/1"));
+        DownloadItem done = makeItem(2, "https://vimeo.com/2");
+        done.status = DownloadStatus::Completed;
+        journal.recordFinish(done);
+
+        QueueJournalState before;
+        before.pending.append(makeItem(1, "https://vimeo.com/1"));
+        before.finished.append(done);
+        before.nextId = 3;
+        journal.recordReset(before);
+        backupPath = journal.resetBackupPath();
+    }
+    QVERIFY(QFile::exists(backupPath));
+
+    QueueJournal journal(dir.path());
+    QueueJournalState state = journal.restore();
+    QVERIFY(state.pending.isEmpty());
+    QVERIFY(state.finished.isEmpty());
+    // Ids are never reused after a reset
+    QCOMPARE(state.nextId, quint64(3));
+}
+
+QTEST_GUILESS_MAIN(TestQueueJournal)
+#include "tst_queuejournal.moc"
@@ -0,0 +1,91 @@
+#include "vimeodownloader/timewindow.h"
+
+#include <QtTest>
+
+namespace {
+// 2024-01-01 was a Monday
+QDateTime at(int day, int hour, int minute = 0)
+{
+    return QDateTime(QDate(2024, 1, day), QTime(hour, minute));
+}
+}
+
+class TestTimeWindow : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void defaultIsAlwaysOpen();
+    void rejectsMalformedText();
+    void rangeWithinDay();
+    void rangeAcrossMidnightBelongsToStartDay();
+    void nextChange();
+    void nextChangeOfWholeDayIsMidnight();
+};
+
+void TestTimeWindow::defaultIsAlwaysOpen()
+{
+    TimeWindow window;
+    QVERIFY(window.isAlways());
+    QVERIFY(window.contains(at(1, 3)));
+    QVERIFY(!window.nextChange(at(1, 3)).isValid());
+}
+
+void TestTimeWindow::rejectsMalformedText()
+{
+    TimeWindow window;
+    QVERIFY(TimeWindow::parse("09:00-17:00", &window));
+    QVERIFY(!TimeWindow::parse("9-17", &window));
+    QVERIFY(!TimeWindow::parse("Funday 09:00-17:00", &window));
+    QVERIFY(!TimeWindow::parse("09:00", &window));
+    // Left untouched by a failed parse
+    QCOMPARE(window.toString(), QString("09:00-17:00"));
+}
+
+void TestTimeWindow::rangeWithinDay()
+{
+    TimeWindow window;
+    QVERIFY(TimeWindow::parse("Mon-Fri 09:00-17:00", &window));
+    QVERIFY(!window.contains(at(1, 8, 59)));
+    QVERIFY(window.contains(at(1, 9)));
+    QVERIFY(window.contains(at(5, 16, 59)));
+    QVERIFY(!window.contains(at(5, 17)));
+    QVERIFY(!window.contains(at(6, 12))); // Saturday
+}
+
+void TestTimeWindow::rangeAcrossMidnightBelongsToStartDay()
+{
+    TimeWindow window;
+    QVERIFY(TimeWindow::parse("Fri 22:00-07:00", &window));
+    QVERIFY(!window.contains(at(5, 21, 59)));
+    QVERIFY(window.contains(at(5, 23)));
+    QVERIFY(window.contains(at(6, 6, 59)));  // Saturday morning, started Friday
+    QVERIFY(!window.contains(at(6, 23)));    // Saturday night is not Friday's
+    QVERIFY(!window.contains(at(5, 3)));     // Friday morning belongs to Thursday
+}
+
+void TestTimeWindow::nextChange()
+{
+    TimeWindow window;
+    QVERIFY(TimeWindow::parse("22:00-07:00", &window));
+    QCOMPARE(window.nextChange(at(1, 12)), at(1, 22));
+    QCOMPARE(window.nextChange(at(1, 23)), at(2, 7));
+
+    QVERIFY(TimeWindow::parse("Sat-Sun 00:00-24:00", &window));
+    QCOMPARE(window.nextChange(at(3, 10)), at(6, 0));
+    QCOMPARE(window.nextChange(at(6, 10)), at(8, 0));
+}
+
+void TestTimeWindow::nextChangeOfWholeDayIsMidnight()
+{
+    // Equal ends cover the whole day: opens and closes at midnight
+    TimeWindow window;
+    QVERIFY(TimeWindow::parse("Sat 10:00-10:00", &window));
+    QVERIFY(window.contains(at(6, 0)));
+    QVERIFY(!window.contains(at(7, 10)));
+    QCOMPARE(window.nextChange(at(5, 12)), at(6, 0));
+    QCOMPARE(window.nextChange(at(6, 12)), at(7, 0));
+}
+
+QTEST_GUILESS_MAIN(TestTimeWindow)
+#include "tst_timewindow.moc"